@@ -274,6 +274,7 @@
 #include <urcu/compiler.h>
 #include <urcu/rculfhash.h>
 #include <rculfhash-internal.h>
+#include "urcu-sdt.h"
 #include <stdio.h>
 #include <pthread.h>
 
@@ -1908,10 +1909,12 @@ void _do_cds_lfht_resize(struct cds_lfht *ht)
 		ht->resize_initiated = 1;
 		old_size = ht->size;
 		new_size = CMM_LOAD_SHARED(ht->resize_target);
+		urcu_probe3(lfht_resize_begin, ht, old_size, new_size);
 		if (old_size < new_size)
 			_do_cds_lfht_grow(ht, old_size, new_size);
 		else if (old_size > new_size)
 			_do_cds_lfht_shrink(ht, old_size, new_size);
+		urcu_probe3(lfht_resize_end, ht, old_size, ht->size);
 		ht->resize_initiated = 0;
 		/* write resize_initiated before read resize_target */
 		cmm_smp_mb();
@@ -101,6 +101,12 @@ volatile int goflag __attribute__((__aligned__(CAA_CACHE_LINE_SIZE)))
 #define put_thread_online		rcu_thread_online
 #endif
 
+#ifdef TORTURE_QSBR_LAZY
+#define set_thread_lazy_offline()	(void) rcu_thread_set_lazy_offline(1)
+#else
+#define set_thread_lazy_offline()	do ; while (0)
+#endif
+
 #ifndef mark_rcu_quiescent_state
 #define mark_rcu_quiescent_state() do ; while (0)
 #endif /* #ifdef mark_rcu_quiescent_state */
@@ -125,6 +131,7 @@ void *rcu_read_perf_test(void *arg)
 	long long n_reads_local = 0;
 
 	rcu_register_thread();
+	set_thread_lazy_offline();
 	run_on(me);
 	uatomic_inc(&nthreadsrunning);
 	put_thread_offline();
@@ -287,6 +294,7 @@ void *rcu_read_stress_test(void *arg)
 	int pc;
 
 	rcu_register_thread();
+	set_thread_lazy_offline();
 	put_thread_offline();
 	while (goflag == GOFLAG_INIT)
 		poll(NULL, 0, 1);
@@ -24,6 +24,9 @@
 #ifdef RCU_BP
 #include <urcu-bp.h>
 #endif
+#ifdef RCU_PERCPU
+#include <urcu-percpu.h>
+#endif
 
 #include <urcu/uatomic.h>
 #include <urcu/rculist.h>
@@ -0,0 +1,177 @@
+/*
+ * test_urcu_boost.c
+ *
+ * Userspace RCU library - test boosting of readers delaying grace periods
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <time.h>
+#include <urcu.h>
+
+#define BOOST_THRESHOLD_MS	50
+#define BOOST_PRIORITY		1
+/* How long to wait for the grace period to boost the reader. */
+#define BOOST_TIMEOUT_MS	5000
+
+static sem_t reader_locked, reader_release, reader_done;
+
+static void fail(const char *msg)
+{
+	fprintf(stderr, "test_urcu_boost: %s\n", msg);
+	exit(EXIT_FAILURE);
+}
+
+/*
+ * Stay in a read-side critical section until released. The reader
+ * sleeps meanwhile: once boosted to a real-time priority, a spinning
+ * reader would starve the test on a single CPU.
+ */
+static void *thr_reader(void *arg)
+{
+	rcu_register_thread();
+	rcu_read_lock();
+	if (sem_post(&reader_locked))
+		fail("sem_post");
+	while (sem_wait(&reader_release))
+		if (errno != EINTR)
+			fail("sem_wait");
+	rcu_read_unlock();
+	if (sem_post(&reader_done))
+		fail("sem_post");
+	while (sem_wait(&reader_release))
+		if (errno != EINTR)
+			fail("sem_wait");
+	rcu_unregister_thread();
+	return NULL;
+}
+
+static void *thr_updater(void *arg)
+{
+	synchronize_rcu();
+	return NULL;
+}
+
+static int get_policy(pthread_t tid, int *priority)
+{
+	struct sched_param param;
+	int policy;
+
+	if (pthread_getschedparam(tid, &policy, &param))
+		fail("pthread_getschedparam");
+	*priority = param.sched_priority;
+	return policy;
+}
+
+static unsigned long now_ms(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts))
+		fail("clock_gettime");
+	return ts.tv_sec * 1000UL + ts.tv_nsec / 1000000;
+}
+
+/* Return 1 if this process may raise thread priorities. */
+static int can_boost(void)
+{
+	struct sched_param param;
+	int policy, ret;
+
+	if (pthread_getschedparam(pthread_self(), &policy, &param))
+		fail("pthread_getschedparam");
+	param.sched_priority = BOOST_PRIORITY;
+	ret = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+	if (ret == EPERM)
+		return 0;
+	if (ret)
+		fail("pthread_setschedparam");
+	param.sched_priority = 0;
+	if (pthread_setschedparam(pthread_self(), policy, &param))
+		fail("pthread_setschedparam");
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t reader, updater;
+	int policy, priority, old_policy, old_priority;
+	unsigned long start;
+
+	if (!can_boost()) {
+		printf("test_urcu_boost: skipped, lacking CAP_SYS_NICE\n");
+		exit(EXIT_SUCCESS);
+	}
+	if (sem_init(&reader_locked, 0, 0) || sem_init(&reader_release, 0, 0)
+			|| sem_init(&reader_done, 0, 0))
+		fail("sem_init");
+	if (rcu_set_reader_boost(BOOST_THRESHOLD_MS, SCHED_FIFO,
+			BOOST_PRIORITY))
+		fail("rcu_set_reader_boost");
+	if (pthread_create(&reader, NULL, thr_reader, NULL))
+		fail("pthread_create");
+	while (sem_wait(&reader_locked))
+		if (errno != EINTR)
+			fail("sem_wait");
+	old_policy = get_policy(reader, &old_priority);
+	if (old_policy == SCHED_FIFO)
+		fail("reader already runs with SCHED_FIFO");
+
+	/* The grace period waits for the reader past the threshold. */
+	start = now_ms();
+	if (pthread_create(&updater, NULL, thr_updater, NULL))
+		fail("pthread_create");
+	for (;;) {
+		policy = get_policy(reader, &priority);
+		if (policy == SCHED_FIFO
+				|| now_ms() - start > BOOST_TIMEOUT_MS)
+			break;
+		(void) poll(NULL, 0, 10);
+	}
+	if (policy != SCHED_FIFO || priority != BOOST_PRIORITY)
+		fail("reader not boosted");
+	if (now_ms() - start < BOOST_THRESHOLD_MS)
+		fail("reader boosted before the threshold");
+
+	/* Once the reader is done, the grace period restores it. */
+	if (sem_post(&reader_release))
+		fail("sem_post");
+	while (sem_wait(&reader_done))
+		if (errno != EINTR)
+			fail("sem_wait");
+	if (pthread_join(updater, NULL))
+		fail("pthread_join");
+	policy = get_policy(reader, &priority);
+	if (policy != old_policy || priority != old_priority)
+		fail("reader scheduling not restored");
+
+	if (sem_post(&reader_release))
+		fail("sem_post");
+	if (pthread_join(reader, NULL))
+		fail("pthread_join");
+	if (rcu_set_reader_boost(0, SCHED_OTHER, 0))
+		fail("rcu_set_reader_boost");
+	printf("test_urcu_boost: OK\n");
+	exit(EXIT_SUCCESS);
+}
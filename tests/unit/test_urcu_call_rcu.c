@@ -0,0 +1,234 @@
+/*
+ * test_urcu_call_rcu.c
+ *
+ * Userspace RCU library - test call_rcu() batches waiting for grace
+ * periods in flight
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <time.h>
+#include <urcu.h>
+
+#define CB_BATCHES		200
+#define CB_PER_BATCH		8
+#define CB_TOTAL		(CB_BATCHES * CB_PER_BATCH)
+/* The reader holds grace periods this long, the updater queues faster. */
+#define CB_READER_HOLD_MS	5
+#define CB_QUEUE_DELAY_MS	1
+/* Time the grace period has to start waiting for the reader. */
+#define CB_GP_DELAY_MS		50
+#define CB_TIMEOUT_MS		10000
+
+struct test_cb {
+	struct rcu_head head;
+	unsigned long cookie;	/* Taken before call_rcu(). */
+	unsigned long index;	/* Order of call_rcu(). */
+};
+
+static struct test_cb cbs[CB_TOTAL];
+static unsigned long nr_invoked;
+static sem_t reader_locked, reader_release;
+static int reader_stop;
+
+static void fail(const char *msg)
+{
+	fprintf(stderr, "test_urcu_call_rcu: %s\n", msg);
+	exit(EXIT_FAILURE);
+}
+
+static unsigned long now_ms(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts))
+		fail("clock_gettime");
+	return ts.tv_sec * 1000UL + ts.tv_nsec / 1000000;
+}
+
+static void take(sem_t *sem)
+{
+	while (sem_wait(sem))
+		if (errno != EINTR)
+			fail("sem_wait");
+}
+
+static void give(sem_t *sem)
+{
+	if (sem_post(sem))
+		fail("sem_post");
+}
+
+/* Called by the call_rcu thread, which invokes the callbacks in turn. */
+static void cb_func(struct rcu_head *head)
+{
+	struct test_cb *cb = caa_container_of(head, struct test_cb, head);
+
+	if (!poll_state_synchronize_rcu(cb->cookie))
+		fail("callback invoked before its grace period completed");
+	if (cb->index != nr_invoked)
+		fail("callbacks invoked out of order");
+	CMM_STORE_SHARED(nr_invoked, nr_invoked + 1);
+}
+
+static void queue_batch(unsigned long batch)
+{
+	unsigned long cookie, i;
+
+	cookie = get_state_synchronize_rcu();
+	for (i = batch * CB_PER_BATCH; i < (batch + 1) * CB_PER_BATCH; i++) {
+		cbs[i].cookie = cookie;
+		cbs[i].index = i;
+		call_rcu(&cbs[i].head, cb_func);
+	}
+}
+
+static void wait_invoked(unsigned long nr)
+{
+	unsigned long start;
+
+	for (start = now_ms(); CMM_LOAD_SHARED(nr_invoked) < nr;) {
+		if (now_ms() - start > CB_TIMEOUT_MS)
+			fail("callbacks not invoked");
+		(void) poll(NULL, 0, 10);
+	}
+}
+
+/*
+ * Number of distinct grace periods awaited by the batches queued before
+ * "batch" and not invoked yet.
+ */
+static unsigned int nr_gp_in_flight(unsigned long batch)
+{
+	unsigned long i, last = 0;
+	unsigned int nr = 0;
+
+	for (i = CMM_LOAD_SHARED(nr_invoked) / CB_PER_BATCH; i < batch; i++) {
+		if (nr && cbs[i * CB_PER_BATCH].cookie == last)
+			continue;
+		last = cbs[i * CB_PER_BATCH].cookie;
+		nr++;
+	}
+	return nr;
+}
+
+/* Reader holding one critical section until released. */
+static void *thr_reader_held(void *arg)
+{
+	rcu_register_thread();
+	rcu_read_lock();
+	give(&reader_locked);
+	take(&reader_release);
+	rcu_read_unlock();
+	rcu_unregister_thread();
+	return NULL;
+}
+
+/* Reader keeping grace periods in flight until stopped. */
+static void *thr_reader_loop(void *arg)
+{
+	rcu_register_thread();
+	while (!CMM_LOAD_SHARED(reader_stop)) {
+		rcu_read_lock();
+		(void) poll(NULL, 0, CB_READER_HOLD_MS);
+		rcu_read_unlock();
+	}
+	rcu_unregister_thread();
+	return NULL;
+}
+
+/*
+ * While a reader holds the grace period of the first batch, a second
+ * batch queued needs a later grace period. Neither may be invoked until
+ * the reader leaves.
+ */
+static void test_held(void)
+{
+	pthread_t reader;
+	unsigned long start;
+
+	if (pthread_create(&reader, NULL, thr_reader_held, NULL))
+		fail("pthread_create");
+	take(&reader_locked);
+	queue_batch(0);
+	for (start = now_ms();
+			get_state_synchronize_rcu() == cbs[0].cookie;) {
+		if (now_ms() - start > CB_TIMEOUT_MS)
+			fail("grace period not started");
+		(void) poll(NULL, 0, 10);
+	}
+	queue_batch(1);
+	if (cbs[CB_PER_BATCH].cookie == cbs[0].cookie)
+		fail("batch queued during a grace period shares it");
+	(void) poll(NULL, 0, CB_GP_DELAY_MS);
+	if (CMM_LOAD_SHARED(nr_invoked))
+		fail("callbacks invoked while a reader holds the grace period");
+	if (poll_state_synchronize_rcu(cbs[0].cookie)
+			|| poll_state_synchronize_rcu(cbs[CB_PER_BATCH].cookie))
+		fail("grace period completed while a reader holds it");
+	give(&reader_release);
+	wait_invoked(2 * CB_PER_BATCH);
+	if (pthread_join(reader, NULL))
+		fail("pthread_join");
+}
+
+/*
+ * Queue batches faster than grace periods complete: several of them
+ * must be in flight at once.
+ */
+static void test_in_flight(void)
+{
+	pthread_t reader;
+	unsigned int max_in_flight = 0, nr;
+	unsigned long batch;
+
+	if (pthread_create(&reader, NULL, thr_reader_loop, NULL))
+		fail("pthread_create");
+	for (batch = 2; batch < CB_BATCHES; batch++) {
+		nr = nr_gp_in_flight(batch);
+		if (nr > max_in_flight)
+			max_in_flight = nr;
+		queue_batch(batch);
+		(void) poll(NULL, 0, CB_QUEUE_DELAY_MS);
+	}
+	wait_invoked(CB_TOTAL);
+	CMM_STORE_SHARED(reader_stop, 1);
+	if (pthread_join(reader, NULL))
+		fail("pthread_join");
+	if (max_in_flight < 2)
+		fail("batches never waited for distinct grace periods");
+}
+
+int main(int argc, char **argv)
+{
+	if (sem_init(&reader_locked, 0, 0) || sem_init(&reader_release, 0, 0))
+		fail("sem_init");
+	rcu_register_thread();
+	test_held();
+	test_in_flight();
+	rcu_unregister_thread();
+	(void) sem_destroy(&reader_locked);
+	(void) sem_destroy(&reader_release);
+	printf("test_urcu_call_rcu: OK\n");
+	exit(EXIT_SUCCESS);
+}
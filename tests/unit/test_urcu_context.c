@@ -0,0 +1,277 @@
+/*
+ * test_urcu_context.c
+ *
+ * Userspace RCU library - test reader contexts moving between threads
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <urcu.h>
+
+/* Time the grace period has to start waiting for the context. */
+#define CONTEXT_GP_DELAY_MS	50
+#define CONTEXT_TIMEOUT_MS	10000
+/* Moves of the critical section between threads during a grace period. */
+#define CONTEXT_MOVES		1000000
+
+/* Threads switching the "fiber" of the context in and out in turn. */
+struct fiber_thread {
+	pthread_t tid;
+	sem_t turn;
+	struct fiber_thread *next;
+};
+
+static struct rcu_reader *ctx;
+static struct fiber_thread threads[3], *holder;
+static sem_t main_turn;
+static int gp_done, moves_done;
+static unsigned long nr_moves;
+
+static void fail(const char *msg)
+{
+	fprintf(stderr, "test_urcu_context: %s\n", msg);
+	exit(EXIT_FAILURE);
+}
+
+static unsigned long now_ms(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts))
+		fail("clock_gettime");
+	return ts.tv_sec * 1000UL + ts.tv_nsec / 1000000;
+}
+
+static void take_turn(sem_t *turn)
+{
+	while (sem_wait(turn))
+		if (errno != EINTR)
+			fail("sem_wait");
+}
+
+static void give_turn(sem_t *turn)
+{
+	if (sem_post(turn))
+		fail("sem_post");
+}
+
+/*
+ * Thread 0 enters the read-side critical section of the context. It
+ * then moves between threads 1 and 2, each handing over to the other,
+ * "nr_moves" times. The last thread it is attached to becomes "holder",
+ * and leaves it when given its turn again.
+ */
+static void *thr_fiber(void *arg)
+{
+	struct fiber_thread *thread = arg;
+
+	rcu_register_thread();
+	if (thread == &threads[0]) {
+		take_turn(&thread->turn);
+		rcu_context_attach(ctx);
+		rcu_read_lock();
+		rcu_context_detach(ctx);
+		if (rcu_read_ongoing())
+			fail("read-side critical section not detached");
+		give_turn(&main_turn);
+		goto end;
+	}
+	for (;;) {
+		take_turn(&thread->turn);
+		if (moves_done)
+			break;
+		rcu_context_attach(ctx);
+		if (!rcu_read_ongoing())
+			fail("read-side critical section not attached");
+		if (!nr_moves--)
+			break;
+		rcu_context_detach(ctx);
+		give_turn(&thread->next->turn);
+	}
+	if (!moves_done) {
+		moves_done = 1;
+		holder = thread;
+		give_turn(&thread->next->turn);
+		give_turn(&main_turn);
+		take_turn(&thread->turn);
+		rcu_read_unlock();
+		rcu_context_detach(ctx);
+	}
+end:
+	rcu_unregister_thread();
+	return NULL;
+}
+
+/*
+ * With "arg" set, the grace period keeps scanning the readers rather
+ * than sleeping until one leaves its critical section, so that it scans
+ * them while the critical section moves, and may miss it if it ignores
+ * migrate_seq.
+ */
+static void *thr_updater(void *arg)
+{
+	rcu_register_thread();
+	if (arg)
+		(void) synchronize_rcu_expedited();
+	else
+		synchronize_rcu();
+	CMM_STORE_SHARED(gp_done, 1);
+	rcu_unregister_thread();
+	return NULL;
+}
+
+static void wait_gp_done(void)
+{
+	unsigned long start;
+
+	for (start = now_ms(); !CMM_LOAD_SHARED(gp_done);) {
+		if (now_ms() - start > CONTEXT_TIMEOUT_MS)
+			fail("grace period did not complete");
+		(void) poll(NULL, 0, 10);
+	}
+}
+
+/*
+ * Enter the critical section on thread 0 and start a grace period,
+ * which must wait while the critical section is detached, moves "moves"
+ * times between threads 1 and 2, then complete once left.
+ */
+static void test_move(unsigned long moves)
+{
+	pthread_t updater;
+	int i;
+
+	nr_moves = moves;
+	moves_done = 0;
+	CMM_STORE_SHARED(gp_done, 0);
+	if (sem_init(&main_turn, 0, 0))
+		fail("sem_init");
+	for (i = 0; i < 3; i++) {
+		if (sem_init(&threads[i].turn, 0, 0))
+			fail("sem_init");
+		threads[i].next = &threads[i == 1 ? 2 : 1];
+		if (pthread_create(&threads[i].tid, NULL, thr_fiber,
+				&threads[i]))
+			fail("pthread_create");
+	}
+	give_turn(&threads[0].turn);
+	take_turn(&main_turn);
+	if (pthread_create(&updater, NULL, thr_updater, &updater))
+		fail("pthread_create");
+	(void) poll(NULL, 0, CONTEXT_GP_DELAY_MS);
+	if (CMM_LOAD_SHARED(gp_done))
+		fail("grace period did not wait for a detached context");
+	give_turn(&threads[1].turn);
+	take_turn(&main_turn);
+	if (CMM_LOAD_SHARED(gp_done))
+		fail("grace period did not wait for a moved context");
+	give_turn(&holder->turn);
+	wait_gp_done();
+	for (i = 0; i < 3; i++) {
+		if (pthread_join(threads[i].tid, NULL))
+			fail("pthread_join");
+		(void) sem_destroy(&threads[i].turn);
+	}
+	if (pthread_join(updater, NULL))
+		fail("pthread_join");
+	(void) sem_destroy(&main_turn);
+}
+
+/*
+ * A context left while a grace period waits for it may be destroyed
+ * before the grace period sees it quiescent.
+ */
+static void test_destroy_waited(void)
+{
+	struct rcu_reader *waited;
+	pthread_t updater;
+
+	waited = rcu_context_create();
+	if (!waited)
+		fail("rcu_context_create");
+	rcu_context_attach(waited);
+	rcu_read_lock();
+	rcu_context_detach(waited);
+	CMM_STORE_SHARED(gp_done, 0);
+	if (pthread_create(&updater, NULL, thr_updater, NULL))
+		fail("pthread_create");
+	(void) poll(NULL, 0, CONTEXT_GP_DELAY_MS);
+	if (CMM_LOAD_SHARED(gp_done))
+		fail("grace period did not wait for a detached context");
+	rcu_context_attach(waited);
+	rcu_read_unlock();
+	rcu_context_detach(waited);
+	rcu_context_destroy(waited);
+	wait_gp_done();
+	if (pthread_join(updater, NULL))
+		fail("pthread_join");
+}
+
+#ifndef NDEBUG
+/* Destroying a context within a critical section is caught. */
+static void test_destroy_active(void)
+{
+	int status;
+	pid_t pid;
+
+	pid = fork();
+	if (pid < 0)
+		fail("fork");
+	if (!pid) {
+		/* Do not clutter the test output with the assertion. */
+		if (!freopen("/dev/null", "w", stderr))
+			_exit(EXIT_FAILURE);
+		rcu_context_attach(ctx);
+		rcu_read_lock();
+		rcu_context_detach(ctx);
+		rcu_context_destroy(ctx);
+		_exit(EXIT_SUCCESS);
+	}
+	if (waitpid(pid, &status, 0) != pid)
+		fail("waitpid");
+	if (!WIFSIGNALED(status) || WTERMSIG(status) != SIGABRT)
+		fail("active context destroyed");
+}
+#endif
+
+int main(int argc, char **argv)
+{
+	rcu_register_thread();
+	ctx = rcu_context_create();
+	if (!ctx)
+		fail("rcu_context_create");
+	test_move(0);
+	test_move(CONTEXT_MOVES);
+	test_destroy_waited();
+#ifndef NDEBUG
+	test_destroy_active();
+#endif
+	rcu_context_destroy(ctx);
+	rcu_unregister_thread();
+	printf("test_urcu_context: OK\n");
+	exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,205 @@
+/*
+ * test_urcu_domain.c
+ *
+ * Userspace RCU library - test that grace periods of a domain only wait
+ * for the readers of this domain
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <time.h>
+#ifdef TEST_QSBR
+#include <urcu-qsbr.h>
+#define TEST_NAME	"test_urcu_domain_qsbr"
+#else
+#include <urcu.h>
+#define TEST_NAME	"test_urcu_domain"
+#endif
+
+/* Time a grace period has to start waiting for the reader. */
+#define DOMAIN_GP_DELAY_MS	50
+#define DOMAIN_TIMEOUT_MS	10000
+
+static struct rcu_domain *domain_a, *domain_b;
+static sem_t reader_locked, reader_release, reader_done;
+
+static void fail(const char *msg)
+{
+	fprintf(stderr, TEST_NAME ": %s\n", msg);
+	exit(EXIT_FAILURE);
+}
+
+static unsigned long now_ms(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts))
+		fail("clock_gettime");
+	return ts.tv_sec * 1000UL + ts.tv_nsec / 1000000;
+}
+
+static void take(sem_t *sem)
+{
+	while (sem_wait(sem))
+		if (errno != EINTR)
+			fail("sem_wait");
+}
+
+static void give(sem_t *sem)
+{
+	if (sem_post(sem))
+		fail("sem_post");
+}
+
+/*
+ * Reader registered to the default domain and to both domains, quiescent
+ * in all but domain A, where it stays in a read-side critical section
+ * (for QSBR: online without announcing a quiescent state) until released.
+ */
+static void *thr_reader(void *arg)
+{
+	struct rcu_reader *reader_a, *reader_b;
+
+	rcu_register_thread();
+	reader_a = rcu_domain_register_thread(domain_a);
+	reader_b = rcu_domain_register_thread(domain_b);
+	if (!reader_a || !reader_b)
+		fail("rcu_domain_register_thread");
+#ifdef TEST_QSBR
+	rcu_thread_offline();
+	rcu_domain_thread_offline(domain_b, reader_b);
+#endif
+	rcu_domain_read_lock(domain_a, reader_a);
+	if (!rcu_domain_read_ongoing(reader_a))
+		fail("domain read-side critical section not entered");
+	if (rcu_read_ongoing())
+		fail("domain read-side critical section entered the default "
+			"domain");
+	give(&reader_locked);
+	take(&reader_release);
+	rcu_domain_read_unlock(domain_a, reader_a);
+#ifdef TEST_QSBR
+	rcu_domain_thread_offline(domain_a, reader_a);
+#endif
+	take(&reader_done);
+#ifdef TEST_QSBR
+	rcu_domain_thread_online(domain_a, reader_a);
+	rcu_domain_thread_online(domain_b, reader_b);
+	rcu_thread_online();
+#endif
+	rcu_domain_unregister_thread(domain_b, reader_b);
+	rcu_domain_unregister_thread(domain_a, reader_a);
+	rcu_unregister_thread();
+	return NULL;
+}
+
+struct gp {
+	pthread_t tid;
+	struct rcu_domain *domain;	/* NULL for the default domain. */
+	int done;
+};
+
+static void *thr_gp(void *arg)
+{
+	struct gp *gp = arg;
+
+	if (gp->domain)
+		rcu_domain_synchronize(gp->domain);
+	else
+		synchronize_rcu();
+	CMM_STORE_SHARED(gp->done, 1);
+	return NULL;
+}
+
+static void start_gp(struct gp *gp, struct rcu_domain *domain)
+{
+	gp->domain = domain;
+	gp->done = 0;
+	if (pthread_create(&gp->tid, NULL, thr_gp, gp))
+		fail("pthread_create");
+}
+
+static void wait_gp(struct gp *gp, const char *msg)
+{
+	unsigned long start;
+
+	for (start = now_ms(); !CMM_LOAD_SHARED(gp->done);) {
+		if (now_ms() - start > DOMAIN_TIMEOUT_MS)
+			fail(msg);
+		(void) poll(NULL, 0, 10);
+	}
+	if (pthread_join(gp->tid, NULL))
+		fail("pthread_join");
+}
+
+int main(int argc, char **argv)
+{
+	struct gp gp_a, gp_b, gp_default;
+	pthread_t reader;
+
+	domain_a = rcu_domain_create();
+	domain_b = rcu_domain_create();
+	if (!domain_a || !domain_b)
+		fail("rcu_domain_create");
+	if (sem_init(&reader_locked, 0, 0) || sem_init(&reader_release, 0, 0)
+			|| sem_init(&reader_done, 0, 0))
+		fail("sem_init");
+	if (pthread_create(&reader, NULL, thr_reader, NULL))
+		fail("pthread_create");
+	take(&reader_locked);
+
+	/* The reader of domain A delays neither domain B nor the default. */
+	start_gp(&gp_a, domain_a);
+	start_gp(&gp_b, domain_b);
+	wait_gp(&gp_b, "grace period of domain B waited for domain A");
+	start_gp(&gp_default, NULL);
+	wait_gp(&gp_default,
+		"grace period of the default domain waited for domain A");
+
+	/* Domain A waits for it, until it leaves. */
+	(void) poll(NULL, 0, DOMAIN_GP_DELAY_MS);
+	if (CMM_LOAD_SHARED(gp_a.done))
+		fail("grace period of domain A did not wait for its reader");
+	give(&reader_release);
+	wait_gp(&gp_a, "grace period of domain A did not complete");
+
+	/* Once the reader is quiescent everywhere, all of them complete. */
+	start_gp(&gp_a, domain_a);
+	start_gp(&gp_b, domain_b);
+	start_gp(&gp_default, NULL);
+	wait_gp(&gp_a, "grace period of domain A did not complete");
+	wait_gp(&gp_b, "grace period of domain B did not complete");
+	wait_gp(&gp_default, "grace period of the default domain did not "
+		"complete");
+
+	give(&reader_done);
+	if (pthread_join(reader, NULL))
+		fail("pthread_join");
+	if (rcu_domain_destroy(domain_a) || rcu_domain_destroy(domain_b))
+		fail("rcu_domain_destroy");
+	(void) sem_destroy(&reader_locked);
+	(void) sem_destroy(&reader_release);
+	(void) sem_destroy(&reader_done);
+	printf(TEST_NAME ": OK\n");
+	exit(EXIT_SUCCESS);
+}
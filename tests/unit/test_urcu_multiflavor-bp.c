@@ -25,15 +25,43 @@
 #endif
 
 #define RCU_SIGNAL
+#include <errno.h>
+#include <sched.h>
 #include <urcu-bp.h>
 #include "test_urcu_multiflavor.h"
 
+DEFINE_TEST_MF_FLAVOR(test_mf_flavor_bp, "bp", 0);
+
 int test_mf_bp(void)
 {
+	unsigned long cookie;
+	struct rcu_reader_info info;
+
 	rcu_register_thread();
 	rcu_read_lock();
 	rcu_read_unlock();
 	synchronize_rcu();
+	cookie = start_poll_synchronize_rcu();
+	synchronize_rcu();
+	if (!poll_state_synchronize_rcu(cookie))
+		return -1;
+	cond_synchronize_rcu(cookie);
+	cond_synchronize_rcu(get_state_synchronize_rcu());
+	synchronize_rcu_expedited();
+	if (rcu_get_readers(&info, 1) < 1)
+		return -1;
+	if (rcu_set_gp_scan_threads(2))
+		return -1;
+	synchronize_rcu();
+	if (rcu_set_gp_scan_threads(0))
+		return -1;
+	if (rcu_set_reader_boost(1000, SCHED_FIFO, 1))
+		return -1;
+	synchronize_rcu();
+	if (rcu_set_reader_boost(1000, SCHED_FIFO, -1) != -EINVAL)
+		return -1;
+	if (rcu_set_reader_boost(0, SCHED_OTHER, 0))
+		return -1;
 	rcu_unregister_thread();
 	return 0;
 }
@@ -24,15 +24,116 @@
 #define _LGPL_SOURCE
 #endif
 
+#include <errno.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
 #include <urcu.h>
 #include "test_urcu_multiflavor.h"
 
+DEFINE_TEST_MF_FLAVOR(test_mf_flavor_memb, "memb", 1);
+
 int test_mf_memb(void)
 {
+	unsigned long cookie;
+	struct rcu_reader_info info;
+	struct rcu_domain *domain;
+	struct rcu_reader *reader;
+	void *shm;
+	pid_t pid;
+	int status;
+	struct rcu_reader *ctx;
+
+	if (rcu_get_membarrier_mode() > RCU_MEMBARRIER_MODE_PRIVATE_EXPEDITED)
+		return -1;
 	rcu_register_thread();
 	rcu_read_lock();
 	rcu_read_unlock();
 	synchronize_rcu();
+	cookie = start_poll_synchronize_rcu();
+	synchronize_rcu();
+	if (!poll_state_synchronize_rcu(cookie))
+		return -1;
+	cond_synchronize_rcu(cookie);
+	cond_synchronize_rcu(get_state_synchronize_rcu());
+	synchronize_rcu_expedited();
+	if (rcu_get_readers(&info, 1) < 1)
+		return -1;
+	if (rcu_set_gp_scan_threads(2))
+		return -1;
+	synchronize_rcu();
+	if (rcu_set_gp_scan_threads(0))
+		return -1;
+	if (rcu_set_reader_boost(1000, SCHED_FIFO, 1))
+		return -1;
+	synchronize_rcu();
+	if (rcu_set_reader_boost(1000, SCHED_FIFO, -1) != -EINVAL)
+		return -1;
+	if (rcu_set_reader_boost(0, SCHED_OTHER, 0))
+		return -1;
+	domain = rcu_domain_create();
+	if (!domain)
+		return -1;
+	reader = rcu_domain_register_thread(domain);
+	if (!reader)
+		return -1;
+	rcu_domain_read_lock(domain, reader);
+	rcu_domain_read_unlock(domain, reader);
+	rcu_domain_synchronize(domain);
+	if (rcu_domain_destroy(domain) != -EBUSY)
+		return -1;
+	rcu_domain_unregister_thread(domain, reader);
+	if (rcu_domain_destroy(domain))
+		return -1;
+	shm = mmap(NULL, rcu_domain_shared_size(1), PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (shm == MAP_FAILED)
+		return -1;
+	if (rcu_domain_shared_init(shm, 1))
+		return -1;
+	domain = rcu_domain_shared_open(shm);
+	if (!domain)
+		return -1;
+	reader = rcu_domain_register_thread(domain);
+	if (!reader || rcu_domain_register_thread(domain))
+		return -1;
+	rcu_domain_read_lock(domain, reader);
+	rcu_domain_read_unlock(domain, reader);
+	rcu_domain_synchronize(domain);
+	rcu_domain_unregister_thread(domain, reader);
+	/* The slot of a process terminating in a reader is reclaimed. */
+	pid = fork();
+	if (pid < 0)
+		return -1;
+	if (!pid) {
+		reader = rcu_domain_register_thread(domain);
+		if (reader)
+			rcu_domain_read_lock(domain, reader);
+		_exit(!reader);
+	}
+	if (waitpid(pid, &status, 0) != pid || status)
+		return -1;
+	rcu_domain_synchronize(domain);
+	reader = rcu_domain_register_thread(domain);
+	if (!reader)
+		return -1;
+	rcu_domain_unregister_thread(domain, reader);
+	if (rcu_domain_destroy(domain))
+		return -1;
+	(void) munmap(shm, rcu_domain_shared_size(1));
+	ctx = rcu_context_create();
+	if (!ctx)
+		return -1;
+	rcu_read_lock();
+	rcu_context_detach(ctx);
+	if (rcu_read_ongoing())
+		return -1;
+	rcu_context_attach(ctx);
+	if (!rcu_read_ongoing())
+		return -1;
+	rcu_read_unlock();
+	rcu_context_destroy(ctx);
 	rcu_unregister_thread();
 	return 0;
 }
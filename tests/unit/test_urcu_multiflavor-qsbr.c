@@ -24,15 +24,75 @@
 #define _LGPL_SOURCE
 #endif
 
+#include <errno.h>
+#include <sched.h>
 #include <urcu-qsbr.h>
 #include "test_urcu_multiflavor.h"
 
+DEFINE_TEST_MF_FLAVOR(test_mf_flavor_qsbr, "qsbr", 1);
+
 int test_mf_qsbr(void)
 {
+	unsigned long cookie;
+	struct rcu_reader_info info;
+	struct rcu_domain *domain;
+	struct rcu_reader *reader;
+	int ret;
+
 	rcu_register_thread();
 	rcu_read_lock();
 	rcu_read_unlock();
 	synchronize_rcu();
+	cookie = start_poll_synchronize_rcu();
+	synchronize_rcu();
+	if (!poll_state_synchronize_rcu(cookie))
+		return -1;
+	cond_synchronize_rcu(cookie);
+	cond_synchronize_rcu(get_state_synchronize_rcu());
+	synchronize_rcu_expedited();
+	rcu_thread_offline();
+	if (rcu_get_readers(&info, 1) < 1)
+		return -1;
+	rcu_thread_online();
+	if (rcu_set_gp_scan_threads(2))
+		return -1;
+	synchronize_rcu();
+	if (rcu_set_gp_scan_threads(0))
+		return -1;
+	if (rcu_set_reader_boost(1000, SCHED_FIFO, 1))
+		return -1;
+	synchronize_rcu();
+	if (rcu_set_reader_boost(1000, SCHED_FIFO, -1) != -EINVAL)
+		return -1;
+	if (rcu_set_reader_boost(0, SCHED_OTHER, 0))
+		return -1;
+	domain = rcu_domain_create();
+	if (!domain)
+		return -1;
+	reader = rcu_domain_register_thread(domain);
+	if (!reader)
+		return -1;
+	rcu_domain_read_lock(domain, reader);
+	rcu_domain_read_unlock(domain, reader);
+	rcu_domain_quiescent_state(domain, reader);
+	rcu_domain_thread_offline(domain, reader);
+	rcu_domain_synchronize(domain);
+	rcu_domain_thread_online(domain, reader);
+	if (rcu_domain_destroy(domain) != -EBUSY)
+		return -1;
+	rcu_domain_unregister_thread(domain, reader);
+	if (rcu_domain_destroy(domain))
+		return -1;
+	ret = rcu_thread_set_lazy_offline(1);
+	if (ret && ret != -ENOSYS)
+		return -1;
+	rcu_thread_offline();
+	synchronize_rcu();
+	rcu_thread_online();
+	synchronize_rcu();
+	if (rcu_thread_set_lazy_offline(0))
+		return -1;
+	rcu_context_switch();
 	rcu_unregister_thread();
 	return 0;
 }
@@ -20,11 +20,279 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <urcu/arch.h>
+#include <urcu/system.h>
+#include <urcu/uatomic.h>
+#include <urcu/gp-stats.h>
+#include <urcu-call-rcu.h>
+#include <urcu-flavor.h>
 #include "test_urcu_multiflavor.h"
 
+/* Time a grace period has to start waiting for a reader. */
+#define TEST_MF_GP_DELAY_MS	20
+#define TEST_MF_TIMEOUT_MS	10000
+/* Concurrent synchronize_rcu() callers while a reader is held. */
+#define TEST_MF_NR_UPDATERS	3
+/* Grace periods performed without readers. */
+#define TEST_MF_NR_GP		4
+/* Latency bucket of TEST_MF_GP_DELAY_MS, in microseconds (2^14). */
+#define TEST_MF_LATENCY_BUCKET	14
+
+static const struct test_mf_flavor *test_mf_flavors[] = {
+	&test_mf_flavor_memb,
+	&test_mf_flavor_mb,
+	&test_mf_flavor_signal,
+	&test_mf_flavor_qsbr,
+	&test_mf_flavor_bp,
+	&test_mf_flavor_percpu,
+};
+
+/* Reader of the flavor under test, held by test_mf_gp_waits(). */
+static const struct test_mf_flavor *test_mf_flavor;
+static pthread_t test_mf_reader;
+static sem_t test_mf_reader_locked, test_mf_reader_release;
+static int test_mf_gp_done;
+
+static void *test_mf_thr_reader(void *arg)
+{
+	test_mf_flavor->rcu->register_thread();
+	test_mf_flavor->rcu->read_lock();
+	(void) sem_post(&test_mf_reader_locked);
+	while (sem_wait(&test_mf_reader_release))
+		;
+	test_mf_flavor->rcu->read_unlock();
+	/* QSBR readers are online until they unregister. */
+	test_mf_flavor->rcu->unregister_thread();
+	return NULL;
+}
+
+static void *test_mf_thr_updater(void *arg)
+{
+	test_mf_flavor->rcu->update_synchronize_rcu();
+	uatomic_inc(&test_mf_gp_done);
+	return NULL;
+}
+
+/*
+ * Start "nr_updaters" concurrent grace periods while a reader of
+ * "flavor" is in a read-side critical section for at least
+ * TEST_MF_GP_DELAY_MS, and return whether they waited for it.
+ */
+static int test_mf_gp_waits(const struct test_mf_flavor *flavor,
+		int nr_updaters)
+{
+	pthread_t updaters[TEST_MF_NR_UPDATERS];
+	int i, waited;
+
+	test_mf_flavor = flavor;
+	test_mf_gp_done = 0;
+	if (sem_init(&test_mf_reader_locked, 0, 0)
+			|| sem_init(&test_mf_reader_release, 0, 0))
+		return 0;
+	if (pthread_create(&test_mf_reader, NULL, test_mf_thr_reader, NULL))
+		return 0;
+	while (sem_wait(&test_mf_reader_locked))
+		;
+	for (i = 0; i < nr_updaters; i++)
+		if (pthread_create(&updaters[i], NULL, test_mf_thr_updater,
+				NULL))
+			return 0;
+	(void) poll(NULL, 0, TEST_MF_GP_DELAY_MS);
+	waited = !uatomic_read(&test_mf_gp_done);
+	(void) sem_post(&test_mf_reader_release);
+	for (i = 0; i < nr_updaters; i++)
+		if (pthread_join(updaters[i], NULL))
+			return 0;
+	if (pthread_join(test_mf_reader, NULL))
+		return 0;
+	(void) sem_destroy(&test_mf_reader_locked);
+	(void) sem_destroy(&test_mf_reader_release);
+	return waited && uatomic_read(&test_mf_gp_done) == nr_updaters;
+}
+
+/* Grace periods wait for readers whatever the wait mode. */
+static int test_mf_wait_mode(const struct test_mf_flavor *flavor)
+{
+	static const enum rcu_wait_mode modes[] = {
+		RCU_WAIT_MODE_EFFICIENCY,
+		RCU_WAIT_MODE_LATENCY,
+		RCU_WAIT_MODE_ADAPTIVE,
+	};
+	unsigned int i;
+
+	if (flavor->set_wait_mode((enum rcu_wait_mode) -1) != -EINVAL)
+		return -1;
+	for (i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+		if (flavor->set_wait_mode(modes[i]))
+			return -1;
+		if (!test_mf_gp_waits(flavor, 1))
+			return -1;
+	}
+	return 0;
+}
+
+static unsigned long test_mf_nr_latency(const struct rcu_gp_stats *stats,
+		unsigned int from_bucket)
+{
+	unsigned long nr = 0;
+	unsigned int i;
+
+	for (i = from_bucket; i < RCU_GP_STATS_NR_BUCKETS; i++)
+		nr += stats->latency[i];
+	return nr;
+}
+
+/*
+ * Statistics count the grace periods executed, the calls which shared
+ * them, and the duration of each call, from a reset.
+ */
+static int test_mf_gp_stats(const struct test_mf_flavor *flavor)
+{
+	struct rcu_gp_stats stats;
+	int i;
+
+	flavor->reset_gp_stats();
+	flavor->get_gp_stats(&stats);
+	if (stats.nr_gp || stats.nr_piggyback || stats.nr_readers_scanned
+			|| stats.nr_sleeps || test_mf_nr_latency(&stats, 0))
+		return -1;
+
+	/* Without readers, each call executes its own grace period. */
+	for (i = 0; i < TEST_MF_NR_GP; i++)
+		flavor->rcu->update_synchronize_rcu();
+	flavor->get_gp_stats(&stats);
+	if (stats.nr_gp != TEST_MF_NR_GP || stats.nr_piggyback
+			|| test_mf_nr_latency(&stats, 0) != TEST_MF_NR_GP)
+		return -1;
+
+	/*
+	 * A grace period sleeping while it waits for a reader lasts at
+	 * least TEST_MF_GP_DELAY_MS.
+	 */
+	flavor->reset_gp_stats();
+	if (flavor->set_wait_mode(RCU_WAIT_MODE_EFFICIENCY))
+		return -1;
+	if (!test_mf_gp_waits(flavor, 1))
+		return -1;
+	if (flavor->set_wait_mode(RCU_WAIT_MODE_ADAPTIVE))
+		return -1;
+	flavor->get_gp_stats(&stats);
+	if (stats.nr_gp != 1 || stats.nr_piggyback || !stats.nr_sleeps
+			|| !stats.nr_readers_scanned)
+		return -1;
+	if (test_mf_nr_latency(&stats, 0) != 1
+			|| test_mf_nr_latency(&stats, TEST_MF_LATENCY_BUCKET) != 1)
+		return -1;
+
+	/*
+	 * Callers queued behind the grace period held by the reader share
+	 * the following one, where grace periods are batched.
+	 */
+	flavor->reset_gp_stats();
+	if (!test_mf_gp_waits(flavor, TEST_MF_NR_UPDATERS))
+		return -1;
+	flavor->get_gp_stats(&stats);
+	if (stats.nr_gp + stats.nr_piggyback != TEST_MF_NR_UPDATERS
+			|| test_mf_nr_latency(&stats, 0) != TEST_MF_NR_UPDATERS)
+		return -1;
+	if (flavor->gp_batching ? !stats.nr_piggyback : stats.nr_piggyback)
+		return -1;
+	return 0;
+}
+
+/* Outlives a failed check, which leaves the callback queued. */
+static struct rcu_head test_mf_head;
+static pthread_t test_mf_cb_thread;
+static int test_mf_cb_done;
+
+static void test_mf_cb(struct rcu_head *head)
+{
+	test_mf_cb_thread = pthread_self();
+	test_mf_cb_done = 1;
+}
+
+/*
+ * Only handles without a helper thread have an eventfd. A callback
+ * queued on a threadless handle is invoked by its owner, once the
+ * eventfd tells that its grace period has completed.
+ */
+static int test_mf_threadless(const struct test_mf_flavor *flavor)
+{
+	struct call_rcu_data *crdp;
+	struct pollfd pfd = {
+		.events = POLLIN,
+	};
+	unsigned long nr = 0;
+	int ready, ret = -1;
+
+	flavor->rcu->register_thread();
+	crdp = flavor->create_call_rcu_data(0, -1);
+	if (!crdp || flavor->get_call_rcu_eventfd(crdp) != -1)
+		goto end;
+	flavor->call_rcu_data_free(crdp);
+	crdp = flavor->create_call_rcu_data(URCU_CALL_RCU_THREADLESS, -1);
+	if (!crdp) {
+		if (errno == ENOSYS)
+			ret = 0;
+		goto end;
+	}
+	pfd.fd = flavor->get_call_rcu_eventfd(crdp);
+	if (pfd.fd < 0)
+		goto free;
+	test_mf_cb_done = 0;
+	flavor->set_thread_call_rcu_data(crdp);
+	flavor->rcu->update_call_rcu(&test_mf_head, test_mf_cb);
+	flavor->set_thread_call_rcu_data(NULL);
+	while (!test_mf_cb_done) {
+		/* QSBR readers must not hold up the grace period. */
+		flavor->rcu->thread_offline();
+		do {
+			ready = poll(&pfd, 1, TEST_MF_TIMEOUT_MS);
+		} while (ready < 0 && errno == EINTR);
+		flavor->rcu->thread_online();
+		if (ready <= 0)
+			goto free;
+		nr += flavor->process_callbacks(crdp, 1);
+	}
+	if (nr == 1 && pthread_equal(test_mf_cb_thread, pthread_self()))
+		ret = 0;
+free:
+	flavor->call_rcu_data_free(crdp);
+end:
+	flavor->rcu->unregister_thread();
+	return ret;
+}
+
+/* Checks of the features common to all flavors. */
+static int test_mf_shared(const struct test_mf_flavor *flavor)
+{
+	if (test_mf_wait_mode(flavor)) {
+		fprintf(stderr, "test_urcu_multiflavor: %s: wait mode\n",
+			flavor->name);
+		return -1;
+	}
+	if (test_mf_gp_stats(flavor)) {
+		fprintf(stderr, "test_urcu_multiflavor: %s: grace period "
+			"statistics\n", flavor->name);
+		return -1;
+	}
+	if (test_mf_threadless(flavor)) {
+		fprintf(stderr, "test_urcu_multiflavor: %s: threadless "
+			"call_rcu\n", flavor->name);
+		return -1;
+	}
+	return 0;
+}
+
 int main(int argc, char **argv)
 {
+	unsigned int i;
 	int ret;
 
 	ret = test_mf_memb();
@@ -42,6 +310,15 @@ int main(int argc, char **argv)
 	ret = test_mf_bp();
 	if (ret)
 		goto failure;
+	ret = test_mf_percpu();
+	if (ret)
+		goto failure;
+	for (i = 0; i < sizeof(test_mf_flavors) / sizeof(test_mf_flavors[0]);
+			i++) {
+		ret = test_mf_shared(test_mf_flavors[i]);
+		if (ret)
+			goto failure;
+	}
 
 	exit(EXIT_SUCCESS);
 
@@ -21,9 +21,61 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <urcu/wait-mode.h>
+
+struct rcu_flavor_struct;
+struct call_rcu_data;
+struct rcu_gp_stats;
+
+/*
+ * Functions of a flavor used by the checks shared by all flavors, in
+ * test_urcu_multiflavor.c. Defined by each flavor's test, with the
+ * names mapped to the flavor's.
+ */
+struct test_mf_flavor {
+	const char *name;
+	/* Whether concurrent synchronize_rcu() calls share grace periods. */
+	int gp_batching;
+	const struct rcu_flavor_struct *rcu;
+	int (*set_wait_mode)(enum rcu_wait_mode mode);
+	void (*get_gp_stats)(struct rcu_gp_stats *stats);
+	void (*reset_gp_stats)(void);
+	struct call_rcu_data *(*create_call_rcu_data)(unsigned long flags,
+			int cpu_affinity);
+	void (*call_rcu_data_free)(struct call_rcu_data *crdp);
+	void (*set_thread_call_rcu_data)(struct call_rcu_data *crdp);
+	int (*get_call_rcu_eventfd)(struct call_rcu_data *crdp);
+	unsigned long (*process_callbacks)(struct call_rcu_data *crdp,
+			unsigned long budget);
+};
+
+#define DEFINE_TEST_MF_FLAVOR(x, _name, _gp_batching)	\
+const struct test_mf_flavor x = {			\
+	.name			= _name,		\
+	.gp_batching		= _gp_batching,		\
+	.rcu			= &rcu_flavor,		\
+	.set_wait_mode		= rcu_set_wait_mode,	\
+	.get_gp_stats		= rcu_get_gp_stats,	\
+	.reset_gp_stats		= rcu_reset_gp_stats,	\
+	.create_call_rcu_data	= create_call_rcu_data,	\
+	.call_rcu_data_free	= call_rcu_data_free,	\
+	.set_thread_call_rcu_data			\
+			= set_thread_call_rcu_data,	\
+	.get_call_rcu_eventfd	= get_call_rcu_eventfd,	\
+	.process_callbacks	= rcu_process_callbacks,\
+}
+
+extern const struct test_mf_flavor test_mf_flavor_memb;
+extern const struct test_mf_flavor test_mf_flavor_mb;
+extern const struct test_mf_flavor test_mf_flavor_signal;
+extern const struct test_mf_flavor test_mf_flavor_qsbr;
+extern const struct test_mf_flavor test_mf_flavor_bp;
+extern const struct test_mf_flavor test_mf_flavor_percpu;
+
 extern int test_mf_memb(void);
 extern int test_mf_mb(void);
 extern int test_mf_signal(void);
 extern int test_mf_qsbr(void);
 extern int test_mf_bp(void);
+extern int test_mf_percpu(void);
 
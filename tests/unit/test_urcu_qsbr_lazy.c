@@ -0,0 +1,112 @@
+/*
+ * test_urcu_qsbr_lazy.c
+ *
+ * Userspace RCU library - test switching QSBR readers to lazy offline mode
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <time.h>
+#include <urcu-qsbr.h>
+
+/* Time the grace period has to start waiting for the reader. */
+#define LAZY_GP_DELAY_MS	50
+/* Beyond, the threads are deemed deadlocked. */
+#define LAZY_TIMEOUT_S		10
+
+static sem_t reader_online, done;
+static int lazy_ret;
+
+static void fail(const char *msg)
+{
+	fprintf(stderr, "test_urcu_qsbr_lazy: %s\n", msg);
+	exit(EXIT_FAILURE);
+}
+
+static void wait_done(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_REALTIME, &ts))
+		fail("clock_gettime");
+	ts.tv_sec += LAZY_TIMEOUT_S;
+	while (sem_timedwait(&done, &ts)) {
+		if (errno == ETIMEDOUT)
+			fail("deadlock between rcu_thread_set_lazy_offline() "
+				"and synchronize_rcu()");
+		if (errno != EINTR)
+			fail("sem_timedwait");
+	}
+}
+
+/*
+ * Online reader switching to lazy mode while a grace period waits for
+ * its quiescent state, holding gp_lock.
+ */
+static void *thr_reader(void *arg)
+{
+	rcu_register_thread();
+	if (sem_post(&reader_online))
+		fail("sem_post");
+	(void) poll(NULL, 0, LAZY_GP_DELAY_MS);
+	lazy_ret = rcu_thread_set_lazy_offline(1);
+	if (!lazy_ret && rcu_thread_set_lazy_offline(0))
+		fail("rcu_thread_set_lazy_offline");
+	if (!rcu_read_ongoing())
+		fail("reader left offline");
+	rcu_unregister_thread();
+	if (sem_post(&done))
+		fail("sem_post");
+	return NULL;
+}
+
+static void *thr_updater(void *arg)
+{
+	synchronize_rcu();
+	if (sem_post(&done))
+		fail("sem_post");
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t reader, updater;
+
+	if (sem_init(&reader_online, 0, 0) || sem_init(&done, 0, 0))
+		fail("sem_init");
+	if (pthread_create(&reader, NULL, thr_reader, NULL))
+		fail("pthread_create");
+	while (sem_wait(&reader_online))
+		if (errno != EINTR)
+			fail("sem_wait");
+	if (pthread_create(&updater, NULL, thr_updater, NULL))
+		fail("pthread_create");
+	wait_done();
+	wait_done();
+	if (pthread_join(reader, NULL) || pthread_join(updater, NULL))
+		fail("pthread_join");
+	if (lazy_ret && lazy_ret != -ENOSYS)
+		fail("rcu_thread_set_lazy_offline");
+	printf("test_urcu_qsbr_lazy: OK\n");
+	exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,204 @@
+/*
+ * test_urcu_scan.c
+ *
+ * Userspace RCU library - test the parallel scan of the readers
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <urcu.h>
+
+/*
+ * Reader contexts held in read-side critical sections stand for the
+ * readers: enough of them for the grace period to split the scan
+ * between all the helper threads (at least 256 readers each).
+ */
+#define SCAN_THREADS		3
+#define SCAN_MAX_THREADS	64
+#define SCAN_READERS		2048
+/* Readers registered and unregistered during the grace period. */
+#define SCAN_CHURN		64
+/* Time the grace period has to start scanning. */
+#define SCAN_GP_DELAY_MS	50
+#define SCAN_TIMEOUT_MS		10000
+
+static struct rcu_reader *readers[SCAN_READERS];
+static int gp_done;
+
+static void fail(const char *msg)
+{
+	fprintf(stderr, "test_urcu_scan: %s\n", msg);
+	exit(EXIT_FAILURE);
+}
+
+static unsigned long now_ms(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts))
+		fail("clock_gettime");
+	return ts.tv_sec * 1000UL + ts.tv_nsec / 1000000;
+}
+
+/* Number of threads of the process, or -1 if unknown. */
+static int nr_threads(void)
+{
+	char line[256];
+	FILE *f;
+	int nr = -1;
+
+	f = fopen("/proc/self/status", "r");
+	if (!f)
+		return -1;
+	while (fgets(line, sizeof(line), f)) {
+		if (sscanf(line, "Threads: %d", &nr) == 1)
+			break;
+	}
+	(void) fclose(f);
+	return nr;
+}
+
+/* Enter or leave a read-side critical section on behalf of "ctx". */
+static void context_lock(struct rcu_reader *ctx)
+{
+	rcu_context_attach(ctx);
+	rcu_read_lock();
+	rcu_context_detach(ctx);
+}
+
+static void context_unlock(struct rcu_reader *ctx)
+{
+	rcu_context_attach(ctx);
+	rcu_read_unlock();
+	rcu_context_detach(ctx);
+}
+
+static void *thr_updater(void *arg)
+{
+	rcu_register_thread();
+	synchronize_rcu();
+	CMM_STORE_SHARED(gp_done, 1);
+	rcu_unregister_thread();
+	return NULL;
+}
+
+/* Register and unregister readers, changing the registry. */
+static void churn(void)
+{
+	struct rcu_reader *ctx[SCAN_CHURN];
+	int i;
+
+	for (i = 0; i < SCAN_CHURN; i++) {
+		ctx[i] = rcu_context_create();
+		if (!ctx[i])
+			fail("rcu_context_create");
+	}
+	for (i = 0; i < SCAN_CHURN; i += 2)
+		rcu_context_destroy(ctx[i]);
+	for (i = 1; i < SCAN_CHURN; i += 2)
+		rcu_context_destroy(ctx[i]);
+}
+
+/*
+ * Release the readers of one parity but "held", changing the registry
+ * meanwhile, and check that the grace period still waits.
+ */
+static void release_readers(int parity, int held)
+{
+	int i;
+
+	for (i = parity; i < SCAN_READERS; i += 2) {
+		if (i != held)
+			context_unlock(readers[i]);
+		if (!(i % 256))
+			churn();
+	}
+	(void) poll(NULL, 0, SCAN_GP_DELAY_MS);
+	if (CMM_LOAD_SHARED(gp_done))
+		fail("grace period did not wait for an active reader");
+}
+
+/*
+ * Run a grace period while all readers are active. Releasing half of
+ * them keeps the scan parallel while the grace period must wait for
+ * "held", releasing all but "held" makes it serial.
+ */
+static void test_gp(int held)
+{
+	pthread_t updater;
+	unsigned long start;
+	int i;
+
+	for (i = 0; i < SCAN_READERS; i++)
+		context_lock(readers[i]);
+	CMM_STORE_SHARED(gp_done, 0);
+	if (pthread_create(&updater, NULL, thr_updater, NULL))
+		fail("pthread_create");
+	(void) poll(NULL, 0, SCAN_GP_DELAY_MS);
+	release_readers(held & 1, held);
+	release_readers(!(held & 1), held);
+	churn();
+	context_unlock(readers[held]);
+	for (start = now_ms(); !CMM_LOAD_SHARED(gp_done);) {
+		if (now_ms() - start > SCAN_TIMEOUT_MS)
+			fail("grace period did not complete");
+		(void) poll(NULL, 0, 10);
+	}
+	if (pthread_join(updater, NULL))
+		fail("pthread_join");
+}
+
+int main(int argc, char **argv)
+{
+	int i, threads;
+
+	rcu_register_thread();
+	if (rcu_set_gp_scan_threads(SCAN_MAX_THREADS + 1) != -EINVAL)
+		fail("too many scan threads accepted");
+	if (rcu_set_gp_scan_threads(SCAN_THREADS))
+		fail("rcu_set_gp_scan_threads");
+	for (i = 0; i < SCAN_READERS; i++) {
+		readers[i] = rcu_context_create();
+		if (!readers[i])
+			fail("rcu_context_create");
+	}
+	threads = nr_threads();
+
+	/* Readers in the middle, first and last shards. */
+	test_gp(SCAN_READERS / 2);
+	if (threads > 0 && nr_threads() != threads + SCAN_THREADS)
+		fail("scan helper threads not started");
+	test_gp(0);
+	test_gp(SCAN_READERS - 1);
+
+	/* Back to the grace period scanning alone. */
+	if (rcu_set_gp_scan_threads(0))
+		fail("rcu_set_gp_scan_threads");
+	test_gp(SCAN_READERS / 3);
+
+	for (i = 0; i < SCAN_READERS; i++)
+		rcu_context_destroy(readers[i]);
+	rcu_unregister_thread();
+	printf("test_urcu_scan: OK\n");
+	exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,163 @@
+/*
+ * test_urcu_stall.c
+ *
+ * Userspace RCU library - test the reader stall detector
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <urcu.h>
+
+#define STALL_THRESHOLD_MS	50
+#define STALL_NESTING		2
+/* How long to wait for the reports. */
+#define STALL_TIMEOUT_MS	5000
+
+static sem_t reader_locked, reader_release;
+
+/* Reports of the stall detector, protected by reports_lock. */
+static pthread_mutex_t reports_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct rcu_stall_info reports[2];
+static unsigned int nr_reports;
+
+static void fail(const char *msg)
+{
+	fprintf(stderr, "test_urcu_stall: %s\n", msg);
+	exit(EXIT_FAILURE);
+}
+
+/* Called by the grace period: only record the report. */
+static void stall_report(const struct rcu_stall_info *info, void *priv)
+{
+	if (priv != &reports)
+		fail("wrong stall detector data");
+	if (pthread_mutex_lock(&reports_lock))
+		fail("pthread_mutex_lock");
+	if (nr_reports < 2)
+		reports[nr_reports] = *info;
+	nr_reports++;
+	if (pthread_mutex_unlock(&reports_lock))
+		fail("pthread_mutex_unlock");
+}
+
+static unsigned int get_reports(void)
+{
+	unsigned int nr;
+
+	if (pthread_mutex_lock(&reports_lock))
+		fail("pthread_mutex_lock");
+	nr = nr_reports;
+	if (pthread_mutex_unlock(&reports_lock))
+		fail("pthread_mutex_unlock");
+	return nr;
+}
+
+static void *thr_reader(void *arg)
+{
+	int i;
+
+	rcu_register_thread();
+	for (i = 0; i < STALL_NESTING; i++)
+		rcu_read_lock();
+	if (sem_post(&reader_locked))
+		fail("sem_post");
+	while (sem_wait(&reader_release))
+		if (errno != EINTR)
+			fail("sem_wait");
+	for (i = 0; i < STALL_NESTING; i++)
+		rcu_read_unlock();
+	rcu_unregister_thread();
+	return NULL;
+}
+
+static void *thr_updater(void *arg)
+{
+	synchronize_rcu();
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t reader, updater;
+	unsigned int waited;
+
+	if (rcu_set_stall_detector(STALL_THRESHOLD_MS, NULL, NULL) != -EINVAL)
+		fail("stall detector enabled without a function");
+	if (sem_init(&reader_locked, 0, 0) || sem_init(&reader_release, 0, 0))
+		fail("sem_init");
+	if (rcu_set_stall_detector(STALL_THRESHOLD_MS, stall_report, &reports))
+		fail("rcu_set_stall_detector");
+	if (pthread_create(&reader, NULL, thr_reader, NULL))
+		fail("pthread_create");
+	while (sem_wait(&reader_locked))
+		if (errno != EINTR)
+			fail("sem_wait");
+
+	/* Hold the grace period for two reports. */
+	if (pthread_create(&updater, NULL, thr_updater, NULL))
+		fail("pthread_create");
+	for (waited = 0; get_reports() < 2; waited += 10) {
+		if (waited >= STALL_TIMEOUT_MS)
+			fail("stalled reader not reported");
+		(void) poll(NULL, 0, 10);
+	}
+	if (sem_post(&reader_release))
+		fail("sem_post");
+	if (pthread_join(updater, NULL))
+		fail("pthread_join");
+	if (pthread_join(reader, NULL))
+		fail("pthread_join");
+
+	if (!pthread_equal(reports[0].tid, reader)
+			|| !pthread_equal(reports[1].tid, reader))
+		fail("wrong reader reported");
+	if (!reports[0].ctr || reports[1].ctr != reports[0].ctr)
+		fail("wrong reader counter reported");
+	if (reports[0].nesting != STALL_NESTING
+			|| reports[1].nesting != STALL_NESTING)
+		fail("wrong reader nesting reported");
+	if (reports[0].stall_ms < STALL_THRESHOLD_MS
+			|| reports[1].stall_ms
+				< reports[0].stall_ms + STALL_THRESHOLD_MS)
+		fail("wrong stall duration reported");
+	if (reports[0].gp_ms < reports[0].stall_ms)
+		fail("wrong grace period duration reported");
+
+	/* Disabled, the detector no longer reports. */
+	if (rcu_set_stall_detector(0, NULL, NULL))
+		fail("rcu_set_stall_detector");
+	nr_reports = 0;
+	rcu_register_thread();
+	rcu_read_lock();
+	if (pthread_create(&updater, NULL, thr_updater, NULL))
+		fail("pthread_create");
+	(void) poll(NULL, 0, 2 * STALL_THRESHOLD_MS);
+	rcu_read_unlock();
+	if (pthread_join(updater, NULL))
+		fail("pthread_join");
+	rcu_unregister_thread();
+	if (get_reports())
+		fail("disabled stall detector reported");
+	printf("test_urcu_stall: OK\n");
+	exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,230 @@
+/*
+ * test_urcu_threadless.c
+ *
+ * Userspace RCU library - test threadless call_rcu handles driven by
+ * their eventfd
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <urcu.h>
+
+#define TL_CBS			10
+#define TL_BUDGET		3
+/* Time a grace period, or a helper thread, has to act. */
+#define TL_DELAY_MS		50
+#define TL_TIMEOUT_MS		10000
+
+struct test_cb {
+	struct rcu_head head;
+	unsigned long index;
+};
+
+static struct test_cb cbs[TL_CBS];
+static pthread_t owner;
+static unsigned long nr_invoked;
+static int foreign_invoked;
+static sem_t reader_locked, reader_release;
+
+static void fail(const char *msg)
+{
+	fprintf(stderr, "test_urcu_threadless: %s\n", msg);
+	exit(EXIT_FAILURE);
+}
+
+static void take(sem_t *sem)
+{
+	while (sem_wait(sem))
+		if (errno != EINTR)
+			fail("sem_wait");
+}
+
+static void give(sem_t *sem)
+{
+	if (sem_post(sem))
+		fail("sem_post");
+}
+
+/* Return whether "fd" becomes readable within "timeout_ms". */
+static int readable(int fd, int timeout_ms)
+{
+	struct pollfd pfd = {
+		.fd = fd,
+		.events = POLLIN,
+	};
+	int ret;
+
+	while ((ret = poll(&pfd, 1, timeout_ms)) < 0)
+		if (errno != EINTR)
+			fail("poll");
+	return ret;
+}
+
+static void cb_func(struct rcu_head *head)
+{
+	struct test_cb *cb = caa_container_of(head, struct test_cb, head);
+
+	if (!pthread_equal(pthread_self(), owner)) {
+		CMM_STORE_SHARED(foreign_invoked, 1);
+		return;
+	}
+	if (cb->index != nr_invoked)
+		fail("callbacks invoked out of order");
+	nr_invoked++;
+}
+
+static void queue_cbs(struct call_rcu_data *crdp, int nr)
+{
+	int i;
+
+	set_thread_call_rcu_data(crdp);
+	for (i = 0; i < nr; i++) {
+		cbs[i].index = i;
+		call_rcu(&cbs[i].head, cb_func);
+	}
+	set_thread_call_rcu_data(NULL);
+}
+
+static void *thr_reader(void *arg)
+{
+	rcu_register_thread();
+	rcu_read_lock();
+	give(&reader_locked);
+	take(&reader_release);
+	rcu_read_unlock();
+	rcu_unregister_thread();
+	return NULL;
+}
+
+/* Handles served by a helper thread have no eventfd. */
+static void test_threaded(void)
+{
+	struct call_rcu_data *crdp;
+
+	crdp = create_call_rcu_data(0, -1);
+	if (!crdp)
+		fail("create_call_rcu_data");
+	if (get_call_rcu_eventfd(crdp) != -1)
+		fail("eventfd of a handle served by a helper thread");
+	if (rcu_process_callbacks(crdp, TL_CBS))
+		fail("callbacks processed for a helper thread");
+	call_rcu_data_free(crdp);
+}
+
+/*
+ * The eventfd tells when callbacks are queued, and when their grace
+ * period completes. Only rcu_process_callbacks() invokes them, on the
+ * owner thread, "budget" at a time.
+ */
+static void test_process(struct call_rcu_data *crdp, int fd)
+{
+	pthread_t reader;
+	unsigned long nr;
+
+	if (readable(fd, 0))
+		fail("eventfd readable without callbacks");
+	if (pthread_create(&reader, NULL, thr_reader, NULL))
+		fail("pthread_create");
+	take(&reader_locked);
+	queue_cbs(crdp, TL_CBS);
+	if (!readable(fd, 0))
+		fail("eventfd not notified of queued callbacks");
+
+	/* Start the grace period, which waits for the reader. */
+	if (rcu_process_callbacks(crdp, TL_CBS))
+		fail("callbacks invoked before their grace period");
+	if (readable(fd, TL_DELAY_MS))
+		fail("eventfd notified while a reader holds the grace period");
+	give(&reader_release);
+	if (pthread_join(reader, NULL))
+		fail("pthread_join");
+	if (!readable(fd, TL_TIMEOUT_MS))
+		fail("eventfd not notified of the end of the grace period");
+	if (nr_invoked)
+		fail("callbacks invoked outside of rcu_process_callbacks()");
+
+	/* Leftover ready callbacks keep the eventfd readable. */
+	for (nr = 0; nr < TL_CBS; nr += TL_BUDGET) {
+		if (!readable(fd, 0))
+			fail("eventfd not notified of leftover callbacks");
+		if (rcu_process_callbacks(crdp, TL_BUDGET)
+				!= (TL_CBS - nr < TL_BUDGET
+					? TL_CBS - nr : TL_BUDGET))
+			fail("wrong number of callbacks invoked");
+	}
+	if (nr_invoked != TL_CBS)
+		fail("callbacks not all invoked");
+	if (readable(fd, 0))
+		fail("eventfd readable without work left");
+}
+
+/*
+ * rcu_barrier() does not wait for threadless callbacks, which the
+ * helper thread does not invoke until the handle is freed.
+ */
+static void test_free(struct call_rcu_data *crdp)
+{
+	unsigned long waited;
+
+	nr_invoked = 0;
+	queue_cbs(crdp, 1);
+	(void) rcu_process_callbacks(crdp, TL_CBS);
+	rcu_barrier();
+	(void) poll(NULL, 0, TL_DELAY_MS);
+	if (nr_invoked || CMM_LOAD_SHARED(foreign_invoked))
+		fail("callback invoked without rcu_process_callbacks()");
+	call_rcu_data_free(crdp);
+	for (waited = 0; !CMM_LOAD_SHARED(foreign_invoked); waited += 10) {
+		if (waited > TL_TIMEOUT_MS)
+			fail("callback of a freed handle not invoked");
+		(void) poll(NULL, 0, 10);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	struct call_rcu_data *crdp;
+	int fd;
+
+	if (sem_init(&reader_locked, 0, 0) || sem_init(&reader_release, 0, 0))
+		fail("sem_init");
+	owner = pthread_self();
+	rcu_register_thread();
+	test_threaded();
+	crdp = create_call_rcu_data(URCU_CALL_RCU_THREADLESS, -1);
+	if (!crdp) {
+		if (errno != ENOSYS)
+			fail("create_call_rcu_data");
+		printf("test_urcu_threadless: eventfd() not available, "
+			"skipped\n");
+		exit(EXIT_SUCCESS);
+	}
+	fd = get_call_rcu_eventfd(crdp);
+	if (fd < 0)
+		fail("no eventfd for a threadless handle");
+	test_process(crdp, fd);
+	test_free(crdp);
+	rcu_unregister_thread();
+	printf("test_urcu_threadless: OK\n");
+	exit(EXIT_SUCCESS);
+}
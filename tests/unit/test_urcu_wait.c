@@ -0,0 +1,201 @@
+/*
+ * test_urcu_wait.c
+ *
+ * Userspace RCU library - test the adaptive wait budgets
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <poll.h>
+#include <pthread.h>
+#include "urcu-wait.h"
+
+#define WAIT_ATTEMPTS		URCU_WAIT_ATTEMPTS
+#define WAIT_MIN		(WAIT_ATTEMPTS / URCU_WAIT_SPIN_FACTOR)
+#define WAIT_MAX		(WAIT_ATTEMPTS * URCU_WAIT_SPIN_FACTOR)
+/* Enough waits for the moving average to converge. */
+#define WAIT_LEARN		256
+/* Time the waiter has to go to sleep before being woken up. */
+#define WAIT_WAKE_DELAY_MS	10
+
+static struct urcu_wait_node wait_node;
+
+static void fail(const char *msg)
+{
+	fprintf(stderr, "test_urcu_wait: %s\n", msg);
+	exit(EXIT_FAILURE);
+}
+
+static struct urcu_wait_budget budget(struct urcu_wait_policy *policy,
+		int mode)
+{
+	struct urcu_wait_budget budget;
+
+	urcu_wait_budget_init(&budget, policy, mode, WAIT_ATTEMPTS);
+	if (budget.max != WAIT_MAX)
+		fail("wrong longest wait");
+	if (budget.sleep < budget.spin)
+		fail("sleeps before the end of busy-waiting");
+	return budget;
+}
+
+/* Record "nr" adaptive waits completed after "loops" checks. */
+static void record(struct urcu_wait_policy *policy, unsigned int loops,
+		int nr)
+{
+	struct urcu_wait_budget b;
+
+	while (nr--) {
+		b = budget(policy, RCU_WAIT_MODE_ADAPTIVE);
+		urcu_wait_policy_record(policy, &b, loops);
+	}
+}
+
+static void test_modes(void)
+{
+	struct urcu_wait_policy policy = { 0 };
+	struct urcu_wait_budget b;
+
+	if (!urcu_wait_mode_valid(RCU_WAIT_MODE_ADAPTIVE)
+			|| !urcu_wait_mode_valid(RCU_WAIT_MODE_LATENCY)
+			|| !urcu_wait_mode_valid(RCU_WAIT_MODE_EFFICIENCY)
+			|| urcu_wait_mode_valid((enum rcu_wait_mode) -1))
+		fail("wrong valid wait modes");
+
+	/* The fixed modes ignore recent waits. */
+	record(&policy, 1, WAIT_LEARN);
+	b = budget(&policy, RCU_WAIT_MODE_LATENCY);
+	if (b.spin != WAIT_MAX || b.sleep <= b.spin)
+		fail("latency mode does not busy-wait, then yield");
+	b = budget(&policy, RCU_WAIT_MODE_EFFICIENCY);
+	if (b.spin != 1 || b.sleep != 1)
+		fail("efficiency mode does not sleep immediately");
+}
+
+static void test_adaptive(void)
+{
+	struct urcu_wait_policy policy = { 0 };
+	struct urcu_wait_budget b;
+
+	/* Nominal budget until the first wait. */
+	b = budget(&policy, RCU_WAIT_MODE_ADAPTIVE);
+	if (b.spin != WAIT_ATTEMPTS || b.sleep != WAIT_ATTEMPTS)
+		fail("wrong initial budget");
+
+	/* Short waits: busy-wait twice as long, then yield a few loops. */
+	record(&policy, 3 * WAIT_MIN, WAIT_LEARN);
+	b = budget(&policy, RCU_WAIT_MODE_ADAPTIVE);
+	if (b.spin != 6 * WAIT_MIN
+			|| b.sleep != b.spin + URCU_WAIT_YIELD_ATTEMPTS)
+		fail("budget not learned from short waits");
+
+	/* Very short waits: down to the minimum. */
+	record(&policy, 1, WAIT_LEARN);
+	b = budget(&policy, RCU_WAIT_MODE_ADAPTIVE);
+	if (b.spin != WAIT_MIN)
+		fail("budget below the minimum");
+
+	/* Waits which slept count as the longest: sleep early. */
+	record(&policy, WAIT_MAX, WAIT_LEARN);
+	b = budget(&policy, RCU_WAIT_MODE_ADAPTIVE);
+	if (b.spin != WAIT_MIN || b.sleep != WAIT_MIN)
+		fail("budget not shrunk by long waits");
+
+	/* Waits beyond the sleep threshold are the longest too. */
+	policy.avg = 0;
+	record(&policy, 4 * WAIT_MIN, WAIT_LEARN);
+	record(&policy, WAIT_MAX / 2, 1);
+	if (policy.avg >> URCU_WAIT_AVG_SHIFT
+			< 4 * WAIT_MIN + (WAIT_MAX - 4 * WAIT_MIN) / 16)
+		fail("wait beyond the sleep threshold not counted as longest");
+
+	/*
+	 * Once waits are long, waits lasting beyond the early sleep count
+	 * as long, and only waits completing before it bring busy-waiting
+	 * back.
+	 */
+	record(&policy, WAIT_MAX, WAIT_LEARN);
+	record(&policy, 2 * WAIT_MIN, WAIT_LEARN);
+	b = budget(&policy, RCU_WAIT_MODE_ADAPTIVE);
+	if (b.spin != WAIT_MIN || b.sleep != WAIT_MIN)
+		fail("waits beyond the early sleep deemed short");
+	record(&policy, WAIT_MIN / 2, WAIT_LEARN);
+	b = budget(&policy, RCU_WAIT_MODE_ADAPTIVE);
+	if (b.spin != WAIT_MIN
+			|| b.sleep != WAIT_MIN + URCU_WAIT_YIELD_ATTEMPTS)
+		fail("budget not learned back from short waits");
+}
+
+static void *thr_waker(void *arg)
+{
+	(void) poll(NULL, 0, WAIT_WAKE_DELAY_MS);
+	urcu_adaptative_wake_up(&wait_node);
+	return NULL;
+}
+
+/* Wait for a wake up, issued after "delay" if non-zero, else before. */
+static void wait_once(struct urcu_wait_policy *policy, int mode, int delay)
+{
+	pthread_t waker;
+
+	urcu_wait_node_init(&wait_node, URCU_WAIT_WAITING);
+	if (!delay)
+		urcu_adaptative_wake_up(&wait_node);
+	else if (pthread_create(&waker, NULL, thr_waker, NULL))
+		fail("pthread_create");
+	urcu_adaptative_busy_wait(&wait_node, policy, mode);
+	if (uatomic_read(&wait_node.state) != URCU_WAIT_WAKEUP)
+		fail("wait returned before its wake up");
+	if (delay && pthread_join(waker, NULL))
+		fail("pthread_join");
+}
+
+/* Actual waits teach the policy. */
+static void test_busy_wait(void)
+{
+	struct urcu_wait_policy policy = { 0 };
+	struct urcu_wait_budget b;
+	int i;
+
+	wait_once(&policy, RCU_WAIT_MODE_ADAPTIVE, 0);
+	if (policy.avg != 1 << URCU_WAIT_AVG_SHIFT)
+		fail("immediate wake up not recorded");
+	for (i = 0; i < 32; i++)
+		wait_once(&policy, RCU_WAIT_MODE_EFFICIENCY, 1);
+	b = budget(&policy, RCU_WAIT_MODE_ADAPTIVE);
+	if (b.sleep != WAIT_MIN)
+		fail("sleeping waits not recorded as long");
+	for (i = 0; i < WAIT_LEARN; i++)
+		wait_once(&policy, RCU_WAIT_MODE_ADAPTIVE, 0);
+	b = budget(&policy, RCU_WAIT_MODE_ADAPTIVE);
+	if (b.spin != WAIT_MIN || b.sleep != WAIT_MIN
+			+ URCU_WAIT_YIELD_ATTEMPTS)
+		fail("immediate wake ups not recorded as short");
+}
+
+int main(int argc, char **argv)
+{
+	test_modes();
+	test_adaptive();
+	test_busy_wait();
+	printf("test_urcu_wait: OK\n");
+	exit(EXIT_SUCCESS);
+}
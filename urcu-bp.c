@@ -34,6 +34,7 @@
 #include <errno.h>
 #include <poll.h>
 #include <unistd.h>
+#include <sched.h>
 #include <sys/mman.h>
 
 #include "urcu/wfcqueue.h"
@@ -43,6 +44,13 @@
 #include "urcu/tls-compat.h"
 
 #include "urcu-die.h"
+#include "urcu-wait.h"
+#include "urcu-poll.h"
+#include "urcu-membarrier.h"
+#include "urcu-scan.h"
+#include "urcu-stall.h"
+#include "urcu-gp-stats.h"
+#include "urcu-sdt.h"
 
 /* Do not #define _LGPL_SOURCE to ensure we can emit the wrapper symbols */
 #undef _LGPL_SOURCE
@@ -87,10 +95,26 @@ void *mremap_wrapper(void *old_address, size_t old_size,
 	+ INIT_NR_THREADS * sizeof(struct rcu_reader)
 
 /*
- * Active attempts to check for reader Q.S. before calling sleep().
+ * Active attempts to check for reader Q.S. before calling sleep(), when
+ * no recent grace period tells better (see urcu-wait.h).
  */
 #define RCU_QS_ACTIVE_ATTEMPTS 100
 
+/* enum rcu_wait_mode, set by rcu_set_wait_mode(). */
+static int rcu_wait_mode;
+
+/* Set by rcu_set_stall_detector(). */
+static struct urcu_stall_detector rcu_stall = URCU_STALL_DETECTOR_INIT;
+
+/* Set by rcu_set_reader_boost(). */
+static struct urcu_boost rcu_boost = URCU_BOOST_INIT;
+
+/* Returned by rcu_get_gp_stats(). */
+static struct rcu_gp_stats rcu_stats;
+
+/* How long recent grace periods waited for readers. */
+static struct urcu_wait_policy rcu_gp_wait_policy;
+
 static
 int rcu_bp_refcount;
 
@@ -100,10 +124,24 @@ static
 void __attribute__((destructor)) rcu_bp_exit(void);
 
 static pthread_mutex_t rcu_gp_lock = PTHREAD_MUTEX_INITIALIZER;
+/*
+ * rcu_registry_lock ensures mutual exclusion between threads
+ * registering and unregistering themselves to/from the registry, and
+ * with threads reading that registry from synchronize_rcu(). However,
+ * this lock is not held all the way through the completion of awaiting
+ * for the grace period. It is sporadically released between iterations
+ * on the registry.
+ * rcu_registry_lock may nest inside rcu_gp_lock.
+ */
+static pthread_mutex_t rcu_registry_lock = PTHREAD_MUTEX_INITIALIZER;
 
 static pthread_mutex_t init_lock = PTHREAD_MUTEX_INITIALIZER;
 static int initialized;
 
+/* Written once, with init_lock held. */
+static int membarrier_init_done;
+int rcu_has_sys_membarrier;
+
 static pthread_key_t urcu_bp_key;
 
 #ifdef DEBUG_YIELD
@@ -113,6 +151,23 @@ DEFINE_URCU_TLS(unsigned int, rcu_rand_yield);
 
 struct rcu_gp rcu_gp = { .ctr = RCU_GP_COUNT };
 
+/* Checked by the read-side inlined into non-LGPL code. */
+const unsigned int rcu_reader_abi = RCU_READER_ABI;
+
+/*
+ * Grace period sequence number, used by the grace period polling API.
+ * Written to only by writer with rcu_gp_lock held.
+ */
+static unsigned long rcu_gp_seq;
+
+/*
+ * Number of synchronize_rcu_expedited() callers currently waiting for a
+ * grace period. While non-zero, wait_for_readers() yields rather than
+ * sleeping for RCU_SLEEP_DELAY_MS. Its sleep waits on this futex, so
+ * it is cut short as soon as a caller increments it.
+ */
+static int32_t rcu_gp_expedited;
+
 /*
  * Pointer to registry elements. Written to only by each individual reader. Read
  * by both the reader and the writers.
@@ -121,19 +176,29 @@ DEFINE_URCU_TLS(struct rcu_reader *, rcu_reader);
 
 static CDS_LIST_HEAD(registry);
 
+/*
+ * Incremented on each change of the registry, which tells the parallel
+ * scan of the readers (see urcu-scan.h) that its copy is stale.
+ * Protected by rcu_registry_lock.
+ */
+static unsigned long registry_gen;
+
 struct registry_chunk {
 	size_t data_len;		/* data length */
-	size_t used;			/* amount of data used */
 	struct cds_list_head node;	/* chunk_list node */
-	char data[];
+	/* Reader slots, aligned as struct rcu_reader. */
+	char data[] __attribute__((aligned(CAA_CACHE_LINE_SIZE)));
 };
 
 struct registry_arena {
 	struct cds_list_head chunk_list;
+	/* Slots not allocated to a reader, chained by their node. */
+	struct cds_list_head free_list;
 };
 
 static struct registry_arena registry_arena = {
 	.chunk_list = CDS_LIST_HEAD_INIT(registry_arena.chunk_list),
+	.free_list = CDS_LIST_HEAD_INIT(registry_arena.free_list),
 };
 
 /* Saved fork signal mask, protected by rcu_gp_lock */
@@ -165,12 +230,137 @@ static void mutex_unlock(pthread_mutex_t *mutex)
 		urcu_die(ret);
 }
 
+/*
+ * Prefer the private expedited command, which only interrupts the CPUs
+ * running threads of this process. The shared command is not used: it
+ * would make each grace period last as long as a scheduler grace
+ * period. Called with init_lock held, before the first reader
+ * registration and before the first grace period.
+ */
+static void membarrier_init(void)
+{
+	int mask;
+
+	if (membarrier_init_done)
+		return;
+	membarrier_init_done = 1;
+	mask = membarrier(MEMBARRIER_CMD_QUERY, 0);
+	if (mask >= 0 && (mask & MEMBARRIER_CMD_PRIVATE_EXPEDITED)
+			&& !membarrier(MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0))
+		rcu_has_sys_membarrier = 1;
+}
+
+static void smp_mb_master(void)
+{
+	if (caa_likely(rcu_has_sys_membarrier))
+		(void) membarrier(MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0);
+	else
+		cmm_smp_mb();
+}
+
+/*
+ * Helper threads scanning the readers of the grace period.
+ */
+static struct urcu_scan rcu_scan = URCU_SCAN_INIT;
+
+static enum rcu_state scan_reader_state(void *arg, struct rcu_reader *reader)
+{
+	return rcu_reader_state(&reader->ctr);
+}
+
+/*
+ * Report the readers of "input_readers", which the grace period is
+ * still waiting for, if the stall detector is due. Grace periods sleep
+ * for RCU_SLEEP_DELAY_MS at most, which bounds the report latency.
+ */
+static void report_stalled_readers(struct urcu_stall_gp *stall,
+		struct cds_list_head *input_readers)
+{
+	struct rcu_reader *index;
+	unsigned long now;
+
+	if (caa_likely(!urcu_stall_gp_due(stall, &now)))
+		return;
+	cds_list_for_each_entry(index, input_readers, node) {
+		unsigned long ctr = CMM_LOAD_SHARED(index->ctr);
+
+		urcu_stall_report(stall, now, index->tid, ctr,
+				ctr & RCU_GP_CTR_NEST_MASK,
+				&index->stall_ctr, &index->stall_since);
+	}
+}
+
+/*
+ * Boost the threads of the readers of "input_readers", which the grace
+ * period is still waiting for, if reader boosting is due.
+ */
+static void boost_stalled_readers(struct urcu_stall_gp *stall,
+		struct cds_list_head *input_readers)
+{
+	struct rcu_reader *index;
+
+	if (caa_likely(!urcu_boost_gp_due(stall)))
+		return;
+	cds_list_for_each_entry(index, input_readers, node)
+		urcu_boost_reader(stall, index->tid, &index->boosted,
+				&index->boost_policy, &index->boost_param);
+}
+
+/*
+ * Restore the scheduling of the boosted readers of "readers", which no
+ * longer hold the grace period.
+ */
+static void restore_boosted_readers(struct urcu_stall_gp *stall,
+		struct cds_list_head *readers)
+{
+	struct rcu_reader *index;
+
+	cds_list_for_each_entry(index, readers, node) {
+		if (!stall->nr_boosted)
+			return;
+		if (urcu_boost_restore(index->tid, &index->boosted,
+				&index->boost_policy, &index->boost_param))
+			stall->nr_boosted--;
+	}
+}
+
+/*
+ * Sleep for RCU_SLEEP_DELAY_MS before scanning the readers again, unless
+ * synchronize_rcu_expedited() is called meanwhile.
+ */
+static void wait_gp(void)
+{
+#ifdef CONFIG_RCU_HAVE_FUTEX
+	const struct timespec timeout = {
+		.tv_sec = 0,
+		.tv_nsec = RCU_SLEEP_DELAY_MS * 1000000L,
+	};
+#endif
+
+	uatomic_inc(&rcu_stats.nr_sleeps);
+#ifdef CONFIG_RCU_HAVE_FUTEX
+	(void) futex_async(&rcu_gp_expedited, FUTEX_WAIT, 0,
+			&timeout, NULL, 0);
+#else
+	(void) poll(NULL, 0, RCU_SLEEP_DELAY_MS);
+#endif
+}
+
 static void wait_for_readers(struct cds_list_head *input_readers,
 			struct cds_list_head *cur_snap_readers,
 			struct cds_list_head *qsreaders)
 {
 	unsigned int wait_loops = 0;
+	size_t scanned, nr_scanned = 0;
+	unsigned long scan_token = 0;
 	struct rcu_reader *index, *tmp;
+	struct urcu_wait_budget budget;
+	struct urcu_stall_gp stall;
+
+	urcu_wait_budget_init(&budget, &rcu_gp_wait_policy,
+			CMM_LOAD_SHARED(rcu_wait_mode), RCU_QS_ACTIVE_ATTEMPTS);
+	urcu_stall_gp_init(&stall, &rcu_stall, &rcu_boost);
+	urcu_probe1(wait_readers_begin, rcu_gp.ctr);
 
 	/*
 	 * Wait for each thread URCU_TLS(rcu_reader).ctr to either
@@ -178,41 +368,69 @@ static void wait_for_readers(struct cds_list_head *input_readers,
 	 * rcu_gp.ctr value.
 	 */
 	for (;;) {
-		if (wait_loops < RCU_QS_ACTIVE_ATTEMPTS)
+		if (wait_loops < budget.sleep)
 			wait_loops++;
 
-		cds_list_for_each_entry_safe(index, tmp, input_readers, node) {
-			switch (rcu_reader_state(&index->ctr)) {
-			case RCU_READER_ACTIVE_CURRENT:
-				if (cur_snap_readers) {
-					cds_list_move(&index->node,
-						cur_snap_readers);
+		scanned = urcu_scan_readers(&rcu_scan, input_readers,
+				cur_snap_readers, qsreaders,
+				scan_reader_state, NULL, &scan_token,
+				registry_gen);
+		if (!scanned) {
+			cds_list_for_each_entry_safe(index, tmp,
+					input_readers, node) {
+				scanned++;
+				switch (rcu_reader_state(&index->ctr)) {
+				case RCU_READER_ACTIVE_CURRENT:
+					if (cur_snap_readers) {
+						cds_list_move(&index->node,
+							cur_snap_readers);
+						break;
+					}
+					/* Fall-through */
+				case RCU_READER_INACTIVE:
+					cds_list_move(&index->node, qsreaders);
+					break;
+				case RCU_READER_ACTIVE_OLD:
+					/*
+					 * Old snapshot. Leaving node in
+					 * input_readers will make us busy-loop
+					 * until the snapshot becomes current or
+					 * the reader becomes inactive.
+					 */
 					break;
 				}
-				/* Fall-through */
-			case RCU_READER_INACTIVE:
-				cds_list_move(&index->node, qsreaders);
-				break;
-			case RCU_READER_ACTIVE_OLD:
-				/*
-				 * Old snapshot. Leaving node in
-				 * input_readers will make us busy-loop
-				 * until the snapshot becomes current or
-				 * the reader becomes inactive.
-				 */
-				break;
 			}
 		}
+		nr_scanned += scanned;
+		if (caa_unlikely(stall.nr_boosted)) {
+			restore_boosted_readers(&stall, qsreaders);
+			if (cur_snap_readers)
+				restore_boosted_readers(&stall,
+						cur_snap_readers);
+		}
 
 		if (cds_list_empty(input_readers)) {
 			break;
 		} else {
-			if (wait_loops >= RCU_QS_ACTIVE_ATTEMPTS)
-				(void) poll(NULL, 0, RCU_SLEEP_DELAY_MS);
-			else
-				caa_cpu_relax();
+			report_stalled_readers(&stall, input_readers);
+			boost_stalled_readers(&stall, input_readers);
+			/* Temporarily unlock the registry lock. */
+			mutex_unlock(&rcu_registry_lock);
+			if (wait_loops >= budget.sleep) {
+				if (uatomic_read(&rcu_gp_expedited))
+					(void) sched_yield();
+				else
+					wait_gp();
+			} else {
+				urcu_wait_budget_relax(&budget, wait_loops);
+			}
+			/* Re-lock the registry lock before the next loop. */
+			mutex_lock(&rcu_registry_lock);
 		}
 	}
+	urcu_gp_stats_add(&rcu_stats.nr_readers_scanned, nr_scanned);
+	urcu_probe2(wait_readers_end, rcu_gp.ctr, nr_scanned);
+	urcu_wait_policy_record(&rcu_gp_wait_policy, &budget, wait_loops);
 }
 
 void synchronize_rcu(void)
@@ -220,22 +438,36 @@ void synchronize_rcu(void)
 	CDS_LIST_HEAD(cur_snap_readers);
 	CDS_LIST_HEAD(qsreaders);
 	sigset_t newmask, oldmask;
+	unsigned long start_us = urcu_gp_stats_now_us();
 	int ret;
 
+	urcu_probe1(synchronize_rcu_begin, NULL);
 	ret = sigfillset(&newmask);
 	assert(!ret);
 	ret = pthread_sigmask(SIG_BLOCK, &newmask, &oldmask);
 	assert(!ret);
 
+	/*
+	 * Readers and grace periods must agree on the barrier scheme:
+	 * detect it before the first grace period.
+	 */
+	mutex_lock(&init_lock);
+	membarrier_init();
+	mutex_unlock(&init_lock);
+
 	mutex_lock(&rcu_gp_lock);
 
+	urcu_gp_seq_start(&rcu_gp_seq);
+
+	mutex_lock(&rcu_registry_lock);
+
 	if (cds_list_empty(&registry))
 		goto out;
 
 	/* All threads should read qparity before accessing data structure
 	 * where new ptr points to. */
 	/* Write new ptr before changing the qparity */
-	cmm_smp_mb();
+	smp_mb_master();
 
 	/*
 	 * Wait for readers to observe original parity or be quiescent.
@@ -280,11 +512,117 @@ void synchronize_rcu(void)
 	 * Finish waiting for reader threads before letting the old ptr being
 	 * freed.
 	 */
-	cmm_smp_mb();
+	smp_mb_master();
 out:
+	mutex_unlock(&rcu_registry_lock);
+	urcu_gp_seq_end(&rcu_gp_seq);
+	mutex_unlock(&rcu_gp_lock);
+	ret = pthread_sigmask(SIG_SETMASK, &oldmask, NULL);
+	assert(!ret);
+	uatomic_inc(&rcu_stats.nr_gp);
+	urcu_gp_stats_latency(&rcu_stats, start_us);
+	urcu_probe2(synchronize_rcu_end, NULL, 1);
+}
+
+/*
+ * Same as synchronize_rcu(), but never sleeps while waiting for
+ * readers. Also expedites the grace period already in progress, whose
+ * current sleep is cut short. Returns the time it took, in
+ * microseconds.
+ */
+unsigned long synchronize_rcu_expedited(void)
+{
+	unsigned long start_us = urcu_gp_stats_now_us();
+
+	uatomic_inc(&rcu_gp_expedited);
+	/* Wake up a grace period sleeping in wait_gp(). */
+	(void) futex_async(&rcu_gp_expedited, FUTEX_WAKE, 1, NULL, NULL, 0);
+	synchronize_rcu();
+	uatomic_dec(&rcu_gp_expedited);
+	return urcu_gp_stats_now_us() - start_us;
+}
+
+int rcu_set_gp_scan_threads(unsigned int nr_threads)
+{
+	return urcu_scan_set_threads(&rcu_scan, nr_threads);
+}
+
+int rcu_set_wait_mode(enum rcu_wait_mode mode)
+{
+	if (!urcu_wait_mode_valid(mode))
+		return -EINVAL;
+	CMM_STORE_SHARED(rcu_wait_mode, mode);
+	return 0;
+}
+
+int rcu_set_stall_detector(unsigned long threshold_ms, rcu_stall_func func,
+		void *priv)
+{
+	return urcu_stall_set(&rcu_stall, threshold_ms, func, priv);
+}
+
+int rcu_set_reader_boost(unsigned long threshold_ms, int policy,
+		int priority)
+{
+	return urcu_boost_set(&rcu_boost, threshold_ms, policy, priority);
+}
+
+void rcu_get_gp_stats(struct rcu_gp_stats *stats)
+{
+	urcu_gp_stats_get(&rcu_stats, stats);
+}
+
+void rcu_reset_gp_stats(void)
+{
+	urcu_gp_stats_reset(&rcu_stats);
+}
+
+static void get_reader_info(struct rcu_reader_info *info,
+		struct rcu_reader *reader)
+{
+	unsigned long ctr = CMM_LOAD_SHARED(reader->ctr);
+
+	info->tid = reader->tid;
+	info->nesting = ctr & RCU_GP_CTR_NEST_MASK;
+	info->state = info->nesting ? RCU_READER_INFO_ACTIVE
+			: RCU_READER_INFO_QUIESCENT;
+	info->since_ns = 0;
+#ifdef CONFIG_RCU_READER_TIMESTAMP
+	if (info->nesting)
+		info->since_ns = CMM_LOAD_SHARED(reader->since_ns);
+#endif
+}
+
+/*
+ * Signals are blocked like in synchronize_rcu(), since a signal handler
+ * may register its thread. Holding rcu_gp_lock ensures no grace period
+ * has moved readers off the registry, at the cost of waiting for the
+ * grace period in progress: a stalled reader delays the call.
+ */
+unsigned int rcu_get_readers(struct rcu_reader_info *readers,
+		unsigned int nr)
+{
+	struct rcu_reader *index;
+	sigset_t newmask, oldmask;
+	unsigned int count = 0;
+	int ret;
+
+	ret = sigfillset(&newmask);
+	assert(!ret);
+	ret = pthread_sigmask(SIG_BLOCK, &newmask, &oldmask);
+	assert(!ret);
+	mutex_lock(&rcu_gp_lock);
+	mutex_lock(&rcu_registry_lock);
+	cds_list_for_each_entry(index, &registry, node) {
+		if (count < nr)
+			get_reader_info(&readers[count], index);
+		count++;
+	}
+	mutex_unlock(&rcu_registry_lock);
 	mutex_unlock(&rcu_gp_lock);
 	ret = pthread_sigmask(SIG_SETMASK, &oldmask, NULL);
 	assert(!ret);
+	return count;
 }
 
 /*
@@ -306,6 +644,20 @@ int rcu_read_ongoing(void)
 	return _rcu_read_ongoing();
 }
 
+/*
+ * Add the reader slots found in [begin, end) to the free list.
+ */
+static
+void arena_free_slots(struct registry_arena *arena, char *begin, char *end)
+{
+	struct rcu_reader *rcu_reader_reg;
+
+	for (rcu_reader_reg = (struct rcu_reader *) begin;
+			rcu_reader_reg + 1 <= (struct rcu_reader *) end;
+			rcu_reader_reg++)
+		cds_list_add_tail(&rcu_reader_reg->node, &arena->free_list);
+}
+
 /*
  * Only grow for now. If empty, allocate a ARENA_INIT_ALLOC sized chunk.
  * Else, try expanding the last chunk. If this fails, allocate a new
@@ -336,6 +688,8 @@ void expand_arena(struct registry_arena *arena)
 		new_chunk->data_len =
 			new_chunk_len - sizeof(struct registry_chunk);
 		cds_list_add_tail(&new_chunk->node, &arena->chunk_list);
+		arena_free_slots(arena, &new_chunk->data[0],
+			&new_chunk->data[new_chunk->data_len]);
 		return;		/* We're done. */
 	}
 
@@ -350,12 +704,21 @@ void expand_arena(struct registry_arena *arena)
 	new_chunk = mremap_wrapper(last_chunk, old_chunk_len,
 		new_chunk_len, 0);
 	if (new_chunk != MAP_FAILED) {
+		size_t old_data_len = last_chunk->data_len;
+
 		/* Should not have moved. */
 		assert(new_chunk == last_chunk);
 		bzero((char *) last_chunk + old_chunk_len,
 			new_chunk_len - old_chunk_len);
 		last_chunk->data_len =
 			new_chunk_len - sizeof(struct registry_chunk);
+		/*
+		 * Slots are laid out from the beginning of the data:
+		 * the first new slot starts after the last old one.
+		 */
+		old_data_len -= old_data_len % sizeof(struct rcu_reader);
+		arena_free_slots(arena, &last_chunk->data[old_data_len],
+			&last_chunk->data[last_chunk->data_len]);
 		return;		/* We're done. */
 	}
 
@@ -370,42 +733,29 @@ void expand_arena(struct registry_arena *arena)
 	new_chunk->data_len =
 		new_chunk_len - sizeof(struct registry_chunk);
 	cds_list_add_tail(&new_chunk->node, &arena->chunk_list);
+	arena_free_slots(arena, &new_chunk->data[0],
+		&new_chunk->data[new_chunk->data_len]);
 }
 
+/*
+ * Take the first slot of the free list, expanding the arena if it is
+ * empty. Constant time, amortized over the arena expansions.
+ */
 static
 struct rcu_reader *arena_alloc(struct registry_arena *arena)
 {
-	struct registry_chunk *chunk;
 	struct rcu_reader *rcu_reader_reg;
-	int expand_done = 0;	/* Only allow to expand once per alloc */
-	size_t len = sizeof(struct rcu_reader);
-
-retry:
-	cds_list_for_each_entry(chunk, &arena->chunk_list, node) {
-		if (chunk->data_len - chunk->used < len)
-			continue;
-		/* Find spot */
-		for (rcu_reader_reg = (struct rcu_reader *) &chunk->data[0];
-				rcu_reader_reg < (struct rcu_reader *) &chunk->data[chunk->data_len];
-				rcu_reader_reg++) {
-			if (!rcu_reader_reg->alloc) {
-				rcu_reader_reg->alloc = 1;
-				chunk->used += len;
-				return rcu_reader_reg;
-			}
-		}
-	}
 
-	if (!expand_done) {
+	if (cds_list_empty(&arena->free_list))
 		expand_arena(arena);
-		expand_done = 1;
-		goto retry;
-	}
-
-	return NULL;
+	rcu_reader_reg = cds_list_entry(arena->free_list.next,
+		struct rcu_reader, node);
+	cds_list_del(&rcu_reader_reg->node);
+	rcu_reader_reg->alloc = 1;
+	return rcu_reader_reg;
 }
 
-/* Called with signals off and mutex locked */
+/* Called with signals off and registry lock held */
 static
 void add_thread(void)
 {
@@ -413,8 +763,6 @@ void add_thread(void)
 	int ret;
 
 	rcu_reader_reg = arena_alloc(&registry_arena);
-	if (!rcu_reader_reg)
-		abort();
 	ret = pthread_setspecific(urcu_bp_key, rcu_reader_reg);
 	if (ret)
 		abort();
@@ -423,6 +771,7 @@ void add_thread(void)
 	rcu_reader_reg->tid = pthread_self();
 	assert(rcu_reader_reg->ctr == 0);
 	cds_list_add(&rcu_reader_reg->node, &registry);
+	registry_gen++;
 	/*
 	 * Reader threads are pointing to the reader registry. This is
 	 * why its memory should never be relocated.
@@ -430,42 +779,32 @@ void add_thread(void)
 	URCU_TLS(rcu_reader) = rcu_reader_reg;
 }
 
-/* Called with mutex locked */
+/* Called with registry lock held */
 static
-void cleanup_thread(struct registry_chunk *chunk,
-		struct rcu_reader *rcu_reader_reg)
+void cleanup_thread(struct rcu_reader *rcu_reader_reg)
 {
 	rcu_reader_reg->ctr = 0;
 	cds_list_del(&rcu_reader_reg->node);
+	registry_gen++;
+	rcu_reader_reg->boosted = 0;
 	rcu_reader_reg->tid = 0;
 	rcu_reader_reg->alloc = 0;
-	chunk->used -= sizeof(struct rcu_reader);
+	cds_list_add(&rcu_reader_reg->node, &registry_arena.free_list);
 }
 
-static
-struct registry_chunk *find_chunk(struct rcu_reader *rcu_reader_reg)
-{
-	struct registry_chunk *chunk;
-
-	cds_list_for_each_entry(chunk, &registry_arena.chunk_list, node) {
-		if (rcu_reader_reg < (struct rcu_reader *) &chunk->data[0])
-			continue;
-		if (rcu_reader_reg >= (struct rcu_reader *) &chunk->data[chunk->data_len])
-			continue;
-		return chunk;
-	}
-	return NULL;
-}
-
-/* Called with signals off and mutex locked */
+/* Called with signals off and registry lock held */
 static
 void remove_thread(struct rcu_reader *rcu_reader_reg)
 {
-	cleanup_thread(find_chunk(rcu_reader_reg), rcu_reader_reg);
+	(void) urcu_boost_restore(rcu_reader_reg->tid,
+			&rcu_reader_reg->boosted,
+			&rcu_reader_reg->boost_policy,
+			&rcu_reader_reg->boost_param);
+	cleanup_thread(rcu_reader_reg);
 	URCU_TLS(rcu_reader) = NULL;
 }
 
-/* Disable signals, take mutex, add to registry */
+/* Disable signals, take registry lock, add to registry */
 void rcu_bp_register(void)
 {
 	sigset_t newmask, oldmask;
@@ -490,16 +829,16 @@ void rcu_bp_register(void)
 	 */
 	rcu_bp_init();
 
-	mutex_lock(&rcu_gp_lock);
+	mutex_lock(&rcu_registry_lock);
 	add_thread();
-	mutex_unlock(&rcu_gp_lock);
+	mutex_unlock(&rcu_registry_lock);
 end:
 	ret = pthread_sigmask(SIG_SETMASK, &oldmask, NULL);
 	if (ret)
 		abort();
 }
 
-/* Disable signals, take mutex, remove from registry */
+/* Disable signals, take registry lock, remove from registry */
 static
 void rcu_bp_unregister(struct rcu_reader *rcu_reader_reg)
 {
@@ -513,9 +852,9 @@ void rcu_bp_unregister(struct rcu_reader *rcu_reader_reg)
 	if (ret)
 		abort();
 
-	mutex_lock(&rcu_gp_lock);
+	mutex_lock(&rcu_registry_lock);
 	remove_thread(rcu_reader_reg);
-	mutex_unlock(&rcu_gp_lock);
+	mutex_unlock(&rcu_registry_lock);
 	ret = pthread_sigmask(SIG_SETMASK, &oldmask, NULL);
 	if (ret)
 		abort();
@@ -545,6 +884,7 @@ void rcu_bp_init(void)
 			abort();
 		initialized = 1;
 	}
+	membarrier_init();
 	mutex_unlock(&init_lock);
 }
 
@@ -561,6 +901,8 @@ void rcu_bp_exit(void)
 			munmap(chunk, chunk->data_len
 					+ sizeof(struct registry_chunk));
 		}
+		CDS_INIT_LIST_HEAD(&registry_arena.chunk_list);
+		CDS_INIT_LIST_HEAD(&registry_arena.free_list);
 		ret = pthread_key_delete(urcu_bp_key);
 		if (ret)
 			abort();
@@ -569,9 +911,10 @@ void rcu_bp_exit(void)
 }
 
 /*
- * Holding the rcu_gp_lock across fork will make sure we fork() don't race with
- * a concurrent thread executing with this same lock held. This ensures that the
- * registry is in a coherent state in the child.
+ * Holding the rcu_gp_lock and rcu_registry_lock across fork will make
+ * sure we fork() don't race with a concurrent thread executing with
+ * any of those locks held. This ensures that the registry and data
+ * protected by rcu_gp_lock are in a coherent state in the child.
  */
 void rcu_bp_before_fork(void)
 {
@@ -583,6 +926,7 @@ void rcu_bp_before_fork(void)
 	ret = pthread_sigmask(SIG_BLOCK, &newmask, &oldmask);
 	assert(!ret);
 	mutex_lock(&rcu_gp_lock);
+	mutex_lock(&rcu_registry_lock);
 	saved_fork_signal_mask = oldmask;
 }
 
@@ -592,6 +936,7 @@ void rcu_bp_after_fork_parent(void)
 	int ret;
 
 	oldmask = saved_fork_signal_mask;
+	mutex_unlock(&rcu_registry_lock);
 	mutex_unlock(&rcu_gp_lock);
 	ret = pthread_sigmask(SIG_SETMASK, &oldmask, NULL);
 	assert(!ret);
@@ -599,7 +944,7 @@ void rcu_bp_after_fork_parent(void)
 
 /*
  * Prune all entries from registry except our own thread. Fits the Linux
- * fork behavior. Called with rcu_gp_lock held.
+ * fork behavior. Called with rcu_gp_lock and rcu_registry_lock held.
  */
 static
 void urcu_bp_prune_registry(void)
@@ -615,7 +960,7 @@ void urcu_bp_prune_registry(void)
 				continue;
 			if (rcu_reader_reg->tid == pthread_self())
 				continue;
-			cleanup_thread(chunk, rcu_reader_reg);
+			cleanup_thread(rcu_reader_reg);
 		}
 	}
 }
@@ -627,6 +972,7 @@ void rcu_bp_after_fork_child(void)
 
 	urcu_bp_prune_registry();
 	oldmask = saved_fork_signal_mask;
+	mutex_unlock(&rcu_registry_lock);
 	mutex_unlock(&rcu_gp_lock);
 	ret = pthread_sigmask(SIG_SETMASK, &oldmask, NULL);
 	assert(!ret);
@@ -660,3 +1006,4 @@ DEFINE_RCU_FLAVOR(rcu_flavor);
 
 #include "urcu-call-rcu-impl.h"
 #include "urcu-defer-impl.h"
+#include "urcu-poll-impl.h"
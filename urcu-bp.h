@@ -56,6 +56,10 @@ extern "C" {
  * publication headers.
  */
 #include <urcu-pointer.h>
+#include <urcu/wait-mode.h>
+#include <urcu/stall.h>
+#include <urcu/gp-stats.h>
+#include <urcu/reader-info.h>
 
 #ifdef _LGPL_SOURCE
 
@@ -132,9 +136,94 @@ extern void *rcu_set_pointer_sym_bp(void **p, void *v);
 		(_________p1);						     \
 	})
 
+#ifdef URCU_INLINE_SMALL_FUNCTIONS
+
+/* Read-side fast path inlined into non-LGPL code (see urcu.h). */
+#include <urcu/static/urcu-bp.h>
+
+static inline void _rcu_read_lock_abi(void)
+{
+	if (caa_likely(rcu_reader_abi == RCU_READER_ABI))
+		_rcu_read_lock();
+	else
+		rcu_read_lock();
+}
+
+static inline void _rcu_read_unlock_abi(void)
+{
+	if (caa_likely(rcu_reader_abi == RCU_READER_ABI))
+		_rcu_read_unlock();
+	else
+		rcu_read_unlock();
+}
+
+static inline int _rcu_read_ongoing_abi(void)
+{
+	if (caa_likely(rcu_reader_abi == RCU_READER_ABI))
+		return _rcu_read_ongoing();
+	return rcu_read_ongoing();
+}
+
+#define rcu_read_lock_bp		_rcu_read_lock_abi
+#define rcu_read_unlock_bp		_rcu_read_unlock_abi
+#define rcu_read_ongoing_bp		_rcu_read_ongoing_abi
+
+#endif /* URCU_INLINE_SMALL_FUNCTIONS */
+
 #endif /* !_LGPL_SOURCE */
 
 extern void synchronize_rcu(void);
+extern unsigned long synchronize_rcu_expedited(void);
+
+/*
+ * Grace period polling. See rcu-api.md in userspace-rcu documentation
+ * for usage detail.
+ */
+extern unsigned long get_state_synchronize_rcu(void);
+extern unsigned long start_poll_synchronize_rcu(void);
+extern int poll_state_synchronize_rcu(unsigned long cookie);
+extern void cond_synchronize_rcu(unsigned long cookie);
+
+/*
+ * Number of helper threads scanning the registered readers in parallel
+ * with the grace period. See rcu-api.md in userspace-rcu documentation
+ * for usage detail.
+ */
+extern int rcu_set_gp_scan_threads(unsigned int nr_threads);
+
+/*
+ * Grace period waiting policy. See rcu-api.md in userspace-rcu
+ * documentation for usage detail.
+ */
+extern int rcu_set_wait_mode(enum rcu_wait_mode mode);
+
+/*
+ * Report readers delaying grace periods. See rcu-api.md in
+ * userspace-rcu documentation for usage detail.
+ */
+extern int rcu_set_stall_detector(unsigned long threshold_ms,
+		rcu_stall_func func, void *priv);
+
+/*
+ * Reader priority boosting. See rcu-api.md in userspace-rcu
+ * documentation for usage detail.
+ */
+extern int rcu_set_reader_boost(unsigned long threshold_ms, int policy,
+		int priority);
+
+/*
+ * Grace period statistics. See rcu-api.md in userspace-rcu
+ * documentation for usage detail.
+ */
+extern void rcu_get_gp_stats(struct rcu_gp_stats *stats);
+extern void rcu_reset_gp_stats(void);
+
+/*
+ * Registered readers introspection. See rcu-api.md in userspace-rcu
+ * documentation for usage detail.
+ */
+extern unsigned int rcu_get_readers(struct rcu_reader_info *readers,
+		unsigned int nr);
 
 /*
  * rcu_bp_before_fork, rcu_bp_after_fork_parent and rcu_bp_after_fork_child
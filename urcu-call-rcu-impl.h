@@ -36,6 +36,9 @@
 #include <sched.h>
 
 #include "config.h"
+#ifdef HAVE_SYS_EVENTFD_H
+#include <sys/eventfd.h>
+#endif
 #include "urcu/wfcqueue.h"
 #include "urcu-call-rcu.h"
 #include "urcu-pointer.h"
@@ -44,6 +47,8 @@
 #include "urcu/tls-compat.h"
 #include "urcu/ref.h"
 #include "urcu-die.h"
+#include "urcu-sdt.h"
+#include "urcu-wait.h"
 
 /* Data structure that identifies a call_rcu thread. */
 
@@ -62,7 +67,39 @@ struct call_rcu_data {
 	unsigned long qlen; /* maintained for debugging. */
 	pthread_t tid;
 	int cpu_affinity;
+	/*
+	 * Grace period performed before invoking callbacks. Defaults
+	 * to synchronize_rcu() when NULL. Used by RCU domains.
+	 */
+	void (*gp_sync)(void *arg);
+	void *gp_sync_arg;
 	struct cds_list_head list;
+	/*
+	 * Batches of callbacks, only used by the thread invoking them.
+	 * The "wait" batch is ready once the grace period sequence
+	 * number wait_cookie is reached. The call_rcu thread queues the
+	 * callbacks which need the following grace period in the "next"
+	 * batch, and waits for the grace period driver, on which
+	 * driver_node is queued while driver_queued is set.
+	 *
+	 * URCU_CALL_RCU_THREADLESS: callbacks are invoked by the owner
+	 * thread from rcu_process_callbacks(), which moves the "wait"
+	 * batch to the "ready" one. gp_head is queued on the default
+	 * call_rcu thread to complete that grace period.
+	 */
+	int eventfd;
+	struct cds_wfcq_head wait_head;
+	struct cds_wfcq_tail wait_tail;
+	unsigned long wait_cookie;
+	struct cds_wfcq_head next_head;
+	struct cds_wfcq_tail next_tail;
+	unsigned long next_cookie;
+	struct cds_wfs_node driver_node;
+	int driver_queued;
+	struct cds_wfcq_head ready_head;
+	struct cds_wfcq_tail ready_tail;
+	struct rcu_head gp_head;
+	int gp_queued;
 } __attribute__((aligned(CAA_CACHE_LINE_SIZE)));
 
 struct call_rcu_completion {
@@ -96,6 +133,38 @@ static pthread_mutex_t call_rcu_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 static struct call_rcu_data *default_call_rcu_data;
 
+/*
+ * Grace period driver thread. Rather than each performing grace
+ * periods for its own batches, the call_rcu threads of the default
+ * domain tag their batches with the grace period sequence number they
+ * need (see urcu_gp_seq_snap()), and raise the target of the driver to
+ * it. The driver performs grace periods back to back until its target
+ * is reached, and wakes up its waiters after each of them: batches of
+ * all call_rcu threads, and cond_synchronize_rcu() callers, tagged
+ * with the same sequence number complete after a single grace period.
+ */
+struct call_rcu_gp_driver {
+	unsigned long target;
+	unsigned long flags;	/* URCU_CALL_RCU_PAUSE and PAUSED. */
+	int32_t futex;
+	/* call_rcu_data structures to wake up after a grace period. */
+	struct cds_wfs_stack crdp_waiters;
+	/* cond_synchronize_rcu() callers. */
+	struct urcu_wait_queue waiters;
+	struct urcu_wait_policy waiters_policy;
+	/* Protected by call_rcu_mutex. */
+	int started;
+	pthread_t tid;
+};
+
+static struct call_rcu_gp_driver call_rcu_gp_driver = {
+	.crdp_waiters = {
+		.head = CDS_WFS_END,
+		.lock = PTHREAD_MUTEX_INITIALIZER,
+	},
+	.waiters = URCU_WAIT_QUEUE_HEAD_INIT(call_rcu_gp_driver.waiters),
+};
+
 /*
  * If the sched_getcpu() and sysconf(_SC_NPROCESSORS_CONF) calls are
  * available, then we can have call_rcu threads assigned to individual
@@ -268,11 +337,326 @@ static void call_rcu_completion_wake_up(struct call_rcu_completion *completion)
 	}
 }
 
+static
+void free_completion(struct urcu_ref *ref)
+{
+	struct call_rcu_completion *completion;
+
+	completion = caa_container_of(ref, struct call_rcu_completion, ref);
+	free(completion);
+}
+
+static
+void _rcu_barrier_complete(struct rcu_head *head)
+{
+	struct call_rcu_completion_work *work;
+	struct call_rcu_completion *completion;
+
+	work = caa_container_of(head, struct call_rcu_completion_work, head);
+	completion = work->completion;
+	if (!uatomic_sub_return(&completion->barrier_count, 1))
+		call_rcu_completion_wake_up(completion);
+	urcu_ref_put(&completion->ref, free_completion);
+	free(work);
+}
+
+/*
+ * Notify the owner of a threadless call_rcu_data structure that it has
+ * work to do. The eventfd counter is only reset by its reader, so
+ * notifications are never lost.
+ */
+static void call_rcu_notify(struct call_rcu_data *crdp)
+{
+	uint64_t one = 1;
+
+	/* Write to call_rcu lists before notifying. */
+	cmm_smp_mb();
+	if (write(crdp->eventfd, &one, sizeof(one)) < 0) {
+		/* EAGAIN: the eventfd is readable anyway. */
+	}
+}
+
+static void call_rcu_gp_driver_wait(void)
+{
+	/* Read driver target and waiters before read futex */
+	cmm_smp_mb();
+	if (uatomic_read(&call_rcu_gp_driver.futex) == -1)
+		futex_async(&call_rcu_gp_driver.futex, FUTEX_WAIT, -1,
+		      NULL, NULL, 0);
+}
+
+static void call_rcu_gp_driver_wake_up(void)
+{
+	/* Write driver target and waiters before reading/writing futex */
+	cmm_smp_mb();
+	if (caa_unlikely(uatomic_read(&call_rcu_gp_driver.futex) == -1)) {
+		uatomic_set(&call_rcu_gp_driver.futex, 0);
+		futex_async(&call_rcu_gp_driver.futex, FUTEX_WAKE, 1,
+		      NULL, NULL, 0);
+	}
+}
+
+/*
+ * Return whether the grace period driver has nothing left to do: its
+ * target is reached and nobody waits for it.
+ */
+static int call_rcu_gp_driver_idle(void)
+{
+	return cds_wfs_empty(&call_rcu_gp_driver.crdp_waiters)
+		&& cds_wfs_empty(&call_rcu_gp_driver.waiters.stack)
+		&& urcu_gp_seq_done(&rcu_gp_seq,
+			uatomic_read(&call_rcu_gp_driver.target));
+}
+
+/*
+ * Wake up the call_rcu threads and cond_synchronize_rcu() callers
+ * waiting for the grace period driver. They check whether the grace
+ * period they need has completed, and wait again otherwise.
+ */
+static void call_rcu_gp_driver_wake_waiters(void)
+{
+	struct cds_wfs_head *head;
+	struct cds_wfs_node *iter, *iter_n;
+	struct urcu_waiters waiters;
+
+	head = __cds_wfs_pop_all(&call_rcu_gp_driver.crdp_waiters);
+	cds_wfs_for_each_blocking_safe(head, iter, iter_n) {
+		struct call_rcu_data *crdp;
+
+		crdp = caa_container_of(iter, struct call_rcu_data,
+				driver_node);
+		/* The call_rcu thread may queue itself again from now on. */
+		uatomic_set(&crdp->driver_queued, 0);
+		/* Real-time call_rcu threads poll. */
+		if (!(uatomic_read(&crdp->flags) & URCU_CALL_RCU_RT))
+			call_rcu_wake_up(crdp);
+	}
+	urcu_move_waiters(&waiters, &call_rcu_gp_driver.waiters);
+	urcu_wake_all_waiters(&waiters);
+}
+
+/* This is the code run by the grace period driver thread. */
+
+static void *call_rcu_gp_driver_thread(void *arg)
+{
+	/*
+	 * The driver is not an RCU reader: it does not need to be
+	 * registered to perform grace periods.
+	 */
+	uatomic_dec(&call_rcu_gp_driver.futex);
+	/* Decrement futex before reading driver target and waiters */
+	cmm_smp_mb();
+	for (;;) {
+		if (uatomic_read(&call_rcu_gp_driver.flags)
+				& URCU_CALL_RCU_PAUSE) {
+			/* Pause requested: do not start grace periods. */
+			cmm_smp_mb__before_uatomic_or();
+			uatomic_or(&call_rcu_gp_driver.flags,
+				URCU_CALL_RCU_PAUSED);
+			while ((uatomic_read(&call_rcu_gp_driver.flags)
+					& URCU_CALL_RCU_PAUSE) != 0)
+				poll(NULL, 0, 1);
+			uatomic_and(&call_rcu_gp_driver.flags,
+				~URCU_CALL_RCU_PAUSED);
+			cmm_smp_mb__after_uatomic_and();
+		}
+		if (!urcu_gp_seq_done(&rcu_gp_seq,
+				uatomic_read(&call_rcu_gp_driver.target)))
+			synchronize_rcu();
+		call_rcu_gp_driver_wake_waiters();
+		if (call_rcu_gp_driver_idle()) {
+			call_rcu_gp_driver_wait();
+			uatomic_dec(&call_rcu_gp_driver.futex);
+			/*
+			 * Decrement futex before reading driver target
+			 * and waiters.
+			 */
+			cmm_smp_mb();
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Create the grace period driver thread if it does not exist yet.
+ * Caller must hold call_rcu_mutex.
+ */
+static void call_rcu_gp_driver_start(void)
+{
+	int ret;
+
+	if (call_rcu_gp_driver.started)
+		return;
+	ret = pthread_create(&call_rcu_gp_driver.tid, NULL,
+			call_rcu_gp_driver_thread, NULL);
+	if (ret)
+		urcu_die(ret);
+	CMM_STORE_SHARED(call_rcu_gp_driver.started, 1);
+}
+
+/*
+ * Make sure the grace period driver reaches the grace period sequence
+ * number "cookie". If "crdp" is non-NULL, its call_rcu thread is woken
+ * up after the next grace period.
+ */
+static void call_rcu_gp_request(struct call_rcu_data *crdp,
+		unsigned long cookie)
+{
+	unsigned long target, old;
+
+	if (crdp && !uatomic_xchg(&crdp->driver_queued, 1)) {
+		cds_wfs_node_init(&crdp->driver_node);
+		(void) cds_wfs_push(&call_rcu_gp_driver.crdp_waiters,
+				&crdp->driver_node);
+	}
+	target = uatomic_read(&call_rcu_gp_driver.target);
+	while (!URCU_GP_SEQ_GE(target, cookie)) {
+		old = uatomic_cmpxchg(&call_rcu_gp_driver.target,
+				target, cookie);
+		if (old == target)
+			break;
+		target = old;
+	}
+	call_rcu_gp_driver_wake_up();
+}
+
+/*
+ * Wait for the grace period driver to reach the grace period sequence
+ * number "cookie". The caller must not hold up grace periods.
+ */
+static void call_rcu_gp_wait(unsigned long cookie)
+{
+	DEFINE_URCU_WAIT_NODE(wait, URCU_WAIT_WAITING);
+
+	if (!CMM_LOAD_SHARED(call_rcu_gp_driver.started)) {
+		call_rcu_lock(&call_rcu_mutex);
+		call_rcu_gp_driver_start();
+		call_rcu_unlock(&call_rcu_mutex);
+	}
+	while (!urcu_gp_seq_done(&rcu_gp_seq, cookie)) {
+		urcu_wait_node_init(&wait, URCU_WAIT_WAITING);
+		/*
+		 * The implicit memory barrier before urcu_wait_add()
+		 * orders the check above before the driver wakes us up.
+		 */
+		(void) urcu_wait_add(&call_rcu_gp_driver.waiters, &wait);
+		call_rcu_gp_request(NULL, cookie);
+		urcu_adaptative_busy_wait(&wait,
+				&call_rcu_gp_driver.waiters_policy,
+				CMM_LOAD_SHARED(rcu_wait_mode));
+	}
+}
+
+/* Invoke the callbacks of a batch of "crdp", and empty the batch. */
+
+static void call_rcu_invoke_batch(struct call_rcu_data *crdp,
+		struct cds_wfcq_head *head, struct cds_wfcq_tail *tail)
+{
+	struct cds_wfcq_node *cbs, *cbs_tmp_n;
+	unsigned long cbcount = 0;
+
+	urcu_probe2(call_rcu_batch_begin, crdp, uatomic_read(&crdp->qlen));
+	__cds_wfcq_for_each_blocking_safe(head, tail, cbs, cbs_tmp_n) {
+		struct rcu_head *rhp;
+
+		rhp = caa_container_of(cbs, struct rcu_head, next);
+		rhp->func(rhp);
+		cbcount++;
+	}
+	cds_wfcq_init(head, tail);
+	uatomic_sub(&crdp->qlen, cbcount);
+	urcu_probe2(call_rcu_batch_end, crdp, cbcount);
+}
+
+/*
+ * Invoke the batches of "crdp" whose grace period has completed, and
+ * tag the callbacks queued since with the grace period sequence number
+ * they need. The grace period driver is asked for the grace periods of
+ * the pending batches. The grace periods of RCU domains are performed
+ * by gp_sync(gp_sync_arg) instead.
+ */
+static void call_rcu_advance_batches(struct call_rcu_data *crdp)
+{
+	enum cds_wfcq_ret splice_ret;
+	unsigned long cookie;
+
+	if (crdp->gp_sync) {
+		splice_ret = __cds_wfcq_splice_blocking(&crdp->wait_head,
+			&crdp->wait_tail, &crdp->cbs_head, &crdp->cbs_tail);
+		assert(splice_ret != CDS_WFCQ_RET_WOULDBLOCK);
+		if (splice_ret == CDS_WFCQ_RET_SRC_EMPTY)
+			return;
+		crdp->gp_sync(crdp->gp_sync_arg);
+		call_rcu_invoke_batch(crdp, &crdp->wait_head,
+				&crdp->wait_tail);
+		return;
+	}
+
+	while (!cds_wfcq_empty(&crdp->wait_head, &crdp->wait_tail)
+			&& urcu_gp_seq_done(&rcu_gp_seq, crdp->wait_cookie)) {
+		call_rcu_invoke_batch(crdp, &crdp->wait_head,
+				&crdp->wait_tail);
+		(void) __cds_wfcq_splice_blocking(&crdp->wait_head,
+			&crdp->wait_tail, &crdp->next_head, &crdp->next_tail);
+		crdp->wait_cookie = crdp->next_cookie;
+	}
+
+	/*
+	 * While the "wait" batch is pending, callbacks needing the same
+	 * grace period join it. The others need the following grace
+	 * period at most: they join the "next" batch.
+	 */
+	if (cds_wfcq_empty(&crdp->wait_head, &crdp->wait_tail)) {
+		splice_ret = __cds_wfcq_splice_blocking(&crdp->wait_head,
+			&crdp->wait_tail, &crdp->cbs_head, &crdp->cbs_tail);
+		if (splice_ret == CDS_WFCQ_RET_SRC_EMPTY)
+			return;
+		crdp->wait_cookie = urcu_gp_seq_snap(&rcu_gp_seq);
+	} else {
+		struct cds_wfcq_head cbs_tmp_head;
+		struct cds_wfcq_tail cbs_tmp_tail;
+
+		cds_wfcq_init(&cbs_tmp_head, &cbs_tmp_tail);
+		splice_ret = __cds_wfcq_splice_blocking(&cbs_tmp_head,
+			&cbs_tmp_tail, &crdp->cbs_head, &crdp->cbs_tail);
+		if (splice_ret != CDS_WFCQ_RET_SRC_EMPTY) {
+			cookie = urcu_gp_seq_snap(&rcu_gp_seq);
+			if (cookie == crdp->wait_cookie) {
+				(void) __cds_wfcq_splice_blocking(
+					&crdp->wait_head, &crdp->wait_tail,
+					&cbs_tmp_head, &cbs_tmp_tail);
+			} else {
+				(void) __cds_wfcq_splice_blocking(
+					&crdp->next_head, &crdp->next_tail,
+					&cbs_tmp_head, &cbs_tmp_tail);
+				crdp->next_cookie = cookie;
+			}
+		}
+	}
+	if (cds_wfcq_empty(&crdp->next_head, &crdp->next_tail))
+		call_rcu_gp_request(crdp, crdp->wait_cookie);
+	else
+		call_rcu_gp_request(crdp, crdp->next_cookie);
+}
+
+/*
+ * Put the pending batches of "crdp" back at the head of its call_rcu
+ * queue, in order.
+ */
+static void call_rcu_requeue_batches(struct call_rcu_data *crdp)
+{
+	(void) __cds_wfcq_splice_blocking(&crdp->wait_head, &crdp->wait_tail,
+		&crdp->next_head, &crdp->next_tail);
+	(void) __cds_wfcq_splice_blocking(&crdp->wait_head, &crdp->wait_tail,
+		&crdp->cbs_head, &crdp->cbs_tail);
+	(void) __cds_wfcq_splice_blocking(&crdp->cbs_head, &crdp->cbs_tail,
+		&crdp->wait_head, &crdp->wait_tail);
+}
+
 /* This is the code run by each call_rcu thread. */
 
 static void *call_rcu_thread(void *arg)
 {
-	unsigned long cbcount;
 	struct call_rcu_data *crdp = (struct call_rcu_data *) arg;
 	int rt = !!(uatomic_read(&crdp->flags) & URCU_CALL_RCU_RT);
 	int ret;
@@ -293,11 +677,6 @@ static void *call_rcu_thread(void *arg)
 		cmm_smp_mb();
 	}
 	for (;;) {
-		struct cds_wfcq_head cbs_tmp_head;
-		struct cds_wfcq_tail cbs_tmp_tail;
-		struct cds_wfcq_node *cbs, *cbs_tmp_n;
-		enum cds_wfcq_ret splice_ret;
-
 		if (uatomic_read(&crdp->flags) & URCU_CALL_RCU_PAUSE) {
 			/*
 			 * Pause requested. Become quiescent: remove
@@ -315,25 +694,7 @@ static void *call_rcu_thread(void *arg)
 			rcu_register_thread();
 		}
 
-		cds_wfcq_init(&cbs_tmp_head, &cbs_tmp_tail);
-		splice_ret = __cds_wfcq_splice_blocking(&cbs_tmp_head,
-			&cbs_tmp_tail, &crdp->cbs_head, &crdp->cbs_tail);
-		assert(splice_ret != CDS_WFCQ_RET_WOULDBLOCK);
-		assert(splice_ret != CDS_WFCQ_RET_DEST_NON_EMPTY);
-		if (splice_ret != CDS_WFCQ_RET_SRC_EMPTY) {
-			synchronize_rcu();
-			cbcount = 0;
-			__cds_wfcq_for_each_blocking_safe(&cbs_tmp_head,
-					&cbs_tmp_tail, cbs, cbs_tmp_n) {
-				struct rcu_head *rhp;
-
-				rhp = caa_container_of(cbs,
-					struct rcu_head, next);
-				rhp->func(rhp);
-				cbcount++;
-			}
-			uatomic_sub(&crdp->qlen, cbcount);
-		}
+		call_rcu_advance_batches(crdp);
 		if (uatomic_read(&crdp->flags) & URCU_CALL_RCU_STOP)
 			break;
 		rcu_thread_offline();
@@ -356,6 +717,8 @@ static void *call_rcu_thread(void *arg)
 		}
 		rcu_thread_online();
 	}
+	/* Leave the pending batches to call_rcu_data_free(). */
+	call_rcu_requeue_batches(crdp);
 	if (!rt) {
 		/*
 		 * Read call_rcu list before write futex.
@@ -376,7 +739,9 @@ static void *call_rcu_thread(void *arg)
 
 static void call_rcu_data_init(struct call_rcu_data **crdpp,
 			       unsigned long flags,
-			       int cpu_affinity)
+			       int cpu_affinity,
+			       void (*gp_sync)(void *arg),
+			       void *gp_sync_arg)
 {
 	struct call_rcu_data *crdp;
 	int ret;
@@ -391,8 +756,25 @@ static void call_rcu_data_init(struct call_rcu_data **crdpp,
 	crdp->flags = flags;
 	cds_list_add(&crdp->list, &call_rcu_data_list);
 	crdp->cpu_affinity = cpu_affinity;
+	crdp->gp_sync = gp_sync;
+	crdp->gp_sync_arg = gp_sync_arg;
+	crdp->eventfd = -1;
+	if (flags & URCU_CALL_RCU_THREADLESS) {
+#ifdef HAVE_SYS_EVENTFD_H
+		crdp->eventfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (crdp->eventfd < 0)
+			urcu_die(errno);
+#endif
+		cds_wfcq_init(&crdp->ready_head, &crdp->ready_tail);
+	}
+	cds_wfcq_init(&crdp->wait_head, &crdp->wait_tail);
+	cds_wfcq_init(&crdp->next_head, &crdp->next_tail);
 	cmm_smp_mb();  /* Structure initialized before pointer is planted. */
 	*crdpp = crdp;
+	if (flags & URCU_CALL_RCU_THREADLESS)
+		return;
+	if (!gp_sync)
+		call_rcu_gp_driver_start();
 	ret = pthread_create(&crdp->tid, NULL, call_rcu_thread, crdp);
 	if (ret)
 		urcu_die(ret);
@@ -427,7 +809,8 @@ struct call_rcu_data *get_cpu_call_rcu_data(int cpu)
 
 /*
  * Return the tid corresponding to the call_rcu thread whose
- * call_rcu_data structure is specified.
+ * call_rcu_data structure is specified. Threadless call_rcu_data
+ * structures have no thread: the returned value is meaningless.
  */
 
 pthread_t get_call_rcu_thread(struct call_rcu_data *crdp)
@@ -436,7 +819,19 @@ pthread_t get_call_rcu_thread(struct call_rcu_data *crdp)
 }
 
 /*
- * Create a call_rcu_data structure (with thread) and return a pointer.
+ * Return the eventfd of a threadless call_rcu_data structure, which
+ * becomes readable when rcu_process_callbacks() has work to do, or -1
+ * for call_rcu_data structures served by a call_rcu thread.
+ */
+
+int get_call_rcu_eventfd(struct call_rcu_data *crdp)
+{
+	return crdp->eventfd;
+}
+
+/*
+ * Create a call_rcu_data structure (with thread, unless
+ * URCU_CALL_RCU_THREADLESS is set) and return a pointer.
  */
 
 static struct call_rcu_data *__create_call_rcu_data(unsigned long flags,
@@ -444,7 +839,7 @@ static struct call_rcu_data *__create_call_rcu_data(unsigned long flags,
 {
 	struct call_rcu_data *crdp;
 
-	call_rcu_data_init(&crdp, flags, cpu_affinity);
+	call_rcu_data_init(&crdp, flags, cpu_affinity, NULL, NULL);
 	return crdp;
 }
 
@@ -453,6 +848,12 @@ struct call_rcu_data *create_call_rcu_data(unsigned long flags,
 {
 	struct call_rcu_data *crdp;
 
+#ifndef HAVE_SYS_EVENTFD_H
+	if (flags & URCU_CALL_RCU_THREADLESS) {
+		errno = ENOSYS;
+		return NULL;
+	}
+#endif
 	call_rcu_lock(&call_rcu_mutex);
 	crdp = __create_call_rcu_data(flags, cpu_affinity);
 	call_rcu_unlock(&call_rcu_mutex);
@@ -520,11 +921,32 @@ struct call_rcu_data *get_default_call_rcu_data(void)
 		call_rcu_unlock(&call_rcu_mutex);
 		return default_call_rcu_data;
 	}
-	call_rcu_data_init(&default_call_rcu_data, 0, -1);
+	call_rcu_data_init(&default_call_rcu_data, 0, -1, NULL, NULL);
 	call_rcu_unlock(&call_rcu_mutex);
 	return default_call_rcu_data;
 }
 
+/*
+ * Return the call_rcu_data structure of an RCU domain, stored at
+ * *crdpp, creating it if need be. Its call_rcu thread invokes
+ * gp_sync(gp_sync_arg) rather than synchronize_rcu() to wait for a
+ * grace period of the domain. Unused by flavors without RCU domains.
+ */
+static __attribute__((unused))
+struct call_rcu_data *get_domain_call_rcu_data(
+		struct call_rcu_data **crdpp,
+		void (*gp_sync)(void *arg),
+		void *gp_sync_arg)
+{
+	if (CMM_LOAD_SHARED(*crdpp) != NULL)
+		return rcu_dereference(*crdpp);
+	call_rcu_lock(&call_rcu_mutex);
+	if (*crdpp == NULL)
+		call_rcu_data_init(crdpp, 0, -1, gp_sync, gp_sync_arg);
+	call_rcu_unlock(&call_rcu_mutex);
+	return *crdpp;
+}
+
 /*
  * Return the call_rcu_data structure that applies to the currently
  * running thread.  Any call_rcu_data structure assigned specifically
@@ -591,6 +1013,11 @@ int create_all_cpu_call_rcu_data(unsigned long flags)
 	struct call_rcu_data *crdp;
 	int ret;
 
+	/* Per-CPU callbacks have no owner thread to invoke them. */
+	if (flags & URCU_CALL_RCU_THREADLESS) {
+		errno = EINVAL;
+		return -EINVAL;
+	}
 	call_rcu_lock(&call_rcu_mutex);
 	alloc_cpu_call_rcu_data();
 	call_rcu_unlock(&call_rcu_mutex);
@@ -642,11 +1069,107 @@ static void _call_rcu(struct rcu_head *head,
 		      void (*func)(struct rcu_head *head),
 		      struct call_rcu_data *crdp)
 {
+	bool was_nonempty;
+
 	cds_wfcq_node_init(&head->next);
 	head->func = func;
-	cds_wfcq_enqueue(&crdp->cbs_head, &crdp->cbs_tail, &head->next);
+	was_nonempty = cds_wfcq_enqueue(&crdp->cbs_head, &crdp->cbs_tail,
+			&head->next);
 	uatomic_inc(&crdp->qlen);
-	wake_call_rcu_thread(crdp);
+	if (!(_CMM_LOAD_SHARED(crdp->flags) & URCU_CALL_RCU_THREADLESS)) {
+		wake_call_rcu_thread(crdp);
+	} else if (!was_nonempty) {
+		/*
+		 * The owner splices the whole queue at once: only the
+		 * first callback of each batch needs to notify it.
+		 */
+		call_rcu_notify(crdp);
+	}
+}
+
+/*
+ * Invoked by the default call_rcu thread after a grace period, on
+ * behalf of a threadless call_rcu_data structure.
+ */
+static void call_rcu_threadless_gp(struct rcu_head *head)
+{
+	struct call_rcu_data *crdp;
+
+	crdp = caa_container_of(head, struct call_rcu_data, gp_head);
+	/*
+	 * Clear gp_queued before notifying, so the owner requeues
+	 * gp_head if its batch needs a later grace period.
+	 */
+	uatomic_set(&crdp->gp_queued, 0);
+	call_rcu_notify(crdp);
+}
+
+/*
+ * Invoke up to "budget" callbacks of the threadless call_rcu_data
+ * structure "crdp" whose grace period has completed, and start a grace
+ * period for the callbacks queued since the previous batch. Return the
+ * number of callbacks invoked. The eventfd of "crdp" is notified again
+ * if ready callbacks remain, and when the grace period of the pending
+ * batch completes.
+ *
+ * Must only be called by the thread owning "crdp", which must be a
+ * registered RCU reader outside of any read-side critical section.
+ * Grace periods are performed by the default call_rcu thread, hence
+ * QSBR owners must report quiescent states, or be offline while
+ * waiting on the eventfd.
+ */
+unsigned long rcu_process_callbacks(struct call_rcu_data *crdp,
+				    unsigned long budget)
+{
+	struct cds_wfcq_node *cbs;
+	unsigned long cbcount = 0;
+	uint64_t count;
+
+	if (!(crdp->flags & URCU_CALL_RCU_THREADLESS))
+		return 0;
+	/* Reset the eventfd before looking for work. */
+	if (read(crdp->eventfd, &count, sizeof(count)) < 0) {
+		/* EAGAIN: no notification pending. */
+	}
+	cmm_smp_mb();
+
+	if (!cds_wfcq_empty(&crdp->wait_head, &crdp->wait_tail)
+			&& poll_state_synchronize_rcu(crdp->wait_cookie))
+		(void) __cds_wfcq_splice_blocking(&crdp->ready_head,
+			&crdp->ready_tail, &crdp->wait_head,
+			&crdp->wait_tail);
+	if (cds_wfcq_empty(&crdp->wait_head, &crdp->wait_tail)) {
+		enum cds_wfcq_ret splice_ret;
+
+		splice_ret = __cds_wfcq_splice_blocking(&crdp->wait_head,
+			&crdp->wait_tail, &crdp->cbs_head, &crdp->cbs_tail);
+		if (splice_ret != CDS_WFCQ_RET_SRC_EMPTY)
+			crdp->wait_cookie = get_state_synchronize_rcu();
+	}
+	if (!cds_wfcq_empty(&crdp->wait_head, &crdp->wait_tail)
+			&& !uatomic_read(&crdp->gp_queued)) {
+		uatomic_set(&crdp->gp_queued, 1);
+		_call_rcu(&crdp->gp_head, call_rcu_threadless_gp,
+			get_default_call_rcu_data());
+	}
+
+	urcu_probe2(call_rcu_batch_begin, crdp, uatomic_read(&crdp->qlen));
+	while (cbcount < budget) {
+		struct rcu_head *rhp;
+
+		cbs = __cds_wfcq_dequeue_blocking(&crdp->ready_head,
+				&crdp->ready_tail);
+		if (!cbs)
+			break;
+		rhp = caa_container_of(cbs, struct rcu_head, next);
+		rhp->func(rhp);
+		cbcount++;
+	}
+	uatomic_sub(&crdp->qlen, cbcount);
+	urcu_probe2(call_rcu_batch_end, crdp, cbcount);
+	if (!cds_wfcq_empty(&crdp->ready_head, &crdp->ready_tail))
+		call_rcu_notify(crdp);
+	return cbcount;
 }
 
 /*
@@ -675,6 +1198,54 @@ void call_rcu(struct rcu_head *head,
 	rcu_read_unlock();
 }
 
+/*
+ * Wait for the default call_rcu thread to be done with the gp_head of
+ * the threadless call_rcu_data structure "crdp", then gather all its
+ * callbacks, whether their grace period has completed or not, in its
+ * call_rcu queue.
+ */
+static void call_rcu_threadless_stop(struct call_rcu_data *crdp)
+{
+	struct call_rcu_completion *completion;
+	struct call_rcu_completion_work *work;
+	int was_online;
+
+	/* The default call_rcu thread may wait for us in QSBR. */
+	was_online = rcu_read_ongoing();
+	if (was_online)
+		rcu_thread_offline();
+
+	completion = calloc(sizeof(*completion), 1);
+	work = calloc(sizeof(*work), 1);
+	if (!completion || !work)
+		urcu_die(errno);
+	urcu_ref_set(&completion->ref, 2);
+	completion->barrier_count = 1;
+	work->completion = completion;
+	/* Invoked after gp_head, which is queued on the same thread. */
+	_call_rcu(&work->head, _rcu_barrier_complete,
+		get_default_call_rcu_data());
+	for (;;) {
+		uatomic_dec(&completion->futex);
+		/* Decrement futex before reading barrier_count */
+		cmm_smp_mb();
+		if (!uatomic_read(&completion->barrier_count))
+			break;
+		call_rcu_completion_wait(completion);
+	}
+	urcu_ref_put(&completion->ref, free_completion);
+
+	if (was_online)
+		rcu_thread_online();
+
+	(void) __cds_wfcq_splice_blocking(&crdp->ready_head, &crdp->ready_tail,
+		&crdp->wait_head, &crdp->wait_tail);
+	(void) __cds_wfcq_splice_blocking(&crdp->ready_head, &crdp->ready_tail,
+		&crdp->cbs_head, &crdp->cbs_tail);
+	(void) __cds_wfcq_splice_blocking(&crdp->cbs_head, &crdp->cbs_tail,
+		&crdp->ready_head, &crdp->ready_tail);
+}
+
 /*
  * Free up the specified call_rcu_data structure, terminating the
  * associated call_rcu thread.  The caller must have previously
@@ -706,11 +1277,16 @@ void call_rcu_data_free(struct call_rcu_data *crdp)
 	if (crdp == NULL || crdp == default_call_rcu_data) {
 		return;
 	}
-	if ((uatomic_read(&crdp->flags) & URCU_CALL_RCU_STOPPED) == 0) {
+	if (uatomic_read(&crdp->flags) & URCU_CALL_RCU_THREADLESS) {
+		call_rcu_threadless_stop(crdp);
+	} else if ((uatomic_read(&crdp->flags) & URCU_CALL_RCU_STOPPED) == 0) {
 		uatomic_or(&crdp->flags, URCU_CALL_RCU_STOP);
 		wake_call_rcu_thread(crdp);
 		while ((uatomic_read(&crdp->flags) & URCU_CALL_RCU_STOPPED) == 0)
 			poll(NULL, 0, 1);
+		/* Wait for the grace period driver to let go of crdp. */
+		while (uatomic_read(&crdp->driver_queued))
+			poll(NULL, 0, 1);
 	}
 	if (!cds_wfcq_empty(&crdp->cbs_head, &crdp->cbs_tail)) {
 		/* Create default call rcu data if need be */
@@ -727,6 +1303,8 @@ void call_rcu_data_free(struct call_rcu_data *crdp)
 	cds_list_del(&crdp->list);
 	call_rcu_unlock(&call_rcu_mutex);
 
+	if (crdp->eventfd >= 0)
+		(void) close(crdp->eventfd);
 	free(crdp);
 }
 
@@ -770,31 +1348,10 @@ void free_all_cpu_call_rcu_data(void)
 	free(crdp);
 }
 
-static
-void free_completion(struct urcu_ref *ref)
-{
-	struct call_rcu_completion *completion;
-
-	completion = caa_container_of(ref, struct call_rcu_completion, ref);
-	free(completion);
-}
-
-static
-void _rcu_barrier_complete(struct rcu_head *head)
-{
-	struct call_rcu_completion_work *work;
-	struct call_rcu_completion *completion;
-
-	work = caa_container_of(head, struct call_rcu_completion_work, head);
-	completion = work->completion;
-	if (!uatomic_sub_return(&completion->barrier_count, 1))
-		call_rcu_completion_wake_up(completion);
-	urcu_ref_put(&completion->ref, free_completion);
-	free(work);
-}
-
 /*
- * Wait for all in-flight call_rcu callbacks to complete execution.
+ * Wait for all in-flight call_rcu callbacks to complete execution,
+ * except those of threadless call_rcu_data structures, which are
+ * invoked by rcu_process_callbacks().
  */
 void rcu_barrier(void)
 {
@@ -826,8 +1383,10 @@ void rcu_barrier(void)
 		urcu_die(errno);
 
 	call_rcu_lock(&call_rcu_mutex);
-	cds_list_for_each_entry(crdp, &call_rcu_data_list, list)
-		count++;
+	cds_list_for_each_entry(crdp, &call_rcu_data_list, list) {
+		if (!(crdp->flags & URCU_CALL_RCU_THREADLESS))
+			count++;
+	}
 
 	/* Referenced by rcu_barrier() and each call_rcu thread. */
 	urcu_ref_set(&completion->ref, count + 1);
@@ -836,6 +1395,9 @@ void rcu_barrier(void)
 	cds_list_for_each_entry(crdp, &call_rcu_data_list, list) {
 		struct call_rcu_completion_work *work;
 
+		/* Only the owner thread can invoke its callbacks. */
+		if (crdp->flags & URCU_CALL_RCU_THREADLESS)
+			continue;
 		work = calloc(sizeof(*work), 1);
 		if (!work)
 			urcu_die(errno);
@@ -874,14 +1436,27 @@ void call_rcu_before_fork(void)
 	call_rcu_lock(&call_rcu_mutex);
 
 	cds_list_for_each_entry(crdp, &call_rcu_data_list, list) {
+		if (crdp->flags & URCU_CALL_RCU_THREADLESS)
+			continue;
 		uatomic_or(&crdp->flags, URCU_CALL_RCU_PAUSE);
 		cmm_smp_mb__after_uatomic_or();
 		wake_call_rcu_thread(crdp);
 	}
 	cds_list_for_each_entry(crdp, &call_rcu_data_list, list) {
+		if (crdp->flags & URCU_CALL_RCU_THREADLESS)
+			continue;
 		while ((uatomic_read(&crdp->flags) & URCU_CALL_RCU_PAUSED) == 0)
 			poll(NULL, 0, 1);
 	}
+	/* Do not fork in the middle of a grace period of the driver. */
+	if (call_rcu_gp_driver.started) {
+		uatomic_or(&call_rcu_gp_driver.flags, URCU_CALL_RCU_PAUSE);
+		cmm_smp_mb__after_uatomic_or();
+		call_rcu_gp_driver_wake_up();
+		while ((uatomic_read(&call_rcu_gp_driver.flags)
+				& URCU_CALL_RCU_PAUSED) == 0)
+			poll(NULL, 0, 1);
+	}
 }
 
 /*
@@ -899,6 +1474,10 @@ void call_rcu_after_fork_parent(void)
 		while ((uatomic_read(&crdp->flags) & URCU_CALL_RCU_PAUSED) != 0)
 			poll(NULL, 0, 1);
 	}
+	uatomic_and(&call_rcu_gp_driver.flags, ~URCU_CALL_RCU_PAUSE);
+	while ((uatomic_read(&call_rcu_gp_driver.flags)
+			& URCU_CALL_RCU_PAUSED) != 0)
+		poll(NULL, 0, 1);
 	call_rcu_unlock(&call_rcu_mutex);
 }
 
@@ -914,6 +1493,18 @@ void call_rcu_after_fork_child(void)
 	/* Release the mutex. */
 	call_rcu_unlock(&call_rcu_mutex);
 
+	/*
+	 * The grace period driver thread does not exist in the child:
+	 * it is created again on demand. Nobody waits for it.
+	 */
+	call_rcu_gp_driver.started = 0;
+	call_rcu_gp_driver.flags = 0;
+	call_rcu_gp_driver.futex = 0;
+	cds_wfs_init(&call_rcu_gp_driver.crdp_waiters);
+	urcu_wait_queue_init(&call_rcu_gp_driver.waiters);
+	cds_list_for_each_entry(crdp, &call_rcu_data_list, list)
+		crdp->driver_queued = 0;
+
 	/* Do nothing when call_rcu() has not been used */
 	if (cds_list_empty(&call_rcu_data_list))
 		return;
@@ -934,11 +1525,27 @@ void call_rcu_after_fork_child(void)
 	/*
 	 * Dispose of all of the rest of the call_rcu_data structures.
 	 * Leftover call_rcu callbacks will be merged into the new
-	 * default call_rcu thread queue.
+	 * default call_rcu thread queue. RCU domains keep their
+	 * call_rcu_data structure: only recreate its thread. Threadless
+	 * call_rcu_data structures are kept for their owner, which may
+	 * be the thread calling fork().
 	 */
 	cds_list_for_each_entry_safe(crdp, next, &call_rcu_data_list, list) {
 		if (crdp == default_call_rcu_data)
 			continue;
+		if (crdp->flags & URCU_CALL_RCU_THREADLESS)
+			continue;
+		if (crdp->gp_sync) {
+			int ret;
+
+			uatomic_and(&crdp->flags, URCU_CALL_RCU_RT);
+			crdp->futex = 0;
+			ret = pthread_create(&crdp->tid, NULL,
+					call_rcu_thread, crdp);
+			if (ret)
+				urcu_die(ret);
+			continue;
+		}
 		uatomic_set(&crdp->flags, URCU_CALL_RCU_STOPPED);
 		call_rcu_data_free(crdp);
 	}
@@ -50,6 +50,7 @@ struct call_rcu_data;
 #define URCU_CALL_RCU_STOPPED	(1U << 3)
 #define URCU_CALL_RCU_PAUSE	(1U << 4)
 #define URCU_CALL_RCU_PAUSED	(1U << 5)
+#define URCU_CALL_RCU_THREADLESS	(1U << 6)
 
 /*
  * The rcu_head data structure is placed in the structure to be freed
@@ -81,6 +82,9 @@ struct call_rcu_data *get_cpu_call_rcu_data(int cpu);
 struct call_rcu_data *get_thread_call_rcu_data(void);
 struct call_rcu_data *get_call_rcu_data(void);
 pthread_t get_call_rcu_thread(struct call_rcu_data *crdp);
+int get_call_rcu_eventfd(struct call_rcu_data *crdp);
+unsigned long rcu_process_callbacks(struct call_rcu_data *crdp,
+				    unsigned long budget);
 
 void set_thread_call_rcu_data(struct call_rcu_data *crdp);
 int set_cpu_call_rcu_data(int cpu, struct call_rcu_data *crdp);
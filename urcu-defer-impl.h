@@ -50,6 +50,7 @@
 #include <urcu/system.h>
 #include <urcu/tls-compat.h>
 #include "urcu-die.h"
+#include "urcu-sdt.h"
 
 /*
  * Number of entries in the per-thread defer queue. Must be power of 2.
@@ -246,8 +247,10 @@ static void _rcu_defer_barrier_thread(void)
 	num_items = head - URCU_TLS(defer_queue).tail;
 	if (caa_unlikely(!num_items))
 		return;
+	urcu_probe1(defer_barrier_begin, num_items);
 	synchronize_rcu();
 	rcu_defer_barrier_queue(&URCU_TLS(defer_queue), head);
+	urcu_probe1(defer_barrier_end, num_items);
 }
 
 void rcu_defer_barrier_thread(void)
@@ -290,9 +293,11 @@ void rcu_defer_barrier(void)
 		 */
 		goto end;
 	}
+	urcu_probe1(defer_barrier_begin, num_items);
 	synchronize_rcu();
 	cds_list_for_each_entry(index, &registry_defer, list)
 		rcu_defer_barrier_queue(index, index->last_head);
+	urcu_probe1(defer_barrier_end, num_items);
 end:
 	mutex_unlock(&rcu_defer_mutex);
 }
@@ -43,6 +43,12 @@ struct rcu_flavor_struct {
 	void (*unregister_thread)(void);
 
 	void (*barrier)(void);
+
+	unsigned long (*update_get_state_synchronize_rcu)(void);
+	unsigned long (*update_start_poll_synchronize_rcu)(void);
+	int (*update_poll_state_synchronize_rcu)(unsigned long cookie);
+	unsigned long (*update_synchronize_rcu_expedited)(void);
+	void (*update_cond_synchronize_rcu)(unsigned long cookie);
 };
 
 #define DEFINE_RCU_FLAVOR(x)				\
@@ -59,6 +65,16 @@ const struct rcu_flavor_struct x = {			\
 	.register_thread	= rcu_register_thread,	\
 	.unregister_thread	= rcu_unregister_thread,\
 	.barrier		= rcu_barrier,		\
+	.update_get_state_synchronize_rcu		\
+			= get_state_synchronize_rcu,	\
+	.update_start_poll_synchronize_rcu		\
+			= start_poll_synchronize_rcu,	\
+	.update_poll_state_synchronize_rcu		\
+			= poll_state_synchronize_rcu,	\
+	.update_synchronize_rcu_expedited		\
+			= synchronize_rcu_expedited,	\
+	.update_cond_synchronize_rcu			\
+			= cond_synchronize_rcu,		\
 }
 
 extern const struct rcu_flavor_struct rcu_flavor;
@@ -0,0 +1,100 @@
+#ifndef _URCU_GP_STATS_INTERNAL_H
+#define _URCU_GP_STATS_INTERNAL_H
+
+/*
+ * urcu-gp-stats.h
+ *
+ * Userspace RCU library - grace period statistics
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <time.h>
+#include <errno.h>
+#include <urcu/uatomic.h>
+#include <urcu/gp-stats.h>
+
+#include "urcu-die.h"
+
+/*
+ * Statistics are updated with atomic operations on the slow paths of
+ * the update side only: grace periods of several domains may run
+ * concurrently. Readers never touch them.
+ */
+
+static inline
+unsigned long urcu_gp_stats_now_us(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts))
+		urcu_die(errno);
+	return (unsigned long) ts.tv_sec * 1000000UL + ts.tv_nsec / 1000L;
+}
+
+static inline
+void urcu_gp_stats_add(unsigned long *counter, unsigned long count)
+{
+	if (count)
+		uatomic_add(counter, count);
+}
+
+/* Account for a synchronize_rcu() call started at "start_us". */
+static inline
+void urcu_gp_stats_latency(struct rcu_gp_stats *stats, unsigned long start_us)
+{
+	unsigned long us = urcu_gp_stats_now_us() - start_us;
+	unsigned int bucket = 0;
+
+	while (us >>= 1)
+		bucket++;
+	if (bucket >= RCU_GP_STATS_NR_BUCKETS)
+		bucket = RCU_GP_STATS_NR_BUCKETS - 1;
+	uatomic_inc(&stats->latency[bucket]);
+}
+
+/*
+ * Copy the statistics into "dest". Each counter is read atomically,
+ * but not all counters at once.
+ */
+static inline
+void urcu_gp_stats_get(struct rcu_gp_stats *stats, struct rcu_gp_stats *dest)
+{
+	unsigned int i;
+
+	dest->nr_gp = uatomic_read(&stats->nr_gp);
+	dest->nr_piggyback = uatomic_read(&stats->nr_piggyback);
+	dest->nr_readers_scanned = uatomic_read(&stats->nr_readers_scanned);
+	dest->nr_sleeps = uatomic_read(&stats->nr_sleeps);
+	for (i = 0; i < RCU_GP_STATS_NR_BUCKETS; i++)
+		dest->latency[i] = uatomic_read(&stats->latency[i]);
+}
+
+static inline
+void urcu_gp_stats_reset(struct rcu_gp_stats *stats)
+{
+	unsigned int i;
+
+	uatomic_set(&stats->nr_gp, 0);
+	uatomic_set(&stats->nr_piggyback, 0);
+	uatomic_set(&stats->nr_readers_scanned, 0);
+	uatomic_set(&stats->nr_sleeps, 0);
+	for (i = 0; i < RCU_GP_STATS_NR_BUCKETS; i++)
+		uatomic_set(&stats->latency[i], 0);
+}
+
+#endif /* _URCU_GP_STATS_INTERNAL_H */
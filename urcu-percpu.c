@@ -0,0 +1,405 @@
+/*
+ * urcu-percpu.c
+ *
+ * Userspace RCU library, per-CPU counters flavor
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#define _GNU_SOURCE
+#define _LGPL_SOURCE
+#include <stdio.h>
+#include <pthread.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "urcu/wfcqueue.h"
+#include "urcu/map/urcu-percpu.h"
+#include "urcu/static/urcu-percpu.h"
+#include "urcu-pointer.h"
+#include "urcu/tls-compat.h"
+
+#include "urcu-die.h"
+#include "urcu-wait.h"
+#include "urcu-poll.h"
+#include "urcu-gp-stats.h"
+#include "urcu-sdt.h"
+
+/* Do not #define _LGPL_SOURCE to ensure we can emit the wrapper symbols */
+#undef _LGPL_SOURCE
+#include "urcu-percpu.h"
+#define _LGPL_SOURCE
+
+/*
+ * Active attempts to check for reader Q.S. before calling futex(), when
+ * no recent grace period tells better (see urcu-wait.h).
+ */
+#define RCU_QS_ACTIVE_ATTEMPTS 100
+
+/* enum rcu_wait_mode, set by rcu_set_wait_mode(). */
+static int rcu_wait_mode;
+
+/* Returned by rcu_get_gp_stats(). */
+static struct rcu_gp_stats rcu_stats;
+
+/*
+ * How long recent grace periods waited for readers, and threads waited
+ * for grace periods started by others.
+ */
+static struct urcu_wait_policy rcu_gp_wait_policy;
+static struct urcu_wait_policy rcu_waiters_policy;
+
+static int init_done;
+
+void __attribute__((constructor)) rcu_init(void);
+
+static pthread_mutex_t rcu_gp_lock = PTHREAD_MUTEX_INITIALIZER;
+struct rcu_gp rcu_gp;
+
+/*
+ * Written to by readers running on each CPU. Read by the writers.
+ */
+struct rcu_percpu_count rcu_percpu_count[RCU_PERCPU_MAX_CPUS];
+
+/*
+ * Grace period sequence number, used by the grace period polling API.
+ * Written to only by writer with rcu_gp_lock held.
+ */
+static unsigned long rcu_gp_seq;
+
+/*
+ * Number of synchronize_rcu_expedited() callers currently waiting for a
+ * grace period. While non-zero, wait_for_readers() busy-waits rather
+ * than sleeping on rcu_gp.futex.
+ */
+static int rcu_gp_expedited;
+
+/*
+ * Written to only by each individual reader.
+ */
+DEFINE_URCU_TLS(struct rcu_reader, rcu_reader);
+
+/*
+ * Queue keeping threads awaiting to wait for a grace period. Contains
+ * struct gp_waiters_thread objects.
+ */
+static DEFINE_URCU_WAIT_QUEUE(gp_waiters);
+
+static void mutex_lock(pthread_mutex_t *mutex)
+{
+	int ret;
+
+#ifndef DISTRUST_SIGNALS_EXTREME
+	ret = pthread_mutex_lock(mutex);
+	if (ret)
+		urcu_die(ret);
+#else /* #ifndef DISTRUST_SIGNALS_EXTREME */
+	while ((ret = pthread_mutex_trylock(mutex)) != 0) {
+		if (ret != EBUSY && ret != EINTR)
+			urcu_die(ret);
+		poll(NULL,0,10);
+	}
+#endif /* #else #ifndef DISTRUST_SIGNALS_EXTREME */
+}
+
+static void mutex_unlock(pthread_mutex_t *mutex)
+{
+	int ret;
+
+	ret = pthread_mutex_unlock(mutex);
+	if (ret)
+		urcu_die(ret);
+}
+
+/*
+ * Return whether all read-side critical sections which incremented the
+ * lock counters of "phase" before this call have completed.
+ */
+static int readers_done(unsigned long phase, unsigned int nr_cpus)
+{
+	unsigned long locks = 0, unlocks = 0;
+	unsigned int cpu;
+
+	for (cpu = 0; cpu < nr_cpus; cpu++)
+		unlocks += CMM_LOAD_SHARED(rcu_percpu_count[cpu].unlock[phase]);
+	/*
+	 * Sum unlock counters before lock counters, so an unlock
+	 * accounted for in the first sum always has its lock
+	 * accounted for in the second.
+	 */
+	cmm_smp_mb();
+	for (cpu = 0; cpu < nr_cpus; cpu++)
+		locks += CMM_LOAD_SHARED(rcu_percpu_count[cpu].lock[phase]);
+	return locks == unlocks;
+}
+
+/*
+ * synchronize_rcu() waiting. Single thread.
+ */
+static void wait_gp(void)
+{
+	/* Read reader counters before read futex */
+	cmm_smp_rmb();
+	/*
+	 * The write futex before read rcu_gp_expedited ordering is
+	 * provided by wait_for_readers().
+	 */
+	if (uatomic_read(&rcu_gp.futex) == -1
+			&& !uatomic_read(&rcu_gp_expedited)) {
+		uatomic_inc(&rcu_stats.nr_sleeps);
+		futex_async(&rcu_gp.futex, FUTEX_WAIT, -1,
+		      NULL, NULL, 0);
+	}
+}
+
+static void wait_for_readers(unsigned long phase, unsigned int nr_cpus)
+{
+	unsigned int wait_loops = 0;
+	size_t nr_scanned = 0;
+	struct urcu_wait_budget budget;
+
+	urcu_wait_budget_init(&budget, &rcu_gp_wait_policy,
+			CMM_LOAD_SHARED(rcu_wait_mode), RCU_QS_ACTIVE_ATTEMPTS);
+	urcu_probe1(wait_readers_begin, phase);
+	for (;;) {
+		int expedited = uatomic_read(&rcu_gp_expedited);
+
+		if (wait_loops < budget.sleep)
+			wait_loops++;
+		if (wait_loops >= budget.sleep && !expedited) {
+			uatomic_dec(&rcu_gp.futex);
+			/* Write futex before read reader counters */
+			cmm_smp_mb();
+		}
+
+		/* Each CPU counts as a reader. */
+		nr_scanned += nr_cpus;
+		if (readers_done(phase, nr_cpus)) {
+			if (wait_loops >= budget.sleep) {
+				/* Read reader counters before write futex */
+				cmm_smp_mb();
+				uatomic_set(&rcu_gp.futex, 0);
+			}
+			break;
+		}
+		if (wait_loops >= budget.sleep) {
+			if (expedited)
+				(void) sched_yield();
+			else
+				wait_gp();
+		} else {
+			urcu_wait_budget_relax(&budget, wait_loops);
+		}
+	}
+	urcu_gp_stats_add(&rcu_stats.nr_readers_scanned, nr_scanned);
+	urcu_probe2(wait_readers_end, phase, nr_scanned);
+	urcu_wait_policy_record(&rcu_gp_wait_policy, &budget, wait_loops);
+}
+
+void synchronize_rcu(void)
+{
+	DEFINE_URCU_WAIT_NODE(wait, URCU_WAIT_WAITING);
+	struct urcu_waiters waiters;
+	unsigned long phase;
+	unsigned int nr_cpus;
+	unsigned long start_us = urcu_gp_stats_now_us();
+
+	urcu_probe1(synchronize_rcu_begin, NULL);
+	/*
+	 * Add ourself to gp_waiters queue of threads awaiting to wait
+	 * for a grace period. Proceed to perform the grace period only
+	 * if we are the first thread added into the queue.
+	 * The implicit memory barrier before urcu_wait_add()
+	 * orders prior memory accesses of threads put into the wait
+	 * queue before their insertion into the wait queue.
+	 */
+	if (urcu_wait_add(&gp_waiters, &wait) != 0) {
+		/* Not first in queue: will be awakened by another thread. */
+		urcu_adaptative_busy_wait(&wait, &rcu_waiters_policy,
+				CMM_LOAD_SHARED(rcu_wait_mode));
+		/* Order following memory accesses after grace period. */
+		cmm_smp_mb();
+		uatomic_inc(&rcu_stats.nr_piggyback);
+		urcu_gp_stats_latency(&rcu_stats, start_us);
+		urcu_probe2(synchronize_rcu_end, NULL, 0);
+		return;
+	}
+	/* We won't need to wake ourself up */
+	urcu_wait_set_state(&wait, URCU_WAIT_RUNNING);
+
+	mutex_lock(&rcu_gp_lock);
+
+	rcu_init();	/* In case gcc does not support constructor attribute */
+
+	/*
+	 * Move all waiters into our local queue.
+	 */
+	urcu_move_waiters(&waiters, &gp_waiters);
+
+	/* Also orders prior updates before reading the reader counters. */
+	urcu_gp_seq_start(&rcu_gp_seq);
+
+	nr_cpus = rcu_gp.nr_cpus;
+	phase = rcu_gp.ctr & RCU_GP_CTR_PHASE;
+
+	/*
+	 * Wait for readers which read the previous phase before the
+	 * prior grace period switched it, but only incremented its
+	 * lock counter afterwards. Those readers could otherwise keep
+	 * the counters of the previous phase unbalanced when we wait
+	 * for it below, after the switch.
+	 */
+	wait_for_readers(phase ^ RCU_GP_CTR_PHASE, nr_cpus);
+
+	/* Read reader counters before switching phase. */
+	cmm_smp_mb();
+
+	/* Switch phase: 0 -> 1, 1 -> 0 */
+	CMM_STORE_SHARED(rcu_gp.ctr, rcu_gp.ctr + 1);
+
+	/*
+	 * Switch phase before reading reader counters, so new readers
+	 * use the new phase and cannot delay the grace period.
+	 */
+	cmm_smp_mb();
+
+	/*
+	 * Wait for readers of the current phase.
+	 */
+	wait_for_readers(phase, nr_cpus);
+
+	/* Also orders the end of readers before following memory accesses. */
+	urcu_gp_seq_end(&rcu_gp_seq);
+	mutex_unlock(&rcu_gp_lock);
+
+	/*
+	 * Wakeup waiters only after we have completed the grace period
+	 * and have ensured the memory barriers at the end of the grace
+	 * period have been issued.
+	 */
+	urcu_wake_all_waiters(&waiters);
+	uatomic_inc(&rcu_stats.nr_gp);
+	urcu_gp_stats_latency(&rcu_stats, start_us);
+	urcu_probe2(synchronize_rcu_end, NULL, 1);
+}
+
+/*
+ * Same as synchronize_rcu(), but never sleeps on the futex while
+ * waiting for readers. Also expedites the grace period already in
+ * progress, if any, which this caller may batch with. Returns the time
+ * it took, in microseconds.
+ */
+unsigned long synchronize_rcu_expedited(void)
+{
+	unsigned long start_us = urcu_gp_stats_now_us();
+
+	uatomic_inc(&rcu_gp_expedited);
+	/*
+	 * Write rcu_gp_expedited before read futex (the grace period
+	 * side writes them in the opposite order).
+	 */
+	cmm_smp_mb__after_uatomic_inc();
+	/* Wake up a grace period sleeping on the futex. */
+	wake_up_gp();
+	synchronize_rcu();
+	uatomic_dec(&rcu_gp_expedited);
+	return urcu_gp_stats_now_us() - start_us;
+}
+
+int rcu_set_wait_mode(enum rcu_wait_mode mode)
+{
+	if (!urcu_wait_mode_valid(mode))
+		return -EINVAL;
+	CMM_STORE_SHARED(rcu_wait_mode, mode);
+	return 0;
+}
+
+void rcu_get_gp_stats(struct rcu_gp_stats *stats)
+{
+	urcu_gp_stats_get(&rcu_stats, stats);
+}
+
+void rcu_reset_gp_stats(void)
+{
+	urcu_gp_stats_reset(&rcu_stats);
+}
+
+/*
+ * library wrappers to be used by non-LGPL compatible source code.
+ */
+
+void rcu_read_lock(void)
+{
+	_rcu_read_lock();
+}
+
+void rcu_read_unlock(void)
+{
+	_rcu_read_unlock();
+}
+
+int rcu_read_ongoing(void)
+{
+	return _rcu_read_ongoing();
+}
+
+int rcu_read_getcpu(void)
+{
+#ifdef HAVE_SCHED_GETCPU
+	return sched_getcpu();
+#else
+	return 0;
+#endif
+}
+
+/*
+ * rcu_init constructor. Called when the library is linked, but also by
+ * synchronize_rcu(). Should only be called by a single thread at a
+ * given time. This is ensured by holding the rcu_gp_lock from
+ * synchronize_rcu() or by running at library load time.
+ *
+ * Until then, readers account for their critical sections on CPU 0.
+ */
+void rcu_init(void)
+{
+	long nr_cpus = RCU_PERCPU_MAX_CPUS;
+
+	if (init_done)
+		return;
+	init_done = 1;
+#ifndef HAVE_SCHED_GETCPU
+	nr_cpus = 1;
+#elif defined(HAVE_SYSCONF)
+	nr_cpus = sysconf(_SC_NPROCESSORS_CONF);
+	if (nr_cpus <= 0 || nr_cpus > RCU_PERCPU_MAX_CPUS)
+		nr_cpus = RCU_PERCPU_MAX_CPUS;
+#endif
+	CMM_STORE_SHARED(rcu_gp.nr_cpus, nr_cpus);
+}
+
+DEFINE_RCU_FLAVOR(rcu_flavor);
+
+#include "urcu-call-rcu-impl.h"
+#include "urcu-defer-impl.h"
+#include "urcu-poll-impl.h"
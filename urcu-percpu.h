@@ -0,0 +1,149 @@
+#ifndef _URCU_PERCPU_H
+#define _URCU_PERCPU_H
+
+/*
+ * urcu-percpu.h
+ *
+ * Userspace RCU header, per-CPU counters flavor.
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * LGPL-compatible code should include this header with :
+ *
+ * #define _LGPL_SOURCE
+ * #include <urcu-percpu.h>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdlib.h>
+#include <pthread.h>
+
+/*
+ * See urcu-pointer.h and urcu/static/urcu-pointer.h for pointer
+ * publication headers.
+ */
+#include <urcu-pointer.h>
+#include <urcu/wait-mode.h>
+#include <urcu/gp-stats.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <urcu/map/urcu-percpu.h>
+
+/*
+ * Reader threads do not need to be registered: the read-side critical
+ * sections are accounted in per-CPU counters.
+ */
+
+#ifdef _LGPL_SOURCE
+
+#include <urcu/static/urcu-percpu.h>
+
+/*
+ * Mappings for static use of the userspace RCU library.
+ * Should only be used in LGPL-compatible code.
+ */
+
+/*
+ * rcu_read_lock()
+ * rcu_read_unlock()
+ *
+ * Mark the beginning and end of a read-side critical section.
+ */
+#define rcu_read_lock_percpu		_rcu_read_lock
+#define rcu_read_unlock_percpu		_rcu_read_unlock
+#define rcu_read_ongoing_percpu		_rcu_read_ongoing
+
+#else /* !_LGPL_SOURCE */
+
+/*
+ * library wrappers to be used by non-LGPL compatible source code.
+ * See LGPL-only urcu/static/urcu-pointer.h for documentation.
+ */
+
+extern void rcu_read_lock(void);
+extern void rcu_read_unlock(void);
+extern int rcu_read_ongoing(void);
+
+#endif /* !_LGPL_SOURCE */
+
+extern void synchronize_rcu(void);
+extern unsigned long synchronize_rcu_expedited(void);
+
+/*
+ * Grace period polling. See rcu-api.md in userspace-rcu documentation
+ * for usage detail.
+ */
+extern unsigned long get_state_synchronize_rcu(void);
+extern unsigned long start_poll_synchronize_rcu(void);
+extern int poll_state_synchronize_rcu(unsigned long cookie);
+extern void cond_synchronize_rcu(unsigned long cookie);
+
+/*
+ * Grace period waiting policy. See rcu-api.md in userspace-rcu
+ * documentation for usage detail.
+ */
+extern int rcu_set_wait_mode(enum rcu_wait_mode mode);
+
+/*
+ * Grace period statistics. See rcu-api.md in userspace-rcu
+ * documentation for usage detail.
+ */
+extern void rcu_get_gp_stats(struct rcu_gp_stats *stats);
+extern void rcu_reset_gp_stats(void);
+
+/*
+ * Explicit rcu initialization, for "early" use within library constructors.
+ */
+extern void rcu_init(void);
+
+/*
+ * In the per-CPU version, the following functions are no-ops.
+ */
+static inline void rcu_register_thread(void)
+{
+}
+
+static inline void rcu_unregister_thread(void)
+{
+}
+
+/*
+ * Q.S. reporting are no-ops for these URCU flavors.
+ */
+static inline void rcu_quiescent_state(void)
+{
+}
+
+static inline void rcu_thread_offline(void)
+{
+}
+
+static inline void rcu_thread_online(void)
+{
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#include <urcu-call-rcu.h>
+#include <urcu-defer.h>
+#include <urcu-flavor.h>
+
+#endif /* _URCU_PERCPU_H */
@@ -0,0 +1,118 @@
+/*
+ * urcu-poll-impl.h
+ *
+ * Userspace RCU library - grace period polling
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <pthread.h>
+
+#include "urcu-poll.h"
+
+/*
+ * A single rcu_head is used to make sure a grace period is started on
+ * behalf of start_poll_synchronize_rcu() callers. While it is queued,
+ * further callers only need to update the target sequence number.
+ * Protected by rcu_poll_lock.
+ */
+static pthread_mutex_t rcu_poll_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct rcu_head rcu_poll_head;
+static int rcu_poll_queued;
+static unsigned long rcu_poll_target;
+
+static
+void rcu_poll_complete(struct rcu_head *head)
+{
+	mutex_lock(&rcu_poll_lock);
+	/*
+	 * Requeue ourself if a caller asked for a grace period which
+	 * started after the one we just waited for.
+	 */
+	if (!urcu_gp_seq_done(&rcu_gp_seq, rcu_poll_target))
+		call_rcu(head, rcu_poll_complete);
+	else
+		rcu_poll_queued = 0;
+	mutex_unlock(&rcu_poll_lock);
+}
+
+/*
+ * Return a cookie identifying the end of a grace period starting after
+ * this call. It can be passed to poll_state_synchronize_rcu(). This
+ * function does not start a grace period.
+ */
+unsigned long get_state_synchronize_rcu(void)
+{
+	return urcu_gp_seq_snap(&rcu_gp_seq);
+}
+
+/*
+ * Return a cookie like get_state_synchronize_rcu(), and make sure a
+ * grace period will eventually complete it even if no other thread
+ * invokes synchronize_rcu(). Relies on call_rcu(), hence must be called
+ * by registered RCU read-side threads. For the QSBR flavor, the caller
+ * should be online.
+ */
+unsigned long start_poll_synchronize_rcu(void)
+{
+	unsigned long cookie;
+
+	cookie = urcu_gp_seq_snap(&rcu_gp_seq);
+	mutex_lock(&rcu_poll_lock);
+	if (!rcu_poll_queued || URCU_GP_SEQ_GE(cookie, rcu_poll_target))
+		rcu_poll_target = cookie;
+	if (!rcu_poll_queued) {
+		rcu_poll_queued = 1;
+		call_rcu(&rcu_poll_head, rcu_poll_complete);
+	}
+	mutex_unlock(&rcu_poll_lock);
+	return cookie;
+}
+
+/*
+ * Return non-zero if the grace period identified by "cookie" has
+ * completed. Memory accesses following a non-zero return are ordered
+ * after the end of that grace period. Never blocks, and can be called
+ * from any thread, registered or not.
+ */
+int poll_state_synchronize_rcu(unsigned long cookie)
+{
+	return urcu_gp_seq_done(&rcu_gp_seq, cookie);
+}
+
+/*
+ * Wait for the grace period identified by "cookie" to complete. Unlike
+ * synchronize_rcu(), which always waits for a grace period starting
+ * after the call, wait for the grace period driver thread of call_rcu
+ * to reach the cookie: callers and call_rcu batches needing the same
+ * grace period share it. Returns immediately if the cookie has already
+ * completed.
+ */
+void cond_synchronize_rcu(unsigned long cookie)
+{
+	int was_online;
+
+	if (urcu_gp_seq_done(&rcu_gp_seq, cookie))
+		return;
+	/* QSBR: the grace period may be waiting for our quiescent state. */
+	was_online = rcu_read_ongoing();
+	if (was_online)
+		rcu_thread_offline();
+	call_rcu_gp_wait(cookie);
+	if (was_online)
+		rcu_thread_online();
+}
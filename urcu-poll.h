@@ -0,0 +1,90 @@
+#ifndef _URCU_POLL_H
+#define _URCU_POLL_H
+
+/*
+ * urcu-poll.h
+ *
+ * Userspace RCU library grace period sequence numbers
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <urcu/compiler.h>
+#include <urcu/arch.h>
+#include <urcu/system.h>
+
+/*
+ * The grace period sequence number is incremented once when a grace
+ * period starts and once when it completes: its low-order bit is set
+ * while a grace period is in progress. It is only updated by the
+ * thread performing the grace period, with rcu_gp_lock held, and can be
+ * read concurrently by any thread.
+ */
+#define URCU_GP_SEQ_STATE_MASK		1UL
+
+/* Compare sequence numbers, taking overflow into account. */
+#define URCU_GP_SEQ_GE(a, b)		((long) ((a) - (b)) >= 0)
+
+static inline
+void urcu_gp_seq_start(unsigned long *seq)
+{
+	CMM_STORE_SHARED(*seq, *seq + 1);
+	/* Store seq before scanning the readers. */
+	cmm_smp_mb();
+}
+
+static inline
+void urcu_gp_seq_end(unsigned long *seq)
+{
+	/* Finish scanning the readers before storing seq. */
+	cmm_smp_mb();
+	CMM_STORE_SHARED(*seq, *seq + 1);
+}
+
+/*
+ * Return the sequence number that will be reached when a full grace
+ * period starting after this call has completed. If a grace period is
+ * in progress, it may have started before the caller's prior memory
+ * accesses, so the following grace period is also needed.
+ */
+static inline
+unsigned long urcu_gp_seq_snap(unsigned long *seq)
+{
+	unsigned long s;
+
+	/* Order prior memory accesses before load of seq. */
+	cmm_smp_mb();
+	s = CMM_LOAD_SHARED(*seq);
+	return (s + 2 * URCU_GP_SEQ_STATE_MASK + 1) & ~URCU_GP_SEQ_STATE_MASK;
+}
+
+/*
+ * Return whether the grace period identified by the snapshot "snap"
+ * has completed.
+ */
+static inline
+int urcu_gp_seq_done(unsigned long *seq, unsigned long snap)
+{
+	int ret;
+
+	ret = URCU_GP_SEQ_GE(CMM_LOAD_SHARED(*seq), snap);
+	/* Order load of seq before following memory accesses. */
+	cmm_smp_mb();
+	return ret;
+}
+
+#endif /* _URCU_POLL_H */
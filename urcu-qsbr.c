@@ -34,6 +34,7 @@
 #include <string.h>
 #include <errno.h>
 #include <poll.h>
+#include <sched.h>
 
 #include "urcu/wfcqueue.h"
 #include "urcu/map/urcu-qsbr.h"
@@ -44,6 +45,12 @@
 
 #include "urcu-die.h"
 #include "urcu-wait.h"
+#include "urcu-poll.h"
+#include "urcu-membarrier.h"
+#include "urcu-scan.h"
+#include "urcu-stall.h"
+#include "urcu-gp-stats.h"
+#include "urcu-sdt.h"
 
 /* Do not #define _LGPL_SOURCE to ensure we can emit the wrapper symbols */
 #undef _LGPL_SOURCE
@@ -52,14 +59,106 @@
 
 void __attribute__((destructor)) rcu_exit(void);
 
-static pthread_mutex_t rcu_gp_lock = PTHREAD_MUTEX_INITIALIZER;
 struct rcu_gp rcu_gp = { .ctr = RCU_GP_ONLINE };
 
+/* Checked by the read-side inlined into non-LGPL code. */
+const unsigned int rcu_reader_abi = RCU_READER_ABI;
+
 /*
- * Active attempts to check for reader Q.S. before calling futex().
+ * Update-side state of an RCU domain. The default domain, used by
+ * synchronize_rcu() and the TLS reader of each registered thread, uses
+ * the global rcu_gp.
+ */
+struct rcu_domain_impl {
+	struct rcu_domain parent;
+	pthread_mutex_t gp_lock;
+	/*
+	 * registry_lock ensures mutual exclusion between threads
+	 * registering and unregistering themselves to/from the registry,
+	 * and with the grace period reading that registry. However, the
+	 * grace period does not hold it while waiting for readers, so
+	 * registration does not wait for the end of a grace period.
+	 * registry_lock nests inside gp_lock.
+	 */
+	pthread_mutex_t registry_lock;
+	/* Registered readers. Protected by registry_lock. */
+	struct cds_list_head registry;
+	/*
+	 * Incremented on each change of the registry, which tells the
+	 * parallel scan of the readers (see urcu-scan.h) that its copy
+	 * is stale. Protected by registry_lock.
+	 */
+	unsigned long registry_gen;
+	/*
+	 * Queue keeping threads awaiting to wait for a grace period.
+	 * Contains struct gp_waiters_thread objects.
+	 */
+	struct urcu_wait_queue gp_waiters;
+	/*
+	 * Grace period sequence number, used by the grace period
+	 * polling API. Written to only by writer with gp_lock held.
+	 */
+	unsigned long gp_seq;
+	/*
+	 * Number of synchronize_rcu_expedited() callers currently
+	 * waiting for a grace period. While non-zero, wait_for_readers()
+	 * busy-waits rather than sleeping on the futex.
+	 */
+	int gp_expedited;
+	/*
+	 * Number of registered readers going offline lazily. Grace
+	 * periods issue sys_membarrier() while non-zero. Protected by
+	 * gp_lock.
+	 */
+	int nr_lazy;
+	/*
+	 * How long recent grace periods waited for readers, and threads
+	 * waited for grace periods started by others.
+	 */
+	struct urcu_wait_policy gp_wait_policy;
+	struct urcu_wait_policy waiters_policy;
+	/* call_rcu thread of the domain, created on first use. */
+	struct call_rcu_data *crdp;
+	/* Grace period state of domains other than the default one. */
+	struct rcu_gp gp;
+};
+
+static struct rcu_domain_impl rcu_default_domain = {
+	.parent.gp = &rcu_gp,
+	.gp_lock = PTHREAD_MUTEX_INITIALIZER,
+	.registry_lock = PTHREAD_MUTEX_INITIALIZER,
+	.registry = CDS_LIST_HEAD_INIT(rcu_default_domain.registry),
+	.gp_waiters = URCU_WAIT_QUEUE_HEAD_INIT(rcu_default_domain.gp_waiters),
+};
+
+/* Used by the grace period polling API. */
+#define rcu_gp_seq	(rcu_default_domain.gp_seq)
+
+/*
+ * Active attempts to check for reader Q.S. before calling futex(), when
+ * no recent grace period tells better (see urcu-wait.h).
  */
 #define RCU_QS_ACTIVE_ATTEMPTS 100
 
+/* enum rcu_wait_mode, set by rcu_set_wait_mode(). */
+static int rcu_wait_mode;
+
+/* Set by rcu_set_stall_detector(), for the grace periods of all domains. */
+static struct urcu_stall_detector rcu_stall = URCU_STALL_DETECTOR_INIT;
+
+/* Set by rcu_set_reader_boost(), for the grace periods of all domains. */
+static struct urcu_boost rcu_boost = URCU_BOOST_INIT;
+
+/* Grace periods of all domains, returned by rcu_get_gp_stats(). */
+static struct rcu_gp_stats rcu_stats;
+
+/*
+ * Whether sys_membarrier() private expedited command, used on behalf of
+ * lazy readers, is available: -1 if not queried yet. Protected by
+ * rcu_default_domain.gp_lock.
+ */
+static int rcu_has_sys_membarrier = -1;
+
 /*
  * Written to only by each individual reader. Read by both the reader and the
  * writers.
@@ -71,14 +170,6 @@ unsigned int rcu_yield_active;
 DEFINE_URCU_TLS(unsigned int, rcu_rand_yield);
 #endif
 
-static CDS_LIST_HEAD(registry);
-
-/*
- * Queue keeping threads awaiting to wait for a grace period. Contains
- * struct gp_waiters_thread objects.
- */
-static DEFINE_URCU_WAIT_QUEUE(gp_waiters);
-
 static void mutex_lock(pthread_mutex_t *mutex)
 {
 	int ret;
@@ -106,23 +197,124 @@ static void mutex_unlock(pthread_mutex_t *mutex)
 }
 
 /*
- * synchronize_rcu() waiting. Single thread.
+ * Memory barrier of the grace period. Also orders memory accesses of
+ * all running lazy readers, which only issue compiler barriers. Called
+ * with domain->gp_lock held.
+ */
+static void smp_mb_master(struct rcu_domain_impl *domain)
+{
+	if (domain->nr_lazy)
+		(void) membarrier(MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0);
+	else
+		cmm_smp_mb();
+}
+
+/*
+ * synchronize_rcu() waiting. Single thread. Wakes up in time for the
+ * next report of the stall detector, if enabled.
  */
-static void wait_gp(void)
+static void wait_gp(struct rcu_domain_impl *domain,
+		struct urcu_stall_gp *stall)
 {
+	struct rcu_gp *gp = domain->parent.gp;
+	struct timespec timeout;
+
 	/* Read reader_gp before read futex */
 	cmm_smp_rmb();
-	if (uatomic_read(&rcu_gp.futex) == -1)
-		futex_noasync(&rcu_gp.futex, FUTEX_WAIT, -1,
-		      NULL, NULL, 0);
+	/*
+	 * The write futex before read gp_expedited ordering is provided
+	 * by wait_for_readers().
+	 */
+	if (uatomic_read(&gp->futex) == -1
+			&& !uatomic_read(&domain->gp_expedited)) {
+		uatomic_inc(&rcu_stats.nr_sleeps);
+		futex_noasync(&gp->futex, FUTEX_WAIT, -1,
+		      urcu_stall_timeout(stall, &timeout), NULL, 0);
+	}
+}
+
+/*
+ * Helper threads scanning the readers of the grace periods of all
+ * domains, one grace period at a time.
+ */
+static struct urcu_scan rcu_scan = URCU_SCAN_INIT;
+
+static enum rcu_state scan_reader_state(void *arg, struct rcu_reader *reader)
+{
+	return rcu_gp_reader_state(arg, &reader->ctr);
+}
+
+/*
+ * Report the readers of "input_readers", which the grace period is
+ * still waiting for, if the stall detector is due. QSBR readers have
+ * no nesting.
+ */
+static void report_stalled_readers(struct urcu_stall_gp *stall,
+		struct cds_list_head *input_readers)
+{
+	struct rcu_reader *index;
+	unsigned long now;
+
+	if (caa_likely(!urcu_stall_gp_due(stall, &now)))
+		return;
+	cds_list_for_each_entry(index, input_readers, node) {
+		urcu_stall_report(stall, now, index->tid,
+				CMM_LOAD_SHARED(index->ctr), 0,
+				&index->stall_ctr, &index->stall_since);
+	}
 }
 
-static void wait_for_readers(struct cds_list_head *input_readers,
+/*
+ * Boost the threads of the readers of "input_readers", which the grace
+ * period is still waiting for, if reader boosting is due.
+ */
+static void boost_stalled_readers(struct urcu_stall_gp *stall,
+		struct cds_list_head *input_readers)
+{
+	struct rcu_reader *index;
+
+	if (caa_likely(!urcu_boost_gp_due(stall)))
+		return;
+	cds_list_for_each_entry(index, input_readers, node)
+		urcu_boost_reader(stall, index->tid, &index->boosted,
+				&index->boost_policy, &index->boost_param);
+}
+
+/*
+ * Restore the scheduling of the boosted readers of "readers", which no
+ * longer hold the grace period.
+ */
+static void restore_boosted_readers(struct urcu_stall_gp *stall,
+		struct cds_list_head *readers)
+{
+	struct rcu_reader *index;
+
+	cds_list_for_each_entry(index, readers, node) {
+		if (!stall->nr_boosted)
+			return;
+		if (urcu_boost_restore(index->tid, &index->boosted,
+				&index->boost_policy, &index->boost_param))
+			stall->nr_boosted--;
+	}
+}
+
+static void wait_for_readers(struct rcu_domain_impl *domain,
+			struct cds_list_head *input_readers,
 			struct cds_list_head *cur_snap_readers,
 			struct cds_list_head *qsreaders)
 {
+	struct rcu_gp *gp = domain->parent.gp;
 	unsigned int wait_loops = 0;
+	size_t scanned, nr_scanned = 0;
+	unsigned long scan_token = 0;
 	struct rcu_reader *index, *tmp;
+	struct urcu_wait_budget budget;
+	struct urcu_stall_gp stall;
+
+	urcu_wait_budget_init(&budget, &domain->gp_wait_policy,
+			CMM_LOAD_SHARED(rcu_wait_mode), RCU_QS_ACTIVE_ATTEMPTS);
+	urcu_stall_gp_init(&stall, &rcu_stall, &rcu_boost);
+	urcu_probe1(wait_readers_begin, gp->ctr);
 
 	/*
 	 * Wait for each thread URCU_TLS(rcu_reader).ctr to either
@@ -130,10 +322,12 @@ static void wait_for_readers(struct cds_list_head *input_readers,
 	 * current rcu_gp.ctr value.
 	 */
 	for (;;) {
-		if (wait_loops < RCU_QS_ACTIVE_ATTEMPTS)
+		int expedited = uatomic_read(&domain->gp_expedited);
+
+		if (wait_loops < budget.sleep)
 			wait_loops++;
-		if (wait_loops >= RCU_QS_ACTIVE_ATTEMPTS) {
-			uatomic_set(&rcu_gp.futex, -1);
+		if (wait_loops >= budget.sleep && !expedited) {
+			uatomic_set(&gp->futex, -1);
 			/*
 			 * Write futex before write waiting (the other side
 			 * reads them in the opposite order).
@@ -143,50 +337,82 @@ static void wait_for_readers(struct cds_list_head *input_readers,
 				_CMM_STORE_SHARED(index->waiting, 1);
 			}
 			/* Write futex before read reader_gp */
-			cmm_smp_mb();
+			smp_mb_master(domain);
 		}
-		cds_list_for_each_entry_safe(index, tmp, input_readers, node) {
-			switch (rcu_reader_state(&index->ctr)) {
-			case RCU_READER_ACTIVE_CURRENT:
-				if (cur_snap_readers) {
-					cds_list_move(&index->node,
-						cur_snap_readers);
+		scanned = urcu_scan_readers(&rcu_scan, input_readers,
+				cur_snap_readers, qsreaders,
+				scan_reader_state, gp, &scan_token,
+				domain->registry_gen);
+		if (!scanned) {
+			cds_list_for_each_entry_safe(index, tmp,
+					input_readers, node) {
+				scanned++;
+				switch (rcu_gp_reader_state(gp, &index->ctr)) {
+				case RCU_READER_ACTIVE_CURRENT:
+					if (cur_snap_readers) {
+						cds_list_move(&index->node,
+							cur_snap_readers);
+						break;
+					}
+					/* Fall-through */
+				case RCU_READER_INACTIVE:
+					cds_list_move(&index->node, qsreaders);
+					break;
+				case RCU_READER_ACTIVE_OLD:
+					/*
+					 * Old snapshot. Leaving node in
+					 * input_readers will make us busy-loop
+					 * until the snapshot becomes current or
+					 * the reader becomes inactive.
+					 */
 					break;
 				}
-				/* Fall-through */
-			case RCU_READER_INACTIVE:
-				cds_list_move(&index->node, qsreaders);
-				break;
-			case RCU_READER_ACTIVE_OLD:
-				/*
-				 * Old snapshot. Leaving node in
-				 * input_readers will make us busy-loop
-				 * until the snapshot becomes current or
-				 * the reader becomes inactive.
-				 */
-				break;
 			}
 		}
+		nr_scanned += scanned;
+		if (caa_unlikely(stall.nr_boosted)) {
+			restore_boosted_readers(&stall, qsreaders);
+			if (cur_snap_readers)
+				restore_boosted_readers(&stall,
+						cur_snap_readers);
+		}
 
 		if (cds_list_empty(input_readers)) {
-			if (wait_loops >= RCU_QS_ACTIVE_ATTEMPTS) {
+			if (wait_loops >= budget.sleep) {
 				/* Read reader_gp before write futex */
 				cmm_smp_mb();
-				uatomic_set(&rcu_gp.futex, 0);
+				uatomic_set(&gp->futex, 0);
 			}
 			break;
 		} else {
-			if (wait_loops >= RCU_QS_ACTIVE_ATTEMPTS) {
-				wait_gp();
+			report_stalled_readers(&stall, input_readers);
+			boost_stalled_readers(&stall, input_readers);
+			/* Temporarily unlock the registry lock. */
+			mutex_unlock(&domain->registry_lock);
+			if (wait_loops >= budget.sleep) {
+				/*
+				 * QSBR readers cannot be forced through
+				 * a quiescent state: when expedited,
+				 * let them run.
+				 */
+				if (expedited)
+					(void) sched_yield();
+				else
+					wait_gp(domain, &stall);
 			} else {
 #ifndef HAS_INCOHERENT_CACHES
-				caa_cpu_relax();
+				urcu_wait_budget_relax(&budget, wait_loops);
 #else /* #ifndef HAS_INCOHERENT_CACHES */
 				cmm_smp_mb();
 #endif /* #else #ifndef HAS_INCOHERENT_CACHES */
 			}
+			/* Re-lock the registry lock before the next loop. */
+			mutex_lock(&domain->registry_lock);
 		}
 	}
+	urcu_gp_stats_add(&rcu_stats.nr_readers_scanned, nr_scanned);
+	urcu_probe2(wait_readers_end, gp->ctr, nr_scanned);
+	urcu_wait_policy_record(&domain->gp_wait_policy, &budget, wait_loops);
 }
 
 /*
@@ -195,56 +421,53 @@ static void wait_for_readers(struct cds_list_head *input_readers,
  */
 
 #if (CAA_BITS_PER_LONG < 64)
-void synchronize_rcu(void)
+static void domain_synchronize(struct rcu_domain_impl *domain)
 {
 	CDS_LIST_HEAD(cur_snap_readers);
 	CDS_LIST_HEAD(qsreaders);
-	unsigned long was_online;
 	DEFINE_URCU_WAIT_NODE(wait, URCU_WAIT_WAITING);
 	struct urcu_waiters waiters;
+	struct rcu_gp *gp = domain->parent.gp;
 
-	was_online = rcu_read_ongoing();
-
-	/* All threads should read qparity before accessing data structure
-	 * where new ptr points to.  In the "then" case, rcu_thread_offline
-	 * includes a memory barrier.
-	 *
-	 * Mark the writer thread offline to make sure we don't wait for
-	 * our own quiescent state. This allows using synchronize_rcu()
-	 * in threads registered as readers.
-	 */
-	if (was_online)
-		rcu_thread_offline();
-	else
-		cmm_smp_mb();
-
+	urcu_probe1(synchronize_rcu_begin, domain);
 	/*
 	 * Add ourself to gp_waiters queue of threads awaiting to wait
 	 * for a grace period. Proceed to perform the grace period only
 	 * if we are the first thread added into the queue.
 	 */
-	if (urcu_wait_add(&gp_waiters, &wait) != 0) {
+	if (urcu_wait_add(&domain->gp_waiters, &wait) != 0) {
 		/* Not first in queue: will be awakened by another thread. */
-		urcu_adaptative_busy_wait(&wait);
-		goto gp_end;
+		urcu_adaptative_busy_wait(&wait, &domain->waiters_policy,
+				CMM_LOAD_SHARED(rcu_wait_mode));
+		uatomic_inc(&rcu_stats.nr_piggyback);
+		urcu_probe2(synchronize_rcu_end, domain, 0);
+		return;
 	}
 	/* We won't need to wake ourself up */
 	urcu_wait_set_state(&wait, URCU_WAIT_RUNNING);
 
-	mutex_lock(&rcu_gp_lock);
+	mutex_lock(&domain->gp_lock);
 
 	/*
 	 * Move all waiters into our local queue.
 	 */
-	urcu_move_waiters(&waiters, &gp_waiters);
+	urcu_move_waiters(&waiters, &domain->gp_waiters);
+
+	urcu_gp_seq_start(&domain->gp_seq);
+
+	mutex_lock(&domain->registry_lock);
 
-	if (cds_list_empty(&registry))
+	if (cds_list_empty(&domain->registry))
 		goto out;
 
+	/* Order the accesses of lazy readers coming back online. */
+	smp_mb_master(domain);
+
 	/*
 	 * Wait for readers to observe original parity or be quiescent.
 	 */
-	wait_for_readers(&registry, &cur_snap_readers, &qsreaders);
+	wait_for_readers(domain, &domain->registry, &cur_snap_readers,
+			&qsreaders);
 
 	/*
 	 * Must finish waiting for quiescent state for original parity
@@ -264,7 +487,7 @@ void synchronize_rcu(void)
 	cmm_smp_mb();
 
 	/* Switch parity: 0 -> 1, 1 -> 0 */
-	CMM_STORE_SHARED(rcu_gp.ctr, rcu_gp.ctr ^ RCU_GP_CTR);
+	CMM_STORE_SHARED(gp->ctr, gp->ctr ^ RCU_GP_CTR);
 
 	/*
 	 * Must commit rcu_gp.ctr update to memory before waiting for
@@ -278,77 +501,83 @@ void synchronize_rcu(void)
 	/*
 	 * Adding a cmm_smp_mb() which is _not_ formally required, but makes the
 	 * model easier to understand. It does not have a big performance impact
-	 * anyway, given this is the write-side.
+	 * anyway, given this is the write-side. It is however required
+	 * to order the accesses of lazy readers coming back online.
 	 */
-	cmm_smp_mb();
+	smp_mb_master(domain);
 
 	/*
 	 * Wait for readers to observe new parity or be quiescent.
 	 */
-	wait_for_readers(&cur_snap_readers, NULL, &qsreaders);
+	wait_for_readers(domain, &cur_snap_readers, NULL, &qsreaders);
+
+	/*
+	 * Order the end of the read-side critical sections of lazy
+	 * readers gone offline before following memory accesses.
+	 */
+	smp_mb_master(domain);
 
 	/*
 	 * Put quiescent reader list back into registry.
 	 */
-	cds_list_splice(&qsreaders, &registry);
+	cds_list_splice(&qsreaders, &domain->registry);
 out:
-	mutex_unlock(&rcu_gp_lock);
+	mutex_unlock(&domain->registry_lock);
+	urcu_gp_seq_end(&domain->gp_seq);
+	mutex_unlock(&domain->gp_lock);
 	urcu_wake_all_waiters(&waiters);
-gp_end:
-	/*
-	 * Finish waiting for reader threads before letting the old ptr being
-	 * freed.
-	 */
-	if (was_online)
-		rcu_thread_online();
-	else
-		cmm_smp_mb();
+	uatomic_inc(&rcu_stats.nr_gp);
+	urcu_probe2(synchronize_rcu_end, domain, 1);
 }
 #else /* !(CAA_BITS_PER_LONG < 64) */
-void synchronize_rcu(void)
+static void domain_synchronize(struct rcu_domain_impl *domain)
 {
 	CDS_LIST_HEAD(qsreaders);
-	unsigned long was_online;
 	DEFINE_URCU_WAIT_NODE(wait, URCU_WAIT_WAITING);
 	struct urcu_waiters waiters;
+	struct rcu_gp *gp = domain->parent.gp;
 
-	was_online = rcu_read_ongoing();
-
-	/*
-	 * Mark the writer thread offline to make sure we don't wait for
-	 * our own quiescent state. This allows using synchronize_rcu()
-	 * in threads registered as readers.
-	 */
-	if (was_online)
-		rcu_thread_offline();
-	else
-		cmm_smp_mb();
-
+	urcu_probe1(synchronize_rcu_begin, domain);
 	/*
 	 * Add ourself to gp_waiters queue of threads awaiting to wait
 	 * for a grace period. Proceed to perform the grace period only
 	 * if we are the first thread added into the queue.
 	 */
-	if (urcu_wait_add(&gp_waiters, &wait) != 0) {
+	if (urcu_wait_add(&domain->gp_waiters, &wait) != 0) {
 		/* Not first in queue: will be awakened by another thread. */
-		urcu_adaptative_busy_wait(&wait);
-		goto gp_end;
+		urcu_adaptative_busy_wait(&wait, &domain->waiters_policy,
+				CMM_LOAD_SHARED(rcu_wait_mode));
+		uatomic_inc(&rcu_stats.nr_piggyback);
+		urcu_probe2(synchronize_rcu_end, domain, 0);
+		return;
 	}
 	/* We won't need to wake ourself up */
 	urcu_wait_set_state(&wait, URCU_WAIT_RUNNING);
 
-	mutex_lock(&rcu_gp_lock);
+	mutex_lock(&domain->gp_lock);
 
 	/*
 	 * Move all waiters into our local queue.
 	 */
-	urcu_move_waiters(&waiters, &gp_waiters);
+	urcu_move_waiters(&waiters, &domain->gp_waiters);
 
-	if (cds_list_empty(&registry))
+	urcu_gp_seq_start(&domain->gp_seq);
+
+	mutex_lock(&domain->registry_lock);
+
+	if (cds_list_empty(&domain->registry))
 		goto out;
 
+	/*
+	 * Order the removal of the old pointer before the store to
+	 * rcu_gp.ctr for lazy readers coming back online, which do not
+	 * issue a barrier after copying it: otherwise, one could load
+	 * the old pointer, then the new rcu_gp.ctr, and be seen current.
+	 */
+	smp_mb_master(domain);
+
 	/* Increment current G.P. */
-	CMM_STORE_SHARED(rcu_gp.ctr, rcu_gp.ctr + RCU_GP_CTR);
+	CMM_STORE_SHARED(gp->ctr, gp->ctr + RCU_GP_CTR);
 
 	/*
 	 * Must commit rcu_gp.ctr update to memory before waiting for
@@ -362,29 +591,185 @@ void synchronize_rcu(void)
 	/*
 	 * Adding a cmm_smp_mb() which is _not_ formally required, but makes the
 	 * model easier to understand. It does not have a big performance impact
-	 * anyway, given this is the write-side.
+	 * anyway, given this is the write-side. It is however required
+	 * to order the accesses of lazy readers coming back online.
 	 */
-	cmm_smp_mb();
+	smp_mb_master(domain);
 
 	/*
 	 * Wait for readers to observe new count of be quiescent.
 	 */
-	wait_for_readers(&registry, NULL, &qsreaders);
+	wait_for_readers(domain, &domain->registry, NULL, &qsreaders);
+
+	/*
+	 * Order the end of the read-side critical sections of lazy
+	 * readers gone offline before following memory accesses.
+	 */
+	smp_mb_master(domain);
 
 	/*
 	 * Put quiescent reader list back into registry.
 	 */
-	cds_list_splice(&qsreaders, &registry);
+	cds_list_splice(&qsreaders, &domain->registry);
 out:
-	mutex_unlock(&rcu_gp_lock);
+	mutex_unlock(&domain->registry_lock);
+	urcu_gp_seq_end(&domain->gp_seq);
+	mutex_unlock(&domain->gp_lock);
 	urcu_wake_all_waiters(&waiters);
-gp_end:
+	uatomic_inc(&rcu_stats.nr_gp);
+	urcu_probe2(synchronize_rcu_end, domain, 1);
+}
+#endif  /* !(CAA_BITS_PER_LONG < 64) */
+
+/*
+ * Wait for a grace period of "domain". The calling thread may be
+ * online in the default domain.
+ */
+static void domain_synchronize_offline(struct rcu_domain_impl *domain)
+{
+	unsigned long start_us = urcu_gp_stats_now_us();
+	unsigned long was_online;
+
+	was_online = rcu_read_ongoing();
+
+	/* All threads should read qparity before accessing data structure
+	 * where new ptr points to.  In the "then" case, rcu_thread_offline
+	 * includes a memory barrier.
+	 *
+	 * Mark the writer thread offline to make sure we don't wait for
+	 * our own quiescent state. This allows using synchronize_rcu()
+	 * in threads registered as readers.
+	 */
+	if (was_online)
+		rcu_thread_offline();
+	else
+		cmm_smp_mb();
+
+	domain_synchronize(domain);
+
+	/*
+	 * Finish waiting for reader threads before letting the old ptr being
+	 * freed.
+	 */
 	if (was_online)
 		rcu_thread_online();
 	else
 		cmm_smp_mb();
+	urcu_gp_stats_latency(&rcu_stats, start_us);
+}
+
+void synchronize_rcu(void)
+{
+	domain_synchronize_offline(&rcu_default_domain);
+}
+
+/*
+ * Same as synchronize_rcu(), but never sleeps on the futex while
+ * waiting for readers. Also expedites the grace period already in
+ * progress, if any, which this caller may batch with. Returns the time
+ * it took, in microseconds.
+ */
+unsigned long synchronize_rcu_expedited(void)
+{
+	unsigned long start_us = urcu_gp_stats_now_us();
+
+	uatomic_inc(&rcu_default_domain.gp_expedited);
+	/*
+	 * Write gp_expedited before read futex (the grace period side
+	 * writes them in the opposite order).
+	 */
+	cmm_smp_mb__after_uatomic_inc();
+	/* Wake up a grace period sleeping on the futex. */
+	if (uatomic_read(&rcu_gp.futex) == -1) {
+		uatomic_set(&rcu_gp.futex, 0);
+		futex_noasync(&rcu_gp.futex, FUTEX_WAKE, 1,
+		      NULL, NULL, 0);
+	}
+	synchronize_rcu();
+	uatomic_dec(&rcu_default_domain.gp_expedited);
+	return urcu_gp_stats_now_us() - start_us;
+}
+
+int rcu_set_gp_scan_threads(unsigned int nr_threads)
+{
+	return urcu_scan_set_threads(&rcu_scan, nr_threads);
+}
+
+int rcu_set_wait_mode(enum rcu_wait_mode mode)
+{
+	if (!urcu_wait_mode_valid(mode))
+		return -EINVAL;
+	CMM_STORE_SHARED(rcu_wait_mode, mode);
+	return 0;
+}
+
+int rcu_set_stall_detector(unsigned long threshold_ms, rcu_stall_func func,
+		void *priv)
+{
+	return urcu_stall_set(&rcu_stall, threshold_ms, func, priv);
+}
+
+int rcu_set_reader_boost(unsigned long threshold_ms, int policy,
+		int priority)
+{
+	return urcu_boost_set(&rcu_boost, threshold_ms, policy, priority);
+}
+
+void rcu_get_gp_stats(struct rcu_gp_stats *stats)
+{
+	urcu_gp_stats_get(&rcu_stats, stats);
+}
+
+void rcu_reset_gp_stats(void)
+{
+	urcu_gp_stats_reset(&rcu_stats);
+}
+
+/*
+ * Online readers are reported active until they go through a quiescent
+ * state following the last grace period.
+ */
+static void get_reader_info(struct rcu_reader_info *info,
+		struct rcu_reader *reader)
+{
+	unsigned long ctr = CMM_LOAD_SHARED(reader->ctr);
+
+	info->tid = reader->tid;
+	info->nesting = 0;
+	info->since_ns = 0;
+	if (!ctr) {
+		info->state = RCU_READER_INFO_OFFLINE;
+		return;
+	}
+	info->state = ctr == CMM_LOAD_SHARED(rcu_gp.ctr) ?
+			RCU_READER_INFO_QUIESCENT : RCU_READER_INFO_ACTIVE;
+#ifdef CONFIG_RCU_READER_TIMESTAMP
+	info->since_ns = CMM_LOAD_SHARED(reader->since_ns);
+#endif
+}
+
+/*
+ * Readers registered to the default domain. Holding gp_lock ensures no
+ * grace period has moved them off the registry, at the cost of waiting
+ * for the grace period in progress: a stalled reader delays the call.
+ */
+unsigned int rcu_get_readers(struct rcu_reader_info *readers,
+		unsigned int nr)
+{
+	struct rcu_reader *index;
+	unsigned int count = 0;
+
+	mutex_lock(&rcu_default_domain.gp_lock);
+	mutex_lock(&rcu_default_domain.registry_lock);
+	cds_list_for_each_entry(index, &rcu_default_domain.registry, node) {
+		if (count < nr)
+			get_reader_info(&readers[count], index);
+		count++;
+	}
+	mutex_unlock(&rcu_default_domain.registry_lock);
+	mutex_unlock(&rcu_default_domain.gp_lock);
+	return count;
 }
-#endif  /* !(CAA_BITS_PER_LONG < 64) */
 
 /*
  * library wrappers to be used by non-LGPL compatible source code.
@@ -410,6 +795,11 @@ void rcu_quiescent_state(void)
 	_rcu_quiescent_state();
 }
 
+void rcu_context_switch(void)
+{
+	_rcu_context_switch();
+}
+
 void rcu_thread_offline(void)
 {
 	_rcu_thread_offline();
@@ -425,9 +815,10 @@ void rcu_register_thread(void)
 	URCU_TLS(rcu_reader).tid = pthread_self();
 	assert(URCU_TLS(rcu_reader).ctr == 0);
 
-	mutex_lock(&rcu_gp_lock);
-	cds_list_add(&URCU_TLS(rcu_reader).node, &registry);
-	mutex_unlock(&rcu_gp_lock);
+	mutex_lock(&rcu_default_domain.registry_lock);
+	cds_list_add(&URCU_TLS(rcu_reader).node, &rcu_default_domain.registry);
+	rcu_default_domain.registry_gen++;
+	mutex_unlock(&rcu_default_domain.registry_lock);
 	_rcu_thread_online();
 }
 
@@ -438,9 +829,231 @@ void rcu_unregister_thread(void)
 	 * with a waiting writer.
 	 */
 	_rcu_thread_offline();
-	mutex_lock(&rcu_gp_lock);
+	if (URCU_TLS(rcu_reader).lazy) {
+		/* nr_lazy only changes between grace periods. */
+		mutex_lock(&rcu_default_domain.gp_lock);
+		URCU_TLS(rcu_reader).lazy = 0;
+		rcu_default_domain.nr_lazy--;
+		mutex_unlock(&rcu_default_domain.gp_lock);
+	}
+	mutex_lock(&rcu_default_domain.registry_lock);
+	(void) urcu_boost_restore(URCU_TLS(rcu_reader).tid,
+			&URCU_TLS(rcu_reader).boosted,
+			&URCU_TLS(rcu_reader).boost_policy,
+			&URCU_TLS(rcu_reader).boost_param);
 	cds_list_del(&URCU_TLS(rcu_reader).node);
-	mutex_unlock(&rcu_gp_lock);
+	rcu_default_domain.registry_gen++;
+	mutex_unlock(&rcu_default_domain.registry_lock);
+}
+
+/*
+ * Only the private expedited command is used: the shared command would
+ * make each grace period last as long as a scheduler grace period.
+ * Called with rcu_default_domain.gp_lock held.
+ */
+static int membarrier_init(void)
+{
+	int mask;
+
+	if (rcu_has_sys_membarrier >= 0)
+		return rcu_has_sys_membarrier;
+	rcu_has_sys_membarrier = 0;
+	mask = membarrier(MEMBARRIER_CMD_QUERY, 0);
+	if (mask >= 0 && (mask & MEMBARRIER_CMD_PRIVATE_EXPEDITED)
+			&& !membarrier(MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0))
+		rcu_has_sys_membarrier = 1;
+	return rcu_has_sys_membarrier;
+}
+
+/*
+ * Holding gp_lock ensures no grace period is in progress while the
+ * barriers issued by this reader change. The thread has to be offline
+ * while taking gp_lock, otherwise we end up deadlocking with a waiting
+ * writer.
+ */
+int rcu_thread_set_lazy_offline(int enable)
+{
+	struct rcu_reader *reader = &URCU_TLS(rcu_reader);
+	unsigned long was_online;
+	int ret = 0;
+
+	enable = !!enable;
+	was_online = _rcu_read_ongoing();
+	if (was_online)
+		_rcu_thread_offline();
+	mutex_lock(&rcu_default_domain.gp_lock);
+	if (enable == reader->lazy)
+		goto end;
+	if (enable && !membarrier_init()) {
+		ret = -ENOSYS;
+		goto end;
+	}
+	reader->lazy = enable;
+	if (enable)
+		rcu_default_domain.nr_lazy++;
+	else
+		rcu_default_domain.nr_lazy--;
+end:
+	mutex_unlock(&rcu_default_domain.gp_lock);
+	if (was_online)
+		_rcu_thread_online();
+	return ret;
+}
+
+/*
+ * RCU domains.
+ */
+
+/* Implemented by urcu-call-rcu-impl.h, included below. */
+static struct call_rcu_data *get_domain_call_rcu_data(
+		struct call_rcu_data **crdpp,
+		void (*gp_sync)(void *arg),
+		void *gp_sync_arg);
+static void _call_rcu(struct rcu_head *head,
+		      void (*func)(struct rcu_head *head),
+		      struct call_rcu_data *crdp);
+
+struct rcu_domain *rcu_domain_create(void)
+{
+	struct rcu_domain_impl *domain;
+	int ret;
+
+	ret = posix_memalign((void **) &domain, CAA_CACHE_LINE_SIZE,
+			sizeof(*domain));
+	if (ret) {
+		errno = ret;
+		return NULL;
+	}
+	memset(domain, 0, sizeof(*domain));
+	domain->parent.gp = &domain->gp;
+	domain->gp.ctr = RCU_GP_ONLINE;
+	ret = pthread_mutex_init(&domain->gp_lock, NULL);
+	if (ret)
+		urcu_die(ret);
+	ret = pthread_mutex_init(&domain->registry_lock, NULL);
+	if (ret)
+		urcu_die(ret);
+	CDS_INIT_LIST_HEAD(&domain->registry);
+	urcu_wait_queue_init(&domain->gp_waiters);
+	return &domain->parent;
+}
+
+int rcu_domain_destroy(struct rcu_domain *parent)
+{
+	struct rcu_domain_impl *domain =
+		caa_container_of(parent, struct rcu_domain_impl, parent);
+	int ret;
+
+	mutex_lock(&domain->registry_lock);
+	ret = cds_list_empty(&domain->registry) ? 0 : -EBUSY;
+	mutex_unlock(&domain->registry_lock);
+	if (ret)
+		return ret;
+	call_rcu_data_free(domain->crdp);
+	ret = pthread_mutex_destroy(&domain->registry_lock);
+	if (ret)
+		urcu_die(ret);
+	ret = pthread_mutex_destroy(&domain->gp_lock);
+	if (ret)
+		urcu_die(ret);
+	free(domain);
+	return 0;
+}
+
+struct rcu_reader *rcu_domain_register_thread(struct rcu_domain *parent)
+{
+	struct rcu_domain_impl *domain =
+		caa_container_of(parent, struct rcu_domain_impl, parent);
+	struct rcu_reader *reader;
+	int ret;
+
+	ret = posix_memalign((void **) &reader, CAA_CACHE_LINE_SIZE,
+			sizeof(*reader));
+	if (ret) {
+		errno = ret;
+		return NULL;
+	}
+	memset(reader, 0, sizeof(*reader));
+	reader->tid = pthread_self();
+
+	mutex_lock(&domain->registry_lock);
+	cds_list_add(&reader->node, &domain->registry);
+	domain->registry_gen++;
+	mutex_unlock(&domain->registry_lock);
+	_rcu_domain_thread_online(parent, reader);
+	return reader;
+}
+
+void rcu_domain_unregister_thread(struct rcu_domain *parent,
+		struct rcu_reader *reader)
+{
+	struct rcu_domain_impl *domain =
+		caa_container_of(parent, struct rcu_domain_impl, parent);
+
+	_rcu_domain_thread_offline(parent, reader);
+	mutex_lock(&domain->registry_lock);
+	(void) urcu_boost_restore(reader->tid, &reader->boosted,
+			&reader->boost_policy, &reader->boost_param);
+	cds_list_del(&reader->node);
+	domain->registry_gen++;
+	mutex_unlock(&domain->registry_lock);
+	free(reader);
+}
+
+void rcu_domain_read_lock(struct rcu_domain *domain, struct rcu_reader *reader)
+{
+	_rcu_domain_read_lock(domain, reader);
+}
+
+void rcu_domain_read_unlock(struct rcu_domain *domain,
+		struct rcu_reader *reader)
+{
+	_rcu_domain_read_unlock(domain, reader);
+}
+
+int rcu_domain_read_ongoing(struct rcu_reader *reader)
+{
+	return _rcu_domain_read_ongoing(reader);
+}
+
+void rcu_domain_quiescent_state(struct rcu_domain *domain,
+		struct rcu_reader *reader)
+{
+	_rcu_domain_quiescent_state(domain, reader);
+}
+
+void rcu_domain_thread_offline(struct rcu_domain *domain,
+		struct rcu_reader *reader)
+{
+	_rcu_domain_thread_offline(domain, reader);
+}
+
+void rcu_domain_thread_online(struct rcu_domain *domain,
+		struct rcu_reader *reader)
+{
+	_rcu_domain_thread_online(domain, reader);
+}
+
+void rcu_domain_synchronize(struct rcu_domain *parent)
+{
+	domain_synchronize_offline(caa_container_of(parent,
+			struct rcu_domain_impl, parent));
+}
+
+static void domain_gp_sync(void *arg)
+{
+	domain_synchronize_offline(arg);
+}
+
+void rcu_domain_call(struct rcu_domain *parent, struct rcu_head *head,
+		void (*func)(struct rcu_head *head))
+{
+	struct rcu_domain_impl *domain =
+		caa_container_of(parent, struct rcu_domain_impl, parent);
+	struct call_rcu_data *crdp;
+
+	crdp = get_domain_call_rcu_data(&domain->crdp, domain_gp_sync, domain);
+	_call_rcu(head, func, crdp);
 }
 
 void rcu_exit(void)
@@ -456,3 +1069,4 @@ DEFINE_RCU_FLAVOR(rcu_flavor);
 
 #include "urcu-call-rcu-impl.h"
 #include "urcu-defer-impl.h"
+#include "urcu-poll-impl.h"
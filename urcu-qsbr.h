@@ -36,6 +36,10 @@
  * publication headers.
  */
 #include <urcu-pointer.h>
+#include <urcu/wait-mode.h>
+#include <urcu/stall.h>
+#include <urcu/gp-stats.h>
+#include <urcu/reader-info.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -73,9 +77,17 @@ extern "C" {
 #define rcu_read_ongoing_qsbr		_rcu_read_ongoing
 
 #define rcu_quiescent_state_qsbr	_rcu_quiescent_state
+#define rcu_context_switch_qsbr		_rcu_context_switch
 #define rcu_thread_offline_qsbr		_rcu_thread_offline
 #define rcu_thread_online_qsbr		_rcu_thread_online
 
+#define rcu_domain_read_lock_qsbr		_rcu_domain_read_lock
+#define rcu_domain_read_unlock_qsbr		_rcu_domain_read_unlock
+#define rcu_domain_read_ongoing_qsbr		_rcu_domain_read_ongoing
+#define rcu_domain_quiescent_state_qsbr		_rcu_domain_quiescent_state
+#define rcu_domain_thread_offline_qsbr		_rcu_domain_thread_offline
+#define rcu_domain_thread_online_qsbr		_rcu_domain_thread_online
+
 #else /* !_LGPL_SOURCE */
 
 /*
@@ -110,12 +122,152 @@ extern void rcu_read_unlock(void);
 
 extern int rcu_read_ongoing(void);
 extern void rcu_quiescent_state(void);
+extern void rcu_context_switch(void);
 extern void rcu_thread_offline(void);
 extern void rcu_thread_online(void);
 
+struct rcu_domain;
+struct rcu_reader;
+
+extern void rcu_domain_read_lock(struct rcu_domain *domain,
+		struct rcu_reader *reader);
+extern void rcu_domain_read_unlock(struct rcu_domain *domain,
+		struct rcu_reader *reader);
+extern int rcu_domain_read_ongoing(struct rcu_reader *reader);
+extern void rcu_domain_quiescent_state(struct rcu_domain *domain,
+		struct rcu_reader *reader);
+extern void rcu_domain_thread_offline(struct rcu_domain *domain,
+		struct rcu_reader *reader);
+extern void rcu_domain_thread_online(struct rcu_domain *domain,
+		struct rcu_reader *reader);
+
+#ifdef URCU_INLINE_SMALL_FUNCTIONS
+
+/*
+ * Quiescent state and online/offline fast paths inlined into non-LGPL
+ * code (see urcu.h). rcu_read_lock() and rcu_read_unlock() are no-ops
+ * already.
+ */
+#include <urcu/static/urcu-qsbr.h>
+
+static inline int _rcu_read_ongoing_abi(void)
+{
+	if (caa_likely(rcu_reader_abi == RCU_READER_ABI))
+		return _rcu_read_ongoing();
+	return rcu_read_ongoing();
+}
+
+static inline void _rcu_quiescent_state_abi(void)
+{
+	if (caa_likely(rcu_reader_abi == RCU_READER_ABI))
+		_rcu_quiescent_state();
+	else
+		rcu_quiescent_state();
+}
+
+static inline void _rcu_context_switch_abi(void)
+{
+	if (caa_likely(rcu_reader_abi == RCU_READER_ABI))
+		_rcu_context_switch();
+	else
+		rcu_context_switch();
+}
+
+static inline void _rcu_thread_offline_abi(void)
+{
+	if (caa_likely(rcu_reader_abi == RCU_READER_ABI))
+		_rcu_thread_offline();
+	else
+		rcu_thread_offline();
+}
+
+static inline void _rcu_thread_online_abi(void)
+{
+	if (caa_likely(rcu_reader_abi == RCU_READER_ABI))
+		_rcu_thread_online();
+	else
+		rcu_thread_online();
+}
+
+#define rcu_read_ongoing_qsbr		_rcu_read_ongoing_abi
+#define rcu_quiescent_state_qsbr	_rcu_quiescent_state_abi
+#define rcu_context_switch_qsbr		_rcu_context_switch_abi
+#define rcu_thread_offline_qsbr		_rcu_thread_offline_abi
+#define rcu_thread_online_qsbr		_rcu_thread_online_abi
+
+#endif /* URCU_INLINE_SMALL_FUNCTIONS */
+
 #endif /* !_LGPL_SOURCE */
 
 extern void synchronize_rcu(void);
+extern unsigned long synchronize_rcu_expedited(void);
+
+/*
+ * Grace period polling. See rcu-api.md in userspace-rcu documentation
+ * for usage detail.
+ */
+extern unsigned long get_state_synchronize_rcu(void);
+extern unsigned long start_poll_synchronize_rcu(void);
+extern int poll_state_synchronize_rcu(unsigned long cookie);
+extern void cond_synchronize_rcu(unsigned long cookie);
+
+/*
+ * Number of helper threads scanning the registered readers in parallel
+ * with the grace period. See rcu-api.md in userspace-rcu documentation
+ * for usage detail.
+ */
+extern int rcu_set_gp_scan_threads(unsigned int nr_threads);
+
+/*
+ * Grace period waiting policy. See rcu-api.md in userspace-rcu
+ * documentation for usage detail.
+ */
+extern int rcu_set_wait_mode(enum rcu_wait_mode mode);
+
+/*
+ * Report readers delaying grace periods. See rcu-api.md in
+ * userspace-rcu documentation for usage detail.
+ */
+extern int rcu_set_stall_detector(unsigned long threshold_ms,
+		rcu_stall_func func, void *priv);
+
+/*
+ * Reader priority boosting. See rcu-api.md in userspace-rcu
+ * documentation for usage detail.
+ */
+extern int rcu_set_reader_boost(unsigned long threshold_ms, int policy,
+		int priority);
+
+/*
+ * Grace period statistics. See rcu-api.md in userspace-rcu
+ * documentation for usage detail.
+ */
+extern void rcu_get_gp_stats(struct rcu_gp_stats *stats);
+extern void rcu_reset_gp_stats(void);
+
+/*
+ * Registered readers introspection. See rcu-api.md in userspace-rcu
+ * documentation for usage detail.
+ */
+extern unsigned int rcu_get_readers(struct rcu_reader_info *readers,
+		unsigned int nr);
+
+/*
+ * RCU domains. See rcu-api.md in userspace-rcu documentation for usage
+ * detail.
+ */
+struct rcu_domain;
+struct rcu_reader;
+struct rcu_head;
+
+extern struct rcu_domain *rcu_domain_create(void);
+extern int rcu_domain_destroy(struct rcu_domain *domain);
+extern struct rcu_reader *rcu_domain_register_thread(struct rcu_domain *domain);
+extern void rcu_domain_unregister_thread(struct rcu_domain *domain,
+		struct rcu_reader *reader);
+extern void rcu_domain_synchronize(struct rcu_domain *domain);
+extern void rcu_domain_call(struct rcu_domain *domain, struct rcu_head *head,
+		void (*func)(struct rcu_head *head));
 
 /*
  * Reader thread registration.
@@ -123,6 +275,14 @@ extern void synchronize_rcu(void);
 extern void rcu_register_thread(void);
 extern void rcu_unregister_thread(void);
 
+/*
+ * Let the calling registered thread go offline and come back online
+ * without memory barriers, at the expense of a sys_membarrier() system
+ * call issued by each grace period. Returns -ENOSYS if the kernel does
+ * not support it. See rcu-api.md for usage detail.
+ */
+extern int rcu_thread_set_lazy_offline(int enable);
+
 #ifdef __cplusplus 
 }
 #endif
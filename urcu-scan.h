@@ -0,0 +1,403 @@
+#ifndef _URCU_SCAN_H
+#define _URCU_SCAN_H
+
+/*
+ * urcu-scan.h
+ *
+ * Userspace RCU library - parallel scan of the reader registry
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * To be included by the flavor implementation after its static header,
+ * which defines struct rcu_reader and enum rcu_state.
+ */
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <limits.h>
+#include <errno.h>
+#include <urcu/arch.h>
+#include <urcu/uatomic.h>
+#include <urcu/futex.h>
+#include <urcu/list.h>
+
+#include "urcu-die.h"
+
+/*
+ * While waiting for readers, the grace period reads the counter of
+ * each reader, which is written to by the CPU running that reader: the
+ * scan of a large registry is bound by cache misses. With helper
+ * threads, the readers to wait for are copied into an array once per
+ * pass of wait_for_readers(), and split into shards. At each scan, the
+ * helpers and the grace period thread read the reader states of one
+ * shard each, in parallel, and keep the readers still active at the
+ * head of their shard: later scans only read the states of those. The
+ * grace period thread only moves the readers found quiescent since the
+ * previous scan into the lists of their state.
+ *
+ * The array is copied again if the readers to wait for change while
+ * the grace period does not hold the registry lock, which the flavor
+ * tells by incrementing its registry generation.
+ *
+ * Helper threads are created on first use, and kept until the process
+ * exits. They are not RCU readers.
+ */
+#define URCU_SCAN_MAX_THREADS		64
+
+/* Minimum number of readers per shard. */
+#define URCU_SCAN_MIN_READERS		256
+
+/*
+ * Active attempts to check for helpers completion before calling futex().
+ */
+#define URCU_SCAN_ACTIVE_ATTEMPTS	100
+
+struct urcu_scan;
+
+struct urcu_scan_shard {
+	/* Index of the first reader of the shard in the array. */
+	size_t start;
+	/* Readers still active, then readers found quiescent. */
+	size_t nr_active, nr_done;
+};
+
+struct urcu_scan_thread {
+	struct urcu_scan *scan;
+	unsigned int shard;
+	/* Value of gen when the helper was started. */
+	int32_t gen;
+};
+
+struct urcu_scan {
+	/* Held by the grace period using the helper threads. */
+	pthread_mutex_t lock;
+	/* Number of helper threads requested. */
+	unsigned int nr_threads;
+	/* Number of helper threads started by process "pid". */
+	unsigned int nr_started;
+	pid_t pid;
+
+	/*
+	 * Readers of the pass identified by "token", copied from a
+	 * registry of generation "registry_gen".
+	 */
+	unsigned long token, last_token, registry_gen;
+	struct rcu_reader **readers;
+	enum rcu_state *states;
+	size_t alloc;
+	struct urcu_scan_shard shards[URCU_SCAN_MAX_THREADS + 1];
+	unsigned int nr_shards;
+	enum rcu_state (*reader_state)(void *arg, struct rcu_reader *reader);
+	void *arg;
+
+	/* Incremented to start each batch. Helpers wait on it. */
+	int32_t gen;
+	/* Number of helpers which have not completed the batch yet. */
+	int32_t pending;
+	/* Waited on by the grace period until pending reaches zero. */
+	int32_t futex;
+
+	struct urcu_scan_thread threads[URCU_SCAN_MAX_THREADS];
+};
+
+#define URCU_SCAN_INIT							\
+	{								\
+		.lock = PTHREAD_MUTEX_INITIALIZER,			\
+	}
+
+/*
+ * Read the states of the active readers of a shard, keeping those
+ * still active at its head, followed by those found quiescent.
+ */
+static void urcu_scan_shard(struct urcu_scan *scan, unsigned int nr)
+{
+	struct urcu_scan_shard *shard = &scan->shards[nr];
+	size_t i, active = shard->start;
+	size_t end = shard->start + shard->nr_active;
+
+	for (i = shard->start; i < end; i++) {
+		struct rcu_reader *reader = scan->readers[i];
+		enum rcu_state state = scan->reader_state(scan->arg, reader);
+
+		if (state == RCU_READER_ACTIVE_OLD) {
+			scan->readers[i] = scan->readers[active];
+			scan->states[i] = scan->states[active];
+			scan->readers[active++] = reader;
+		} else {
+			scan->states[i] = state;
+		}
+	}
+	shard->nr_active = active - shard->start;
+	shard->nr_done = end - active;
+}
+
+/*
+ * Each helper takes part in every batch, if only to acknowledge it, so
+ * the next batch cannot start before all helpers are done reading the
+ * current one.
+ */
+static void *urcu_scan_thread(void *arg)
+{
+	struct urcu_scan_thread *thread = arg;
+	struct urcu_scan *scan = thread->scan;
+	int32_t gen = thread->gen;
+
+	for (;;) {
+		while (uatomic_read(&scan->gen) == gen)
+			(void) futex_async(&scan->gen, FUTEX_WAIT, gen,
+					NULL, NULL, 0);
+		gen = uatomic_read(&scan->gen);
+		/* Read gen before reading the batch. */
+		cmm_smp_mb();
+		if (thread->shard < scan->nr_shards)
+			urcu_scan_shard(scan, thread->shard);
+		/* Write states before decrementing pending. */
+		cmm_smp_mb();
+		if (uatomic_add_return(&scan->pending, -1) == 0
+				&& uatomic_read(&scan->futex) == -1) {
+			uatomic_set(&scan->futex, 0);
+			(void) futex_async(&scan->futex, FUTEX_WAKE, 1,
+					NULL, NULL, 0);
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Start helper threads until "nr_threads" are running. Called with
+ * scan->lock held, between batches. Helpers are created with all
+ * signals blocked.
+ */
+static void urcu_scan_start_threads(struct urcu_scan *scan,
+		unsigned int nr_threads)
+{
+	sigset_t newmask, oldmask;
+	pthread_t tid;
+	int ret;
+
+	if (scan->pid != getpid()) {
+		/* Helpers of the parent process do not survive fork(). */
+		scan->pid = getpid();
+		scan->nr_started = 0;
+	}
+	if (scan->nr_started >= nr_threads)
+		return;
+	ret = sigfillset(&newmask);
+	if (ret)
+		urcu_die(errno);
+	ret = pthread_sigmask(SIG_BLOCK, &newmask, &oldmask);
+	if (ret)
+		urcu_die(ret);
+	while (scan->nr_started < nr_threads) {
+		struct urcu_scan_thread *thread =
+			&scan->threads[scan->nr_started];
+
+		thread->scan = scan;
+		thread->shard = scan->nr_started + 1;
+		thread->gen = scan->gen;
+		if (pthread_create(&tid, NULL, urcu_scan_thread, thread))
+			break;
+		(void) pthread_detach(tid);
+		scan->nr_started++;
+	}
+	ret = pthread_sigmask(SIG_SETMASK, &oldmask, NULL);
+	if (ret)
+		urcu_die(ret);
+}
+
+static int urcu_scan_set_threads(struct urcu_scan *scan,
+		unsigned int nr_threads)
+{
+	if (nr_threads > URCU_SCAN_MAX_THREADS)
+		return -EINVAL;
+	CMM_STORE_SHARED(scan->nr_threads, nr_threads);
+	return 0;
+}
+
+/*
+ * Copy the readers of "input_readers" into the array, and split it into
+ * at most "nr_shards" shards. Return the number of shards, or 0 if the
+ * array cannot be grown.
+ */
+static unsigned int urcu_scan_copy(struct urcu_scan *scan,
+		struct cds_list_head *input_readers, unsigned int nr_shards)
+{
+	struct rcu_reader *index;
+	unsigned int i;
+	size_t nr = 0;
+
+	cds_list_for_each_entry(index, input_readers, node) {
+		if (nr == scan->alloc) {
+			size_t alloc = scan->alloc ? scan->alloc << 1
+					: URCU_SCAN_MIN_READERS;
+			void *readers, *states;
+
+			readers = realloc(scan->readers,
+					alloc * sizeof(*scan->readers));
+			if (!readers)
+				return 0;
+			scan->readers = readers;
+			states = realloc(scan->states,
+					alloc * sizeof(*scan->states));
+			if (!states)
+				return 0;
+			scan->states = states;
+			scan->alloc = alloc;
+		}
+		scan->readers[nr++] = index;
+	}
+	if (nr_shards > nr / URCU_SCAN_MIN_READERS)
+		nr_shards = nr / URCU_SCAN_MIN_READERS;
+	for (i = 0; i < nr_shards; i++) {
+		struct urcu_scan_shard *shard = &scan->shards[i];
+
+		shard->start = nr * i / nr_shards;
+		shard->nr_active = nr * (i + 1) / nr_shards - shard->start;
+		shard->nr_done = 0;
+	}
+	return nr_shards;
+}
+
+static void urcu_scan_wait(struct urcu_scan *scan)
+{
+	unsigned int wait_loops = 0;
+
+	while (uatomic_read(&scan->pending)) {
+		if (wait_loops < URCU_SCAN_ACTIVE_ATTEMPTS) {
+			wait_loops++;
+			caa_cpu_relax();
+			continue;
+		}
+		uatomic_set(&scan->futex, -1);
+		/* Write futex before read pending */
+		cmm_smp_mb();
+		if (uatomic_read(&scan->pending))
+			(void) futex_async(&scan->futex, FUTEX_WAIT, -1,
+					NULL, NULL, 0);
+		uatomic_set(&scan->futex, 0);
+	}
+	/* Read pending before reading states. */
+	cmm_smp_mb();
+}
+
+/*
+ * Move the readers of "input_readers" into "cur_snap_readers" or
+ * "qsreaders" according to their state, as computed by
+ * "reader_state", like the serial scan of wait_for_readers(). Return
+ * the number of readers scanned, or 0 if too few readers are left to
+ * split them, if no helper thread is available or if another grace
+ * period is using them, in which case the caller scans the readers
+ * itself.
+ *
+ * "*token" identifies the copy of the readers used by the pass of the
+ * caller. It is 0 at the start of a pass, and reset to 0 whenever the
+ * caller scans the readers itself. "registry_gen" is the generation of
+ * the registry of the caller, which holds its registry lock.
+ */
+static size_t urcu_scan_readers(struct urcu_scan *scan,
+		struct cds_list_head *input_readers,
+		struct cds_list_head *cur_snap_readers,
+		struct cds_list_head *qsreaders,
+		enum rcu_state (*reader_state)(void *arg,
+			struct rcu_reader *reader),
+		void *arg, unsigned long *token, unsigned long registry_gen)
+{
+	unsigned int nr_threads = CMM_LOAD_SHARED(scan->nr_threads);
+	unsigned int i, nr_shards;
+	size_t j, nr_active = 0, ret;
+
+	if (!nr_threads || pthread_mutex_trylock(&scan->lock))
+		goto serial_unlocked;
+	if (!*token || scan->token != *token
+			|| scan->registry_gen != registry_gen) {
+		/* New pass, or the readers to wait for changed. */
+		scan->token = 0;
+		urcu_scan_start_threads(scan, nr_threads);
+		if (!scan->nr_started)
+			goto serial;
+		nr_shards = urcu_scan_copy(scan, input_readers,
+				caa_min(nr_threads, scan->nr_started) + 1);
+		if (nr_shards < 2)
+			goto serial;
+		scan->nr_shards = nr_shards;
+		scan->token = *token = ++scan->last_token;
+		scan->registry_gen = registry_gen;
+	}
+	for (i = 0; i < scan->nr_shards; i++)
+		nr_active += scan->shards[i].nr_active;
+	/* Few readers are left: the caller scans them faster. */
+	if (nr_active < 2 * URCU_SCAN_MIN_READERS) {
+		scan->token = 0;
+		goto serial;
+	}
+
+	scan->reader_state = reader_state;
+	scan->arg = arg;
+	uatomic_set(&scan->pending, scan->nr_started);
+	/* Write the batch before gen. */
+	cmm_smp_mb();
+	uatomic_inc(&scan->gen);
+	(void) futex_async(&scan->gen, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+	urcu_scan_shard(scan, 0);
+	urcu_scan_wait(scan);
+
+	for (i = 0; i < scan->nr_shards; i++) {
+		struct urcu_scan_shard *shard = &scan->shards[i];
+		size_t end = shard->start + shard->nr_active + shard->nr_done;
+
+		for (j = shard->start + shard->nr_active; j < end; j++) {
+			struct rcu_reader *reader = scan->readers[j];
+
+			switch (scan->states[j]) {
+			case RCU_READER_ACTIVE_CURRENT:
+				if (cur_snap_readers) {
+					cds_list_move(&reader->node,
+						cur_snap_readers);
+					break;
+				}
+				/* Fall-through */
+			case RCU_READER_INACTIVE:
+				cds_list_move(&reader->node, qsreaders);
+				break;
+			case RCU_READER_ACTIVE_OLD:
+				break;
+			}
+		}
+		shard->nr_done = 0;
+	}
+	ret = nr_active;
+	goto end;
+
+serial:
+	ret = 0;
+end:
+	if (pthread_mutex_unlock(&scan->lock))
+		urcu_die(EINVAL);
+	if (!ret)
+		*token = 0;
+	return ret;
+
+serial_unlocked:
+	*token = 0;
+	return 0;
+}
+
+#endif /* _URCU_SCAN_H */
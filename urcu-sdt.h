@@ -0,0 +1,47 @@
+#ifndef _URCU_SDT_H
+#define _URCU_SDT_H
+
+/*
+ * urcu-sdt.h
+ *
+ * Userspace RCU library - static probes
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <urcu/config.h>
+
+/*
+ * USDT probes of the "urcu" provider, built with --enable-sdt. A probe
+ * is a nop instruction until a tracer (e.g. bpftrace, perf, systemtap)
+ * attaches to it. Probe arguments are only evaluated when built in.
+ */
+#ifdef CONFIG_RCU_SDT
+#include <sys/sdt.h>
+
+#define urcu_probe(name)		DTRACE_PROBE(urcu, name)
+#define urcu_probe1(name, a)		DTRACE_PROBE1(urcu, name, a)
+#define urcu_probe2(name, a, b)		DTRACE_PROBE2(urcu, name, a, b)
+#define urcu_probe3(name, a, b, c)	DTRACE_PROBE3(urcu, name, a, b, c)
+#else
+#define urcu_probe(name)
+#define urcu_probe1(name, a)
+#define urcu_probe2(name, a, b)
+#define urcu_probe3(name, a, b, c)
+#endif
+
+#endif /* _URCU_SDT_H */
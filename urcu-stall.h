@@ -0,0 +1,320 @@
+#ifndef _URCU_STALL_INTERNAL_H
+#define _URCU_STALL_INTERNAL_H
+
+/*
+ * urcu-stall.h
+ *
+ * Userspace RCU library - reader stall detection
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <errno.h>
+#include <string.h>
+#include <urcu/system.h>
+#include <urcu/futex.h>
+#include <urcu/stall.h>
+
+#include "urcu-die.h"
+
+/*
+ * Stall detector, set by rcu_set_stall_detector(). While waiting for
+ * readers, a grace period which lasted for more than threshold_ms
+ * reports each reader it is still waiting for to "func", then again
+ * every threshold_ms.
+ */
+struct urcu_stall_detector {
+	pthread_mutex_t lock;
+	/* 0 if disabled. Read without lock by grace periods. */
+	unsigned long threshold_ms;
+	rcu_stall_func func;
+	void *priv;
+};
+
+#define URCU_STALL_DETECTOR_INIT					\
+	{								\
+		.lock = PTHREAD_MUTEX_INITIALIZER,			\
+	}
+
+/*
+ * Reader boosting, set by rcu_set_reader_boost(). A grace period which
+ * waited for more than threshold_ms sets the scheduling policy and
+ * priority of the threads of the readers it is still waiting for, and
+ * restores them once these readers no longer hold it.
+ */
+struct urcu_boost {
+	pthread_mutex_t lock;
+	/* 0 if disabled. Read without lock by grace periods. */
+	unsigned long threshold_ms;
+	int policy;
+	int priority;
+};
+
+#define URCU_BOOST_INIT							\
+	{								\
+		.lock = PTHREAD_MUTEX_INITIALIZER,			\
+	}
+
+/* Stall detector and boosting state of a grace period waiting for readers. */
+struct urcu_stall_gp {
+	/* 0 if disabled. */
+	unsigned long threshold_ms;
+	rcu_stall_func func;
+	void *priv;
+	unsigned long start_ms;
+	/* Time of the next report. */
+	unsigned long next_ms;
+
+	/* Non-zero until readers are boosted, at boost_ms. */
+	int boost_pending;
+	unsigned long boost_ms;
+	int boost_policy;
+	struct sched_param boost_param;
+	/* Number of readers boosted and not restored yet. */
+	unsigned int nr_boosted;
+};
+
+static inline unsigned long urcu_stall_now_ms(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts))
+		urcu_die(errno);
+	return (unsigned long) ts.tv_sec * 1000UL + ts.tv_nsec / 1000000L;
+}
+
+static int urcu_stall_set(struct urcu_stall_detector *detector,
+		unsigned long threshold_ms, rcu_stall_func func, void *priv)
+{
+	int ret;
+
+	if (threshold_ms && !func)
+		return -EINVAL;
+	ret = pthread_mutex_lock(&detector->lock);
+	if (ret)
+		urcu_die(ret);
+	detector->func = func;
+	detector->priv = priv;
+	CMM_STORE_SHARED(detector->threshold_ms, func ? threshold_ms : 0);
+	ret = pthread_mutex_unlock(&detector->lock);
+	if (ret)
+		urcu_die(ret);
+	return 0;
+}
+
+static int urcu_boost_set(struct urcu_boost *boost,
+		unsigned long threshold_ms, int policy, int priority)
+{
+	int min, max, ret;
+
+	if (threshold_ms) {
+		min = sched_get_priority_min(policy);
+		max = sched_get_priority_max(policy);
+		if (min < 0 || max < 0 || priority < min || priority > max)
+			return -EINVAL;
+	}
+	ret = pthread_mutex_lock(&boost->lock);
+	if (ret)
+		urcu_die(ret);
+	boost->policy = policy;
+	boost->priority = priority;
+	CMM_STORE_SHARED(boost->threshold_ms, threshold_ms);
+	ret = pthread_mutex_unlock(&boost->lock);
+	if (ret)
+		urcu_die(ret);
+	return 0;
+}
+
+/*
+ * Take a snapshot of the detector and boosting settings for the grace
+ * period about to wait for readers, and start timing it if enabled.
+ */
+static void urcu_stall_gp_init(struct urcu_stall_gp *gp,
+		struct urcu_stall_detector *detector,
+		struct urcu_boost *boost)
+{
+	unsigned long boost_ms = 0;
+	int ret;
+
+	gp->threshold_ms = 0;
+	gp->start_ms = gp->next_ms = 0;
+	gp->boost_pending = 0;
+	gp->boost_ms = 0;
+	gp->nr_boosted = 0;
+	if (caa_likely(!CMM_LOAD_SHARED(detector->threshold_ms)
+			&& !CMM_LOAD_SHARED(boost->threshold_ms)))
+		return;
+	ret = pthread_mutex_lock(&detector->lock);
+	if (ret)
+		urcu_die(ret);
+	gp->threshold_ms = detector->threshold_ms;
+	gp->func = detector->func;
+	gp->priv = detector->priv;
+	ret = pthread_mutex_unlock(&detector->lock);
+	if (ret)
+		urcu_die(ret);
+	ret = pthread_mutex_lock(&boost->lock);
+	if (ret)
+		urcu_die(ret);
+	boost_ms = boost->threshold_ms;
+	gp->boost_policy = boost->policy;
+	memset(&gp->boost_param, 0, sizeof(gp->boost_param));
+	gp->boost_param.sched_priority = boost->priority;
+	ret = pthread_mutex_unlock(&boost->lock);
+	if (ret)
+		urcu_die(ret);
+	if (!gp->threshold_ms && !boost_ms)
+		return;
+	gp->start_ms = urcu_stall_now_ms();
+	if (gp->threshold_ms)
+		gp->next_ms = gp->start_ms + gp->threshold_ms;
+	if (boost_ms) {
+		gp->boost_pending = 1;
+		gp->boost_ms = gp->start_ms + boost_ms;
+	}
+}
+
+/*
+ * Return 1 if the readers still awaited by the grace period are due
+ * for a report, setting "*now" to the current time.
+ */
+static int urcu_stall_gp_due(struct urcu_stall_gp *gp, unsigned long *now)
+{
+	if (caa_likely(!gp->threshold_ms))
+		return 0;
+	*now = urcu_stall_now_ms();
+	if ((long) (*now - gp->next_ms) < 0)
+		return 0;
+	gp->next_ms = *now + gp->threshold_ms;
+	return 1;
+}
+
+/*
+ * Report a reader still awaited by the grace period. "stall_ctr" and
+ * "stall_since" belong to the reader and are only accessed by grace
+ * periods: they tell since when the reader has been seen with counter
+ * "ctr", which may span several grace periods.
+ */
+static void urcu_stall_report(struct urcu_stall_gp *gp, unsigned long now,
+		pthread_t tid, unsigned long ctr, unsigned long nesting,
+		unsigned long *stall_ctr, unsigned long *stall_since)
+{
+	struct rcu_stall_info info;
+
+	if (*stall_ctr != ctr || (long) (gp->start_ms - *stall_since) < 0) {
+		*stall_ctr = ctr;
+		*stall_since = gp->start_ms;
+	}
+	info.tid = tid;
+	info.ctr = ctr;
+	info.nesting = nesting;
+	info.stall_ms = now - *stall_since;
+	info.gp_ms = now - gp->start_ms;
+	gp->func(&info, gp->priv);
+}
+
+/*
+ * Return 1 once the readers still awaited by the grace period are due
+ * for boosting.
+ */
+static int urcu_boost_gp_due(struct urcu_stall_gp *gp)
+{
+	if (caa_likely(!gp->boost_pending))
+		return 0;
+	if ((long) (urcu_stall_now_ms() - gp->boost_ms) < 0)
+		return 0;
+	gp->boost_pending = 0;
+	return 1;
+}
+
+/*
+ * Boost the thread of a reader still awaited by the grace period, unless
+ * it already runs with a real-time priority at least as high.
+ * "boosted", "policy" and "param" belong to the reader and are only
+ * accessed with the registry lock held: they save the scheduling of
+ * the thread until urcu_boost_restore(). Failures, such as lacking the
+ * privilege to raise priorities, leave the reader as is.
+ */
+static void urcu_boost_reader(struct urcu_stall_gp *gp, pthread_t tid,
+		int *boosted, int *policy, struct sched_param *param)
+{
+	if (*boosted)
+		return;
+	if (pthread_getschedparam(tid, policy, param))
+		return;
+	if ((*policy == SCHED_FIFO || *policy == SCHED_RR)
+			&& param->sched_priority
+				>= gp->boost_param.sched_priority)
+		return;
+	if (pthread_setschedparam(tid, gp->boost_policy, &gp->boost_param))
+		return;
+	*boosted = 1;
+	gp->nr_boosted++;
+}
+
+/*
+ * Restore the scheduling of a reader thread if it was boosted. Return 1
+ * if it was.
+ */
+static int urcu_boost_restore(pthread_t tid, int *boosted, int *policy,
+		struct sched_param *param)
+{
+	if (caa_likely(!*boosted))
+		return 0;
+	(void) pthread_setschedparam(tid, *policy, param);
+	*boosted = 0;
+	return 1;
+}
+
+/*
+ * Return the timeout of a futex wait of the grace period, so it wakes
+ * up in time for the next report or for boosting readers, or NULL if
+ * it may wait for as long as needed. The compat futex does not support
+ * timeouts: reports are then delayed until a reader wakes up the grace
+ * period.
+ */
+static inline
+const struct timespec *urcu_stall_timeout(struct urcu_stall_gp *gp,
+		struct timespec *ts)
+{
+#ifdef CONFIG_RCU_HAVE_FUTEX
+	unsigned long now, deadline;
+	long delay;
+
+	if (caa_likely(!gp->threshold_ms && !gp->boost_pending))
+		return NULL;
+	if (!gp->threshold_ms || (gp->boost_pending
+			&& (long) (gp->boost_ms - gp->next_ms) < 0))
+		deadline = gp->boost_ms;
+	else
+		deadline = gp->next_ms;
+	now = urcu_stall_now_ms();
+	delay = (long) (deadline - now);
+	if (delay < 1)
+		delay = 1;
+	ts->tv_sec = delay / 1000;
+	ts->tv_nsec = (delay % 1000) * 1000000L;
+	return ts;
+#else
+	return NULL;
+#endif
+}
+
+#endif /* _URCU_STALL_INTERNAL_H */
@@ -23,22 +23,41 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <sched.h>
 #include <urcu/uatomic.h>
+#include <urcu/futex.h>
 #include <urcu/wfstack.h>
+#include <urcu/wait-mode.h>
 
 /*
  * Number of busy-loop attempts before waiting on futex for grace period
- * batching.
+ * batching, when no recent wait tells better.
  */
 #define URCU_WAIT_ATTEMPTS 1000
 
+/*
+ * Adaptive waiting. A wait busy-waits for a number of loops, then
+ * yields the CPU for a few loops, then sleeps. In the adaptive mode,
+ * the number of busy-wait loops is learned from the number of loops
+ * after which recent waits completed: twice their moving average, as
+ * long as it stays below URCU_WAIT_SPIN_FACTOR times the nominal
+ * number of attempts. Beyond, waits are deemed long, and sleep after a
+ * few loops. Waits which had to sleep account for the largest number
+ * of loops.
+ */
+#define URCU_WAIT_SPIN_FACTOR		10
+#define URCU_WAIT_YIELD_ATTEMPTS	10
+/* Weight of the last wait in the moving average, as a shift. */
+#define URCU_WAIT_AVG_SHIFT		3
+
 enum urcu_wait_state {
 	/* URCU_WAIT_WAITING is compared directly (futex compares it). */
 	URCU_WAIT_WAITING =	0,
 	/* non-zero are used as masks. */
 	URCU_WAIT_WAKEUP =	(1 << 0),
 	URCU_WAIT_RUNNING =	(1 << 1),
-	URCU_WAIT_TEARDOWN =	(1 << 2),
+	/* Set by the waiter before it sleeps on the futex. */
+	URCU_WAIT_SLEEPING =	(1 << 2),
 };
 
 struct urcu_wait_node {
@@ -72,6 +91,110 @@ struct urcu_waiters {
 	struct cds_wfs_head *head;
 };
 
+struct urcu_wait_policy {
+	/*
+	 * Moving average of the number of loops after which recent
+	 * waits completed, scaled by 2^URCU_WAIT_AVG_SHIFT, or 0 before
+	 * the first wait.
+	 */
+	unsigned int avg;
+};
+
+struct urcu_wait_budget {
+	/* Busy-wait for "spin" loops, then yield until "sleep" loops. */
+	unsigned int spin, sleep;
+	/* Number of loops accounted for a wait which had to sleep. */
+	unsigned int max;
+};
+
+static inline
+int urcu_wait_mode_valid(enum rcu_wait_mode mode)
+{
+	switch (mode) {
+	case RCU_WAIT_MODE_ADAPTIVE:
+	case RCU_WAIT_MODE_LATENCY:
+	case RCU_WAIT_MODE_EFFICIENCY:
+		return 1;
+	}
+	return 0;
+}
+
+/*
+ * Compute the budget of a wait, "attempts" being its nominal number of
+ * busy-wait loops.
+ */
+static inline
+void urcu_wait_budget_init(struct urcu_wait_budget *budget,
+		struct urcu_wait_policy *policy, int mode,
+		unsigned int attempts)
+{
+	unsigned int avg = CMM_LOAD_SHARED(policy->avg);
+	unsigned int min = attempts / URCU_WAIT_SPIN_FACTOR;
+
+	budget->max = attempts * URCU_WAIT_SPIN_FACTOR;
+	switch (mode) {
+	case RCU_WAIT_MODE_LATENCY:
+		budget->spin = budget->max;
+		budget->sleep = budget->spin + URCU_WAIT_YIELD_ATTEMPTS
+				* URCU_WAIT_SPIN_FACTOR;
+		return;
+	case RCU_WAIT_MODE_EFFICIENCY:
+		budget->spin = budget->sleep = 1;
+		return;
+	}
+	if (!avg) {
+		budget->spin = budget->sleep = attempts;
+	} else if ((avg >> URCU_WAIT_AVG_SHIFT) < budget->max >> 1) {
+		budget->spin = 2 * (avg >> URCU_WAIT_AVG_SHIFT);
+		if (budget->spin < min)
+			budget->spin = min;
+		budget->sleep = budget->spin + URCU_WAIT_YIELD_ATTEMPTS;
+	} else {
+		budget->spin = budget->sleep = min ? min : 1;
+	}
+}
+
+/*
+ * Relax the CPU after "loops" unsuccessful checks of the awaited
+ * condition, "loops" being below the sleep threshold.
+ */
+static inline
+void urcu_wait_budget_relax(struct urcu_wait_budget *budget,
+		unsigned int loops)
+{
+	if (loops < budget->spin)
+		caa_cpu_relax();
+	else
+		(void) sched_yield();
+}
+
+/*
+ * Account for a wait which completed after "loops" checks of its
+ * condition. Waits reaching their sleep threshold count as the
+ * longest ones. Updates are racy: concurrent waiters may lose each
+ * other's update, which only slows learning down.
+ */
+static inline
+void urcu_wait_policy_record(struct urcu_wait_policy *policy,
+		struct urcu_wait_budget *budget, unsigned int loops)
+{
+	unsigned int avg = CMM_LOAD_SHARED(policy->avg);
+
+	if (loops >= budget->sleep || loops > budget->max)
+		loops = budget->max;
+	if (!avg)
+		avg = loops << URCU_WAIT_AVG_SHIFT;
+	else
+		avg = avg - (avg >> URCU_WAIT_AVG_SHIFT) + loops;
+	CMM_STORE_SHARED(policy->avg, avg);
+}
+
+static inline
+void urcu_wait_queue_init(struct urcu_wait_queue *queue)
+{
+	cds_wfs_init(&queue->stack);
+}
+
 /*
  * Add ourself atomically to a wait queue. Return 0 if queue was
  * previously empty, else return 1.
@@ -111,58 +234,58 @@ void urcu_wait_node_init(struct urcu_wait_node *node,
 }
 
 /*
- * Note: urcu_adaptative_wake_up needs "value" to stay allocated
- * throughout its execution. In this scheme, the waiter owns the node
- * memory, and we only allow it to free this memory when it receives the
- * URCU_WAIT_TEARDOWN flag.
+ * The waiter owns the node memory, and may free it as soon as it reads
+ * URCU_WAIT_WAKEUP: the exchange is the last access of the waker to the
+ * node, so the waiter never has to wait for the waker to be done with
+ * it. FUTEX_WAKE only uses the address of the node, which is harmless
+ * if the memory has been freed or reused meanwhile: at worst, it wakes
+ * up another futex waiter, and futex waiters all check their condition
+ * again when woken up.
  */
 static inline
 void urcu_adaptative_wake_up(struct urcu_wait_node *wait)
 {
+	int32_t old;
+
 	cmm_smp_mb();
-	assert(uatomic_read(&wait->state) == URCU_WAIT_WAITING);
-	uatomic_set(&wait->state, URCU_WAIT_WAKEUP);
-	if (!(uatomic_read(&wait->state) & URCU_WAIT_RUNNING))
+	old = uatomic_xchg(&wait->state, URCU_WAIT_WAKEUP);
+	assert(old == URCU_WAIT_WAITING || old == URCU_WAIT_SLEEPING);
+	if (old == URCU_WAIT_SLEEPING)
 		futex_noasync(&wait->state, FUTEX_WAKE, 1, NULL, NULL, 0);
-	/* Allow teardown of struct urcu_wait memory. */
-	uatomic_or(&wait->state, URCU_WAIT_TEARDOWN);
 }
 
 /*
  * Caller must initialize "value" to URCU_WAIT_WAITING before passing its
- * memory to waker thread.
+ * memory to waker thread. "policy" learns how long waits last, "mode"
+ * being an enum rcu_wait_mode. The node memory can be freed as soon as
+ * this function returns.
  */
 static inline
-void urcu_adaptative_busy_wait(struct urcu_wait_node *wait)
+void urcu_adaptative_busy_wait(struct urcu_wait_node *wait,
+		struct urcu_wait_policy *policy, int mode)
 {
+	struct urcu_wait_budget budget;
 	unsigned int i;
 
+	urcu_wait_budget_init(&budget, policy, mode, URCU_WAIT_ATTEMPTS);
 	/* Load and test condition before read state */
 	cmm_smp_rmb();
-	for (i = 0; i < URCU_WAIT_ATTEMPTS; i++) {
+	for (i = 1;; i++) {
 		if (uatomic_read(&wait->state) != URCU_WAIT_WAITING)
 			goto skip_futex_wait;
-		caa_cpu_relax();
-	}
-	futex_noasync(&wait->state, FUTEX_WAIT,
-		URCU_WAIT_WAITING, NULL, NULL, 0);
-skip_futex_wait:
-
-	/* Tell waker thread than we are running. */
-	uatomic_or(&wait->state, URCU_WAIT_RUNNING);
-
-	/*
-	 * Wait until waker thread lets us know it's ok to tear down
-	 * memory allocated for struct urcu_wait.
-	 */
-	for (i = 0; i < URCU_WAIT_ATTEMPTS; i++) {
-		if (uatomic_read(&wait->state) & URCU_WAIT_TEARDOWN)
+		if (i >= budget.sleep)
 			break;
-		caa_cpu_relax();
+		urcu_wait_budget_relax(&budget, i);
 	}
-	while (!(uatomic_read(&wait->state) & URCU_WAIT_TEARDOWN))
-		poll(NULL, 0, 10);
-	assert(uatomic_read(&wait->state) & URCU_WAIT_TEARDOWN);
+	/* Let the waker know it has to issue FUTEX_WAKE. */
+	if (uatomic_cmpxchg(&wait->state, URCU_WAIT_WAITING,
+			URCU_WAIT_SLEEPING) != URCU_WAIT_WAITING)
+		goto skip_futex_wait;
+	while (uatomic_read(&wait->state) == URCU_WAIT_SLEEPING)
+		futex_noasync(&wait->state, FUTEX_WAIT,
+			URCU_WAIT_SLEEPING, NULL, NULL, 0);
+skip_futex_wait:
+	urcu_wait_policy_record(policy, &budget, i);
 }
 
 static inline
@@ -35,6 +35,8 @@
 #include <string.h>
 #include <errno.h>
 #include <poll.h>
+#include <sched.h>
+#include <unistd.h>
 
 #include "urcu/wfcqueue.h"
 #include "urcu/map/urcu.h"
@@ -44,6 +46,12 @@
 
 #include "urcu-die.h"
 #include "urcu-wait.h"
+#include "urcu-poll.h"
+#include "urcu-membarrier.h"
+#include "urcu-scan.h"
+#include "urcu-stall.h"
+#include "urcu-gp-stats.h"
+#include "urcu-sdt.h"
 
 /* Do not #define _LGPL_SOURCE to ensure we can emit the wrapper symbols */
 #undef _LGPL_SOURCE
@@ -58,32 +66,34 @@
 #define KICK_READER_LOOPS 	10
 
 /*
- * Active attempts to check for reader Q.S. before calling futex().
+ * Active attempts to check for reader Q.S. before calling futex(), when
+ * no recent grace period tells better (see urcu-wait.h).
  */
 #define RCU_QS_ACTIVE_ATTEMPTS 100
 
-/*
- * RCU_MEMBARRIER is only possibly available on Linux.
- */
-#if defined(RCU_MEMBARRIER) && defined(__linux__)
-#include <urcu/syscall-compat.h>
-#endif
+/* enum rcu_wait_mode, set by rcu_set_wait_mode(). */
+static int rcu_wait_mode;
 
-/* If the headers do not support SYS_membarrier, fall back on RCU_MB */
-#ifdef SYS_membarrier
-# define membarrier(...)		syscall(SYS_membarrier, __VA_ARGS__)
-#else
-# define membarrier(...)		-ENOSYS
-#endif
+/* Set by rcu_set_stall_detector(), for the grace periods of all domains. */
+static struct urcu_stall_detector rcu_stall = URCU_STALL_DETECTOR_INIT;
+
+/* Set by rcu_set_reader_boost(), for the grace periods of all domains. */
+static struct urcu_boost rcu_boost = URCU_BOOST_INIT;
 
-#define MEMBARRIER_EXPEDITED		(1 << 0)
-#define MEMBARRIER_DELAYED		(1 << 1)
-#define MEMBARRIER_QUERY		(1 << 16)
+/* Grace periods of all domains, returned by rcu_get_gp_stats(). */
+static struct rcu_gp_stats rcu_stats;
 
 #ifdef RCU_MEMBARRIER
 static int init_done;
 int rcu_has_sys_membarrier;
 
+/*
+ * Command used by smp_mb_master() when rcu_has_sys_membarrier is set.
+ * Written once by rcu_init().
+ */
+static int rcu_membarrier_cmd;
+static enum rcu_membarrier_mode rcu_membarrier_mode = RCU_MEMBARRIER_MODE_NONE;
+
 void __attribute__((constructor)) rcu_init(void);
 #endif
 
@@ -96,37 +106,225 @@ void rcu_init(void)
 #ifdef RCU_SIGNAL
 static int init_done;
 
+/*
+ * Number of readers which have not executed the signal handler sent by
+ * the ongoing force_mb_all_readers() yet. The last of them wakes up
+ * force_mb_all_readers() if it waits on rcu_mb_futex.
+ */
+static int32_t rcu_mb_pending;
+static int32_t rcu_mb_futex;
+
+/*
+ * Delay before sending the signal again to readers which did not
+ * acknowledge it.
+ */
+#define RCU_MB_RESEND_DELAY_MS	1
+
 void __attribute__((constructor)) rcu_init(void);
 void __attribute__((destructor)) rcu_exit(void);
 #endif
 
-static pthread_mutex_t rcu_gp_lock = PTHREAD_MUTEX_INITIALIZER;
 struct rcu_gp rcu_gp = { .ctr = RCU_GP_COUNT };
 
+/* Checked by the read-side inlined into non-LGPL code. */
+const unsigned int rcu_reader_abi = RCU_READER_ABI;
+
+/*
+ * State of an RCU domain shared across processes, placed in a shared
+ * memory segment by rcu_domain_shared_init(). Reader slots are used by
+ * rcu_domain_register_thread() rather than allocated, since the
+ * registry cannot link the readers of several processes.
+ *
+ * Processes may terminate at any time. Its locks are robust: a process
+ * taking a lock whose owner terminated makes it consistent again, and
+ * resets the futex if it is the grace period lock. The slot of a reader
+ * whose process terminated is reclaimed, quiescent, when found with the
+ * registry lock held: when a grace period starts, every
+ * RCU_SHM_REAP_MS while it sleeps waiting for readers, and when a
+ * registration finds no free slot.
+ */
+#define RCU_DOMAIN_SHM_MAGIC	0x52435553U	/* "RCUS" */
+#define RCU_SHM_REAP_MS		100
+
+struct rcu_domain_shm_reader {
+	struct rcu_reader reader;
+	/* Protected by registry_lock. */
+	int used;
+	pid_t pid;
+};
+
+struct rcu_domain_shm {
+	struct rcu_gp gp;
+	uint32_t magic;
+	unsigned int max_readers;
+	/* Same as those of struct rcu_domain_impl, process-shared. */
+	pthread_mutex_t gp_lock;
+	pthread_mutex_t registry_lock;
+	struct rcu_domain_shm_reader readers[];
+};
+
+/*
+ * Update-side state of an RCU domain. The default domain, used by
+ * synchronize_rcu() and the TLS reader of each registered thread, uses
+ * the global rcu_gp.
+ */
+struct rcu_domain_impl {
+	struct rcu_domain parent;
+	pthread_mutex_t gp_lock;
+	/*
+	 * registry_lock ensures mutual exclusion between threads
+	 * registering and unregistering themselves to/from the registry,
+	 * and with the grace period reading that registry. However, the
+	 * grace period does not hold it while waiting for readers, so
+	 * registration does not wait for the end of a grace period.
+	 * registry_lock nests inside gp_lock.
+	 */
+	pthread_mutex_t registry_lock;
+	/* Registered readers. Protected by registry_lock. */
+	struct cds_list_head registry;
+	/*
+	 * Incremented on each change of the registry, which tells the
+	 * parallel scan of the readers (see urcu-scan.h) that its copy
+	 * is stale. Protected by registry_lock.
+	 */
+	unsigned long registry_gen;
+	/*
+	 * Queue keeping threads awaiting to wait for a grace period.
+	 * Contains struct gp_waiters_thread objects.
+	 */
+	struct urcu_wait_queue gp_waiters;
+	/*
+	 * Grace period sequence number, used by the grace period
+	 * polling API. Written to only by writer with gp_lock held.
+	 */
+	unsigned long gp_seq;
+	/*
+	 * Number of synchronize_rcu_expedited() callers currently
+	 * waiting for a grace period. While non-zero, wait_for_readers()
+	 * busy-waits and kicks readers rather than sleeping on the futex.
+	 */
+	int gp_expedited;
+	/*
+	 * How long recent grace periods waited for readers, and threads
+	 * waited for grace periods started by others.
+	 */
+	struct urcu_wait_policy gp_wait_policy;
+	struct urcu_wait_policy waiters_policy;
+	/* call_rcu thread of the domain, created on first use. */
+	struct call_rcu_data *crdp;
+	/* Grace period state of domains other than the default one. */
+	struct rcu_gp gp;
+	/*
+	 * Shared memory state of a domain shared across processes, or
+	 * NULL. Its locks are used rather than gp_lock and
+	 * registry_lock, and each grace period rebuilds the registry
+	 * from the reader slots in use.
+	 */
+	struct rcu_domain_shm *shm;
+	/* Number of reader slots of shm used through this handle. */
+	unsigned long nr_shm_readers;
+	/*
+	 * Incremented before and after a reader context moves a
+	 * read-side critical section between itself and a thread (see
+	 * rcu_context_attach()). Default domain only.
+	 */
+	unsigned long migrate_seq;
+};
+
+static struct rcu_domain_impl rcu_default_domain = {
+	.parent.gp = &rcu_gp,
+	.gp_lock = PTHREAD_MUTEX_INITIALIZER,
+	.registry_lock = PTHREAD_MUTEX_INITIALIZER,
+	.registry = CDS_LIST_HEAD_INIT(rcu_default_domain.registry),
+	.gp_waiters = URCU_WAIT_QUEUE_HEAD_INIT(rcu_default_domain.gp_waiters),
+};
+
+/* Used by the grace period polling API. */
+#define rcu_gp_seq	(rcu_default_domain.gp_seq)
+
+#ifdef CONFIG_RCU_NUMA_GP_CTR
+struct rcu_gp_node rcu_gp_node[RCU_GP_MAX_NODES];
+
+/*
+ * Number of rcu_gp_node copies which may be read by registered readers.
+ * Protected by the registry_lock of the default domain.
+ */
+static unsigned int rcu_gp_nr_nodes;
+
+/*
+ * Return the NUMA node the caller runs on, folded into the range of
+ * rcu_gp_node copies, or 0 if unknown.
+ */
+static unsigned int rcu_gp_current_node(void)
+{
+#ifdef SYS_getcpu
+	unsigned int cpu, node;
+
+	if (!syscall(SYS_getcpu, &cpu, &node, NULL))
+		return node % RCU_GP_MAX_NODES;
+#endif
+	return 0;
+}
+#endif /* #ifdef CONFIG_RCU_NUMA_GP_CTR */
+
+/*
+ * Select the copy of rcu_gp.ctr read by "reader", registered by the
+ * current thread. Called with the registry_lock of the default domain
+ * held.
+ */
+static void rcu_reader_set_gp_ctr(struct rcu_reader *reader)
+{
+#ifdef CONFIG_RCU_NUMA_GP_CTR
+	unsigned int node = rcu_gp_current_node();
+
+	/* Bring the copies of nodes used for the first time up to date. */
+	for (; rcu_gp_nr_nodes <= node; rcu_gp_nr_nodes++)
+		CMM_STORE_SHARED(rcu_gp_node[rcu_gp_nr_nodes].ctr, rcu_gp.ctr);
+	reader->gp_ctr = &rcu_gp_node[node].ctr;
+#endif
+}
+
+/*
+ * Set the grace period counter of "domain" to "ctr". Called with the
+ * gp_lock and registry_lock of the domain held.
+ */
+static void rcu_gp_ctr_set(struct rcu_domain_impl *domain, unsigned long ctr)
+{
+	CMM_STORE_SHARED(domain->parent.gp->ctr, ctr);
+#ifdef CONFIG_RCU_NUMA_GP_CTR
+	if (domain == &rcu_default_domain) {
+		unsigned int node;
+
+		for (node = 0; node < rcu_gp_nr_nodes; node++)
+			CMM_STORE_SHARED(rcu_gp_node[node].ctr, ctr);
+	}
+#endif
+}
+
 /*
  * Written to only by each individual reader. Read by both the reader and the
  * writers.
  */
 DEFINE_URCU_TLS(struct rcu_reader, rcu_reader);
 
-static CDS_LIST_HEAD(registry);
-
 /*
- * Queue keeping threads awaiting to wait for a grace period. Contains
- * struct gp_waiters_thread objects.
+ * Returns 1 if the previous owner of the mutex, a robust mutex of a
+ * shared domain, terminated while holding it, else 0.
  */
-static DEFINE_URCU_WAIT_QUEUE(gp_waiters);
-
-static void mutex_lock(pthread_mutex_t *mutex)
+static int __mutex_lock(pthread_mutex_t *mutex)
 {
 	int ret;
 
 #ifndef DISTRUST_SIGNALS_EXTREME
 	ret = pthread_mutex_lock(mutex);
+	if (ret == EOWNERDEAD)
+		goto owner_dead;
 	if (ret)
 		urcu_die(ret);
 #else /* #ifndef DISTRUST_SIGNALS_EXTREME */
 	while ((ret = pthread_mutex_trylock(mutex)) != 0) {
+		if (ret == EOWNERDEAD)
+			goto owner_dead;
 		if (ret != EBUSY && ret != EINTR)
 			urcu_die(ret);
 		if (CMM_LOAD_SHARED(URCU_TLS(rcu_reader).need_mb)) {
@@ -137,6 +335,18 @@ static void mutex_lock(pthread_mutex_t *mutex)
 		poll(NULL,0,10);
 	}
 #endif /* #else #ifndef DISTRUST_SIGNALS_EXTREME */
+	return 0;
+
+owner_dead:
+	ret = pthread_mutex_consistent(mutex);
+	if (ret)
+		urcu_die(ret);
+	return 1;
+}
+
+static void mutex_lock(pthread_mutex_t *mutex)
+{
+	(void) __mutex_lock(mutex);
 }
 
 static void mutex_unlock(pthread_mutex_t *mutex)
@@ -148,144 +358,481 @@ static void mutex_unlock(pthread_mutex_t *mutex)
 		urcu_die(ret);
 }
 
+static pthread_mutex_t *domain_gp_lock(struct rcu_domain_impl *domain)
+{
+	return domain->shm ? &domain->shm->gp_lock : &domain->gp_lock;
+}
+
+static pthread_mutex_t *domain_registry_lock(struct rcu_domain_impl *domain)
+{
+	return domain->shm ? &domain->shm->registry_lock
+			: &domain->registry_lock;
+}
+
+/*
+ * Reclaim the reader slots of the processes which terminated while
+ * registered to a shared domain, in or out of a read-side critical
+ * section. Called with the registry_lock of the domain held. A grace
+ * period may still have the slots linked: it finds them quiescent.
+ */
+static void domain_shm_reap(struct rcu_domain_impl *domain)
+{
+	struct rcu_domain_shm *shm = domain->shm;
+	pid_t self = getpid();
+	unsigned int i;
+
+	for (i = 0; i < shm->max_readers; i++) {
+		struct rcu_domain_shm_reader *slot = &shm->readers[i];
+
+		if (!slot->used || slot->pid == self)
+			continue;
+		if (kill(slot->pid, 0) == 0 || errno != ESRCH)
+			continue;
+		CMM_STORE_SHARED(slot->reader.ctr, 0);
+		slot->used = 0;
+	}
+}
+
+/*
+ * Link the reader slots in use of a shared domain into the registry of
+ * the grace period. Called with the gp_lock and registry_lock of the
+ * domain held: the slots are only linked by one grace period at a time.
+ */
+static void domain_shm_registry(struct rcu_domain_impl *domain)
+{
+	struct rcu_domain_shm *shm = domain->shm;
+	unsigned int i;
+
+	domain_shm_reap(domain);
+	CDS_INIT_LIST_HEAD(&domain->registry);
+	for (i = 0; i < shm->max_readers; i++) {
+		if (shm->readers[i].used)
+			cds_list_add(&shm->readers[i].reader.node,
+					&domain->registry);
+	}
+}
+
 #ifdef RCU_MEMBARRIER
-static void smp_mb_master(int group)
+/*
+ * Readers of shared domains issue full memory barriers (see
+ * smp_mb_slave_domain()).
+ */
+static void smp_mb_master(struct rcu_domain_impl *domain, int group)
 {
-	if (caa_likely(rcu_has_sys_membarrier))
-		(void) membarrier(MEMBARRIER_EXPEDITED);
+	if (caa_likely(rcu_has_sys_membarrier) && !domain->shm)
+		(void) membarrier(rcu_membarrier_cmd, 0);
 	else
 		cmm_smp_mb();
 }
 #endif
 
 #ifdef RCU_MB
-static void smp_mb_master(int group)
+static void smp_mb_master(struct rcu_domain_impl *domain, int group)
 {
 	cmm_smp_mb();
 }
 #endif
 
 #ifdef RCU_SIGNAL
+/*
+ * Wait for rcu_mb_pending to reach zero, for at most
+ * RCU_MB_RESEND_DELAY_MS.
+ */
+static void wait_mb_pending(void)
+{
+#ifdef CONFIG_RCU_HAVE_FUTEX
+	const struct timespec timeout = {
+		.tv_sec = 0,
+		.tv_nsec = RCU_MB_RESEND_DELAY_MS * 1000000L,
+	};
+
+	uatomic_set(&rcu_mb_futex, -1);
+	/* Write futex before read rcu_mb_pending */
+	cmm_smp_mb();
+	if (uatomic_read(&rcu_mb_pending))
+		(void) futex_async(&rcu_mb_futex, FUTEX_WAIT, -1,
+				&timeout, NULL, 0);
+	uatomic_set(&rcu_mb_futex, 0);
+#else
+	(void) poll(NULL, 0, RCU_MB_RESEND_DELAY_MS);
+#endif
+}
+
 static void force_mb_all_readers(void)
 {
 	struct rcu_reader *index;
+	pthread_t self = pthread_self();
+	unsigned int wait_loops = 0;
+	int32_t nr_readers = 0;
 
 	/*
 	 * Ask for each threads to execute a cmm_smp_mb() so we can consider the
 	 * compiler barriers around rcu read lock as real memory barriers.
 	 */
-	if (cds_list_empty(&registry))
+	if (cds_list_empty(&rcu_default_domain.registry))
 		return;
+	/*
+	 * Readers which look quiescent cannot be skipped: their next
+	 * rcu_read_lock() only issues a compiler barrier. The calling
+	 * thread, if registered, is skipped: its memory barriers are
+	 * the ones issued here.
+	 */
+	cds_list_for_each_entry(index, &rcu_default_domain.registry, node) {
+		if (!index->context && !pthread_equal(index->tid, self))
+			nr_readers++;
+	}
+	uatomic_set(&rcu_mb_pending, nr_readers);
+	/* Order prior memory accesses before the signal handlers. */
+	cmm_smp_mb();
 	/*
 	 * pthread_kill has a cmm_smp_mb(). But beware, we assume it performs
 	 * a cache flush on architectures with non-coherent cache. Let's play
 	 * safe and don't assume anything : we use cmm_smp_mc() to make sure the
 	 * cache flush is enforced.
 	 */
-	cds_list_for_each_entry(index, &registry, node) {
+	cds_list_for_each_entry(index, &rcu_default_domain.registry, node) {
+		/*
+		 * Reader contexts have no thread: the thread they are
+		 * attached to, if any, is registered too.
+		 */
+		if (index->context || pthread_equal(index->tid, self))
+			continue;
 		CMM_STORE_SHARED(index->need_mb, 1);
 		pthread_kill(index->tid, SIGRCU);
 	}
 	/*
 	 * Wait for sighandler (and thus mb()) to execute on every thread.
+	 * Each handler decrements rcu_mb_pending: spin for a while, then
+	 * sleep until the last handler wakes us up.
 	 *
-	 * Note that the pthread_kill() will never be executed on systems
-	 * that correctly deliver signals in a timely manner.  However, it
-	 * is not uncommon for kernels to have bugs that can result in
-	 * lost or unduly delayed signals.
+	 * Note that the pthread_kill() will never be executed again on
+	 * systems that correctly deliver signals in a timely manner.
+	 * However, it is not uncommon for kernels to have bugs that can
+	 * result in lost or unduly delayed signals.
 	 *
 	 * If you are seeing the below pthread_kill() executing much at
 	 * all, we suggest testing the underlying kernel and filing the
 	 * relevant bug report.  For Linux kernels, we recommend getting
 	 * the Linux Test Project (LTP).
 	 */
-	cds_list_for_each_entry(index, &registry, node) {
-		while (CMM_LOAD_SHARED(index->need_mb)) {
-			pthread_kill(index->tid, SIGRCU);
-			poll(NULL, 0, 1);
+	while (uatomic_read(&rcu_mb_pending)) {
+		if (wait_loops < RCU_QS_ACTIVE_ATTEMPTS) {
+			wait_loops++;
+			caa_cpu_relax();
+			continue;
+		}
+		wait_mb_pending();
+		if (!uatomic_read(&rcu_mb_pending))
+			break;
+		cds_list_for_each_entry(index, &rcu_default_domain.registry,
+				node) {
+			if (CMM_LOAD_SHARED(index->need_mb))
+				pthread_kill(index->tid, SIGRCU);
 		}
 	}
-	cmm_smp_mb();	/* read ->need_mb before ending the barrier */
+	cmm_smp_mb();	/* read rcu_mb_pending before ending the barrier */
 }
 
-static void smp_mb_master(int group)
+/*
+ * Readers of domains other than the default one issue full memory
+ * barriers (see smp_mb_slave_domain()).
+ */
+static void smp_mb_master(struct rcu_domain_impl *domain, int group)
 {
-	force_mb_all_readers();
+	if (domain == &rcu_default_domain)
+		force_mb_all_readers();
+	else
+		cmm_smp_mb();
 }
 #endif /* #ifdef RCU_SIGNAL */
 
 /*
- * synchronize_rcu() waiting. Single thread.
+ * synchronize_rcu() waiting. Single thread. Wakes up in time for the
+ * next report of the stall detector, if enabled. The caller issues the
+ * memory barrier ordering the reads of reader_gp before the read of
+ * the futex.
  */
-static void wait_gp(void)
+static void wait_gp(struct rcu_domain_impl *domain,
+		struct urcu_stall_gp *stall)
 {
-	/* Read reader_gp before read futex */
-	smp_mb_master(RCU_MB_GROUP);
-	if (uatomic_read(&rcu_gp.futex) == -1)
-		futex_async(&rcu_gp.futex, FUTEX_WAIT, -1,
-		      NULL, NULL, 0);
+	struct rcu_gp *gp = domain->parent.gp;
+	struct timespec timeout;
+	const struct timespec *ts;
+
+	/*
+	 * Read futex before read gp_expedited (the expedited side
+	 * writes them in the opposite order).
+	 */
+	if (uatomic_read(&gp->futex) == -1
+			&& !uatomic_read(&domain->gp_expedited)) {
+		uatomic_inc(&rcu_stats.nr_sleeps);
+		ts = urcu_stall_timeout(stall, &timeout);
+		/* Terminated processes never wake up a shared domain. */
+		if (domain->shm && (!ts || ts->tv_sec
+				|| ts->tv_nsec > RCU_SHM_REAP_MS * 1000000L)) {
+			timeout.tv_sec = 0;
+			timeout.tv_nsec = RCU_SHM_REAP_MS * 1000000L;
+			ts = &timeout;
+		}
+		futex_async(&gp->futex, FUTEX_WAIT, -1, ts, NULL, 0);
+		/*
+		 * If no reader woke us up (timeout), reset the futex
+		 * as they would have, since wait_for_readers()
+		 * decrements it before sleeping again.
+		 */
+		(void) uatomic_cmpxchg(&gp->futex, -1, 0);
+	}
+}
+
+/*
+ * Expedited synchronize_rcu() waiting. Rather than sleeping on the
+ * futex, periodically force a memory barrier on all readers, and yield
+ * the CPU (see wait_for_readers()) so preempted readers can make
+ * progress.
+ */
+static void kick_readers(struct rcu_domain_impl *domain,
+		unsigned int *kick_loops)
+{
+	if (++(*kick_loops) >= KICK_READER_LOOPS) {
+		smp_mb_master(domain, RCU_MB_GROUP);
+		*kick_loops = 0;
+	}
+}
+
+/*
+ * Wait before the next scan of the readers, without holding the
+ * registry lock.
+ */
+static void wait_readers_step(struct rcu_domain_impl *domain,
+		struct urcu_wait_budget *budget, unsigned int wait_loops,
+		int expedited, struct urcu_stall_gp *stall)
+{
+	int sleep = wait_loops >= budget->sleep && !expedited;
+
+	/*
+	 * Read reader_gp before read futex. The signal flavor walks the
+	 * registry to send its memory barriers: issue them while the
+	 * registry lock is still held.
+	 */
+	if (sleep)
+		smp_mb_master(domain, RCU_MB_GROUP);
+	/* Temporarily unlock the registry lock. */
+	mutex_unlock(domain_registry_lock(domain));
+	if (wait_loops >= budget->sleep) {
+		if (expedited)
+			(void) sched_yield();
+		else
+			wait_gp(domain, stall);
+	} else {
+		urcu_wait_budget_relax(budget, wait_loops);
+	}
+	/* Re-lock the registry lock before the next loop. */
+	mutex_lock(domain_registry_lock(domain));
+	if (sleep && domain->shm)
+		domain_shm_reap(domain);
 }
 
-static void wait_for_readers(struct cds_list_head *input_readers,
+/*
+ * Helper threads scanning the readers of the grace periods of all
+ * domains, one grace period at a time.
+ */
+static struct urcu_scan rcu_scan = URCU_SCAN_INIT;
+
+static enum rcu_state scan_reader_state(void *arg, struct rcu_reader *reader)
+{
+	return rcu_gp_reader_state(arg, &reader->ctr);
+}
+
+/*
+ * A reader context moving a read-side critical section to or from a
+ * thread may have been seen quiescent both before and after the move.
+ * If one moved since "*migrate_seq" was read, move the readers seen
+ * quiescent back into "input_readers" to scan them again, and return 1.
+ */
+static int rescan_migrated_readers(struct rcu_domain_impl *domain,
+		unsigned long *migrate_seq,
+		struct cds_list_head *input_readers,
+		struct cds_list_head *qsreaders)
+{
+	unsigned long seq;
+
+	/* Read reader states before migrate_seq. */
+	cmm_smp_mb();
+	seq = uatomic_read(&domain->migrate_seq);
+	if ((seq == *migrate_seq && !(seq & 1)) || cds_list_empty(qsreaders))
+		return 0;
+	*migrate_seq = seq;
+	cds_list_splice(qsreaders, input_readers);
+	CDS_INIT_LIST_HEAD(qsreaders);
+	/* The copy of the parallel scan, if any, is stale. */
+	domain->registry_gen++;
+	/* A move is in progress: let it complete. */
+	if (seq & 1)
+		caa_cpu_relax();
+	/* Read migrate_seq before reader states. */
+	cmm_smp_mb();
+	return 1;
+}
+
+/*
+ * Report the readers of "input_readers", which the grace period is
+ * still waiting for, if the stall detector is due.
+ */
+static void report_stalled_readers(struct urcu_stall_gp *stall,
+		struct cds_list_head *input_readers)
+{
+	struct rcu_reader *index;
+	unsigned long now;
+
+	if (caa_likely(!urcu_stall_gp_due(stall, &now)))
+		return;
+	cds_list_for_each_entry(index, input_readers, node) {
+		unsigned long ctr = CMM_LOAD_SHARED(index->ctr);
+
+		/* Reader contexts have a zero tid. */
+		urcu_stall_report(stall, now, index->tid, ctr,
+				ctr & RCU_GP_CTR_NEST_MASK,
+				&index->stall_ctr, &index->stall_since);
+	}
+}
+
+/*
+ * Boost the threads of the readers of "input_readers", which the grace
+ * period is still waiting for, if reader boosting is due. Readers of
+ * shared domains may belong to other processes: they are left alone.
+ */
+static void boost_stalled_readers(struct rcu_domain_impl *domain,
+		struct urcu_stall_gp *stall,
+		struct cds_list_head *input_readers)
+{
+	struct rcu_reader *index;
+
+	if (caa_likely(!urcu_boost_gp_due(stall)) || domain->shm)
+		return;
+	cds_list_for_each_entry(index, input_readers, node) {
+		/* Reader contexts are not bound to a thread. */
+		if (index->context)
+			continue;
+		urcu_boost_reader(stall, index->tid, &index->boosted,
+				&index->boost_policy, &index->boost_param);
+	}
+}
+
+/*
+ * Restore the scheduling of the boosted readers of "readers", which no
+ * longer hold the grace period.
+ */
+static void restore_boosted_readers(struct urcu_stall_gp *stall,
+		struct cds_list_head *readers)
+{
+	struct rcu_reader *index;
+
+	cds_list_for_each_entry(index, readers, node) {
+		if (!stall->nr_boosted)
+			return;
+		if (urcu_boost_restore(index->tid, &index->boosted,
+				&index->boost_policy, &index->boost_param))
+			stall->nr_boosted--;
+	}
+}
+
+static void wait_for_readers(struct rcu_domain_impl *domain,
+			struct cds_list_head *input_readers,
 			struct cds_list_head *cur_snap_readers,
 			struct cds_list_head *qsreaders)
 {
-	unsigned int wait_loops = 0;
+	struct rcu_gp *gp = domain->parent.gp;
+	unsigned int wait_loops = 0, kick_loops = 0;
+	unsigned long migrate_seq;
+	size_t scanned, nr_scanned = 0;
+	unsigned long scan_token = 0;
 	struct rcu_reader *index, *tmp;
+	struct urcu_wait_budget budget;
+	struct urcu_stall_gp stall;
 #ifdef HAS_INCOHERENT_CACHES
 	unsigned int wait_gp_loops = 0;
 #endif /* HAS_INCOHERENT_CACHES */
 
+	urcu_wait_budget_init(&budget, &domain->gp_wait_policy,
+			CMM_LOAD_SHARED(rcu_wait_mode), RCU_QS_ACTIVE_ATTEMPTS);
+	urcu_stall_gp_init(&stall, &rcu_stall, &rcu_boost);
+	urcu_probe1(wait_readers_begin, gp->ctr);
+
+	migrate_seq = uatomic_read(&domain->migrate_seq);
+	/* Read migrate_seq before reader states. */
+	cmm_smp_mb();
+
 	/*
 	 * Wait for each thread URCU_TLS(rcu_reader).ctr to either
 	 * indicate quiescence (not nested), or observe the current
 	 * rcu_gp.ctr value.
 	 */
 	for (;;) {
-		if (wait_loops < RCU_QS_ACTIVE_ATTEMPTS)
+		int expedited = uatomic_read(&domain->gp_expedited);
+
+		if (wait_loops < budget.sleep)
 			wait_loops++;
-		if (wait_loops >= RCU_QS_ACTIVE_ATTEMPTS) {
-			uatomic_dec(&rcu_gp.futex);
+		if (wait_loops >= budget.sleep && !expedited) {
+			uatomic_dec(&gp->futex);
 			/* Write futex before read reader_gp */
-			smp_mb_master(RCU_MB_GROUP);
+			smp_mb_master(domain, RCU_MB_GROUP);
 		}
 
-		cds_list_for_each_entry_safe(index, tmp, input_readers, node) {
-			switch (rcu_reader_state(&index->ctr)) {
-			case RCU_READER_ACTIVE_CURRENT:
-				if (cur_snap_readers) {
-					cds_list_move(&index->node,
-						cur_snap_readers);
+		scanned = urcu_scan_readers(&rcu_scan, input_readers,
+				cur_snap_readers, qsreaders,
+				scan_reader_state, gp, &scan_token,
+				domain->registry_gen);
+		if (!scanned) {
+			cds_list_for_each_entry_safe(index, tmp,
+					input_readers, node) {
+				scanned++;
+				switch (rcu_gp_reader_state(gp, &index->ctr)) {
+				case RCU_READER_ACTIVE_CURRENT:
+					if (cur_snap_readers) {
+						cds_list_move(&index->node,
+							cur_snap_readers);
+						break;
+					}
+					/* Fall-through */
+				case RCU_READER_INACTIVE:
+					cds_list_move(&index->node, qsreaders);
+					break;
+				case RCU_READER_ACTIVE_OLD:
+					/*
+					 * Old snapshot. Leaving node in
+					 * input_readers will make us busy-loop
+					 * until the snapshot becomes current or
+					 * the reader becomes inactive.
+					 */
 					break;
 				}
-				/* Fall-through */
-			case RCU_READER_INACTIVE:
-				cds_list_move(&index->node, qsreaders);
-				break;
-			case RCU_READER_ACTIVE_OLD:
-				/*
-				 * Old snapshot. Leaving node in
-				 * input_readers will make us busy-loop
-				 * until the snapshot becomes current or
-				 * the reader becomes inactive.
-				 */
-				break;
 			}
 		}
+		nr_scanned += scanned;
+		if (caa_unlikely(stall.nr_boosted)) {
+			restore_boosted_readers(&stall, qsreaders);
+			if (cur_snap_readers)
+				restore_boosted_readers(&stall,
+						cur_snap_readers);
+		}
 
 #ifndef HAS_INCOHERENT_CACHES
 		if (cds_list_empty(input_readers)) {
-			if (wait_loops >= RCU_QS_ACTIVE_ATTEMPTS) {
+			if (wait_loops >= budget.sleep) {
 				/* Read reader_gp before write futex */
-				smp_mb_master(RCU_MB_GROUP);
-				uatomic_set(&rcu_gp.futex, 0);
+				smp_mb_master(domain, RCU_MB_GROUP);
+				uatomic_set(&gp->futex, 0);
 			}
-			break;
+			if (!rescan_migrated_readers(domain, &migrate_seq,
+					input_readers, qsreaders))
+				break;
 		} else {
-			if (wait_loops >= RCU_QS_ACTIVE_ATTEMPTS)
-				wait_gp();
-			else
-				caa_cpu_relax();
+			report_stalled_readers(&stall, input_readers);
+			boost_stalled_readers(domain, &stall, input_readers);
+			if (wait_loops >= budget.sleep && expedited)
+				kick_readers(domain, &kick_loops);
+			wait_readers_step(domain, &budget, wait_loops,
+					expedited, &stall);
 		}
 #else /* #ifndef HAS_INCOHERENT_CACHES */
 		/*
@@ -294,35 +841,57 @@ static void wait_for_readers(struct cds_list_head *input_readers,
 		 * for too long.
 		 */
 		if (cds_list_empty(input_readers)) {
-			if (wait_loops >= RCU_QS_ACTIVE_ATTEMPTS) {
+			if (wait_loops >= budget.sleep) {
 				/* Read reader_gp before write futex */
-				smp_mb_master(RCU_MB_GROUP);
-				uatomic_set(&rcu_gp.futex, 0);
+				smp_mb_master(domain, RCU_MB_GROUP);
+				uatomic_set(&gp->futex, 0);
 			}
-			break;
+			if (!rescan_migrated_readers(domain, &migrate_seq,
+					input_readers, qsreaders))
+				break;
 		} else {
+			report_stalled_readers(&stall, input_readers);
+			boost_stalled_readers(domain, &stall, input_readers);
 			if (wait_gp_loops == KICK_READER_LOOPS) {
-				smp_mb_master(RCU_MB_GROUP);
+				smp_mb_master(domain, RCU_MB_GROUP);
 				wait_gp_loops = 0;
 			}
-			if (wait_loops >= RCU_QS_ACTIVE_ATTEMPTS) {
-				wait_gp();
-				wait_gp_loops++;
-			} else {
-				caa_cpu_relax();
+			if (wait_loops >= budget.sleep) {
+				if (expedited)
+					kick_readers(domain, &kick_loops);
+				else
+					wait_gp_loops++;
 			}
+			wait_readers_step(domain, &budget, wait_loops,
+					expedited, &stall);
 		}
 #endif /* #else #ifndef HAS_INCOHERENT_CACHES */
 	}
+	urcu_gp_stats_add(&rcu_stats.nr_readers_scanned, nr_scanned);
+	urcu_probe2(wait_readers_end, gp->ctr, nr_scanned);
+	urcu_wait_policy_record(&domain->gp_wait_policy, &budget, wait_loops);
 }
 
-void synchronize_rcu(void)
+/*
+ * On architectures with 64-bit long, the upper half of rcu_gp.ctr is a
+ * grace period sequence number which cannot overflow while a reader is
+ * delayed between its load of rcu_gp.ctr and its store to its own
+ * counter: a single pass waiting for readers to observe the new
+ * sequence or be quiescent is enough. Smaller architectures only have
+ * room for a parity bit, and need two passes around the parity switch.
+ */
+static void domain_synchronize(struct rcu_domain_impl *domain)
 {
+#if (CAA_BITS_PER_LONG < 64)
 	CDS_LIST_HEAD(cur_snap_readers);
+#endif
 	CDS_LIST_HEAD(qsreaders);
 	DEFINE_URCU_WAIT_NODE(wait, URCU_WAIT_WAITING);
 	struct urcu_waiters waiters;
+	struct rcu_gp *gp = domain->parent.gp;
+	unsigned long start_us = urcu_gp_stats_now_us();
 
+	urcu_probe1(synchronize_rcu_begin, domain);
 	/*
 	 * Add ourself to gp_waiters queue of threads awaiting to wait
 	 * for a grace period. Proceed to perform the grace period only
@@ -331,36 +900,54 @@ void synchronize_rcu(void)
 	 * orders prior memory accesses of threads put into the wait
 	 * queue before their insertion into the wait queue.
 	 */
-	if (urcu_wait_add(&gp_waiters, &wait) != 0) {
+	if (urcu_wait_add(&domain->gp_waiters, &wait) != 0) {
 		/* Not first in queue: will be awakened by another thread. */
-		urcu_adaptative_busy_wait(&wait);
+		urcu_adaptative_busy_wait(&wait, &domain->waiters_policy,
+				CMM_LOAD_SHARED(rcu_wait_mode));
 		/* Order following memory accesses after grace period. */
 		cmm_smp_mb();
+		uatomic_inc(&rcu_stats.nr_piggyback);
+		urcu_gp_stats_latency(&rcu_stats, start_us);
+		urcu_probe2(synchronize_rcu_end, domain, 0);
 		return;
 	}
 	/* We won't need to wake ourself up */
 	urcu_wait_set_state(&wait, URCU_WAIT_RUNNING);
 
-	mutex_lock(&rcu_gp_lock);
+	/*
+	 * A process terminated during a grace period of a shared domain
+	 * may have left the futex decremented: reset it. The next grace
+	 * period flips the phase twice whatever it was left to.
+	 */
+	if (__mutex_lock(domain_gp_lock(domain)))
+		uatomic_set(&domain->parent.gp->futex, 0);
 
 	/*
 	 * Move all waiters into our local queue.
 	 */
-	urcu_move_waiters(&waiters, &gp_waiters);
+	urcu_move_waiters(&waiters, &domain->gp_waiters);
+
+	urcu_gp_seq_start(&domain->gp_seq);
 
-	if (cds_list_empty(&registry))
+	mutex_lock(domain_registry_lock(domain));
+
+	if (domain->shm)
+		domain_shm_registry(domain);
+	if (cds_list_empty(&domain->registry))
 		goto out;
 
 	/* All threads should read qparity before accessing data structure
-	 * where new ptr points to. Must be done within rcu_gp_lock because it
-	 * iterates on reader threads.*/
+	 * where new ptr points to. Must be done within registry_lock because
+	 * it iterates on reader threads.*/
 	/* Write new ptr before changing the qparity */
-	smp_mb_master(RCU_MB_GROUP);
+	smp_mb_master(domain, RCU_MB_GROUP);
 
+#if (CAA_BITS_PER_LONG < 64)
 	/*
 	 * Wait for readers to observe original parity or be quiescent.
 	 */
-	wait_for_readers(&registry, &cur_snap_readers, &qsreaders);
+	wait_for_readers(domain, &domain->registry, &cur_snap_readers,
+			&qsreaders);
 
 	/*
 	 * Must finish waiting for quiescent state for original parity before
@@ -379,7 +966,11 @@ void synchronize_rcu(void)
 	cmm_smp_mb();
 
 	/* Switch parity: 0 -> 1, 1 -> 0 */
-	CMM_STORE_SHARED(rcu_gp.ctr, rcu_gp.ctr ^ RCU_GP_CTR_PHASE);
+	rcu_gp_ctr_set(domain, gp->ctr ^ RCU_GP_CTR_PHASE);
+#else /* !(CAA_BITS_PER_LONG < 64) */
+	/* Increment current G.P. */
+	rcu_gp_ctr_set(domain, gp->ctr + RCU_GP_CTR_PHASE);
+#endif /* !(CAA_BITS_PER_LONG < 64) */
 
 	/*
 	 * Must commit rcu_gp.ctr update to memory before waiting for quiescent
@@ -397,22 +988,31 @@ void synchronize_rcu(void)
 	 */
 	cmm_smp_mb();
 
+#if (CAA_BITS_PER_LONG < 64)
 	/*
 	 * Wait for readers to observe new parity or be quiescent.
 	 */
-	wait_for_readers(&cur_snap_readers, NULL, &qsreaders);
+	wait_for_readers(domain, &cur_snap_readers, NULL, &qsreaders);
+#else /* !(CAA_BITS_PER_LONG < 64) */
+	/*
+	 * Wait for readers to observe new count or be quiescent.
+	 */
+	wait_for_readers(domain, &domain->registry, NULL, &qsreaders);
+#endif /* !(CAA_BITS_PER_LONG < 64) */
 
 	/*
 	 * Put quiescent reader list back into registry.
 	 */
-	cds_list_splice(&qsreaders, &registry);
+	cds_list_splice(&qsreaders, &domain->registry);
 
 	/* Finish waiting for reader threads before letting the old ptr being
-	 * freed. Must be done within rcu_gp_lock because it iterates on reader
-	 * threads. */
-	smp_mb_master(RCU_MB_GROUP);
+	 * freed. Must be done within registry_lock because it iterates on
+	 * reader threads. */
+	smp_mb_master(domain, RCU_MB_GROUP);
 out:
-	mutex_unlock(&rcu_gp_lock);
+	mutex_unlock(domain_registry_lock(domain));
+	urcu_gp_seq_end(&domain->gp_seq);
+	mutex_unlock(domain_gp_lock(domain));
 
 	/*
 	 * Wakeup waiters only after we have completed the grace period
@@ -420,6 +1020,112 @@ out:
 	 * period have been issued.
 	 */
 	urcu_wake_all_waiters(&waiters);
+	uatomic_inc(&rcu_stats.nr_gp);
+	urcu_gp_stats_latency(&rcu_stats, start_us);
+	urcu_probe2(synchronize_rcu_end, domain, 1);
+}
+
+void synchronize_rcu(void)
+{
+	domain_synchronize(&rcu_default_domain);
+}
+
+/*
+ * Same as synchronize_rcu(), but never sleeps on the futex while
+ * waiting for readers: busy-wait, kicking the readers, until the
+ * grace period completes. Also expedites the grace period already in
+ * progress, if any, which this caller may batch with. Returns the time
+ * it took, in microseconds.
+ */
+unsigned long synchronize_rcu_expedited(void)
+{
+	unsigned long start_us = urcu_gp_stats_now_us();
+
+	uatomic_inc(&rcu_default_domain.gp_expedited);
+	/*
+	 * Write gp_expedited before read futex (the grace period side
+	 * reads them in the opposite order).
+	 */
+	cmm_smp_mb__after_uatomic_inc();
+	/* Wake up a grace period sleeping on the futex. */
+	wake_up_gp();
+	synchronize_rcu();
+	uatomic_dec(&rcu_default_domain.gp_expedited);
+	return urcu_gp_stats_now_us() - start_us;
+}
+
+int rcu_set_gp_scan_threads(unsigned int nr_threads)
+{
+	return urcu_scan_set_threads(&rcu_scan, nr_threads);
+}
+
+int rcu_set_wait_mode(enum rcu_wait_mode mode)
+{
+	if (!urcu_wait_mode_valid(mode))
+		return -EINVAL;
+	CMM_STORE_SHARED(rcu_wait_mode, mode);
+	return 0;
+}
+
+int rcu_set_stall_detector(unsigned long threshold_ms, rcu_stall_func func,
+		void *priv)
+{
+	return urcu_stall_set(&rcu_stall, threshold_ms, func, priv);
+}
+
+int rcu_set_reader_boost(unsigned long threshold_ms, int policy,
+		int priority)
+{
+	return urcu_boost_set(&rcu_boost, threshold_ms, policy, priority);
+}
+
+void rcu_get_gp_stats(struct rcu_gp_stats *stats)
+{
+	urcu_gp_stats_get(&rcu_stats, stats);
+}
+
+void rcu_reset_gp_stats(void)
+{
+	urcu_gp_stats_reset(&rcu_stats);
+}
+
+static void get_reader_info(struct rcu_reader_info *info,
+		struct rcu_reader *reader)
+{
+	unsigned long ctr = CMM_LOAD_SHARED(reader->ctr);
+
+	info->tid = reader->context ? 0 : reader->tid;
+	info->nesting = ctr & RCU_GP_CTR_NEST_MASK;
+	info->state = info->nesting ? RCU_READER_INFO_ACTIVE
+			: RCU_READER_INFO_QUIESCENT;
+	info->since_ns = 0;
+#ifdef CONFIG_RCU_READER_TIMESTAMP
+	if (info->nesting)
+		info->since_ns = CMM_LOAD_SHARED(reader->since_ns);
+#endif
+}
+
+/*
+ * Readers registered to the default domain. Holding gp_lock ensures no
+ * grace period has moved them off the registry, at the cost of waiting
+ * for the grace period in progress: a stalled reader delays the call.
+ */
+unsigned int rcu_get_readers(struct rcu_reader_info *readers,
+		unsigned int nr)
+{
+	struct rcu_reader *index;
+	unsigned int count = 0;
+
+	mutex_lock(&rcu_default_domain.gp_lock);
+	mutex_lock(&rcu_default_domain.registry_lock);
+	cds_list_for_each_entry(index, &rcu_default_domain.registry, node) {
+		if (count < nr)
+			get_reader_info(&readers[count], index);
+		count++;
+	}
+	mutex_unlock(&rcu_default_domain.registry_lock);
+	mutex_unlock(&rcu_default_domain.gp_lock);
+	return count;
 }
 
 /*
@@ -447,27 +1153,397 @@ void rcu_register_thread(void)
 	assert(URCU_TLS(rcu_reader).need_mb == 0);
 	assert(!(URCU_TLS(rcu_reader).ctr & RCU_GP_CTR_NEST_MASK));
 
-	mutex_lock(&rcu_gp_lock);
+	mutex_lock(&rcu_default_domain.registry_lock);
 	rcu_init();	/* In case gcc does not support constructor attribute */
-	cds_list_add(&URCU_TLS(rcu_reader).node, &registry);
-	mutex_unlock(&rcu_gp_lock);
+	rcu_reader_set_gp_ctr(&URCU_TLS(rcu_reader));
+	cds_list_add(&URCU_TLS(rcu_reader).node, &rcu_default_domain.registry);
+	rcu_default_domain.registry_gen++;
+	mutex_unlock(&rcu_default_domain.registry_lock);
 }
 
 void rcu_unregister_thread(void)
 {
-	mutex_lock(&rcu_gp_lock);
-	cds_list_del(&URCU_TLS(rcu_reader).node);
-	mutex_unlock(&rcu_gp_lock);
+	struct rcu_reader *reader = &URCU_TLS(rcu_reader);
+
+	mutex_lock(&rcu_default_domain.registry_lock);
+	(void) urcu_boost_restore(reader->tid, &reader->boosted,
+			&reader->boost_policy, &reader->boost_param);
+	cds_list_del(&reader->node);
+	rcu_default_domain.registry_gen++;
+	mutex_unlock(&rcu_default_domain.registry_lock);
+}
+
+/*
+ * Reader contexts, for M:N fiber schedulers.
+ */
+
+struct rcu_reader *rcu_context_create(void)
+{
+	struct rcu_reader *ctx;
+	int ret;
+
+	ret = posix_memalign((void **) &ctx, CAA_CACHE_LINE_SIZE,
+			sizeof(*ctx));
+	if (ret) {
+		errno = ret;
+		return NULL;
+	}
+	memset(ctx, 0, sizeof(*ctx));
+	ctx->context = 1;
+
+	mutex_lock(&rcu_default_domain.registry_lock);
+	rcu_init();	/* In case gcc does not support constructor attribute */
+	cds_list_add(&ctx->node, &rcu_default_domain.registry);
+	rcu_default_domain.registry_gen++;
+	mutex_unlock(&rcu_default_domain.registry_lock);
+	return ctx;
+}
+
+void rcu_context_destroy(struct rcu_reader *ctx)
+{
+	assert(!(ctx->ctr & RCU_GP_CTR_NEST_MASK));
+	mutex_lock(&rcu_default_domain.registry_lock);
+	cds_list_del(&ctx->node);
+	rcu_default_domain.registry_gen++;
+	mutex_unlock(&rcu_default_domain.registry_lock);
+	free(ctx);
+}
+
+/*
+ * Move the read-side critical section of "from" to "to", both owned by
+ * the calling thread. The critical section is visible to grace periods
+ * in "to" before it is removed from "from", and migrate_seq tells
+ * grace periods which may have missed it in both.
+ */
+static void rcu_context_move(struct rcu_reader *to, struct rcu_reader *from)
+{
+	unsigned long ctr = from->ctr;
+
+	assert(!(to->ctr & RCU_GP_CTR_NEST_MASK));
+	if (!(ctr & RCU_GP_CTR_NEST_MASK))
+		return;
+	uatomic_inc(&rcu_default_domain.migrate_seq);
+	cmm_smp_mb__after_uatomic_inc();
+#ifdef CONFIG_RCU_READER_TIMESTAMP
+	CMM_STORE_SHARED(to->since_ns, from->since_ns);
+#endif
+	CMM_STORE_SHARED(to->ctr, ctr);
+	cmm_smp_mb();
+	CMM_STORE_SHARED(from->ctr, 0);
+	cmm_smp_mb__before_uatomic_inc();
+	uatomic_inc(&rcu_default_domain.migrate_seq);
+}
+
+void rcu_context_attach(struct rcu_reader *ctx)
+{
+	rcu_context_move(&URCU_TLS(rcu_reader), ctx);
+}
+
+void rcu_context_detach(struct rcu_reader *ctx)
+{
+	rcu_context_move(ctx, &URCU_TLS(rcu_reader));
+}
+
+/*
+ * RCU domains.
+ */
+
+/* Implemented by urcu-call-rcu-impl.h, included below. */
+static struct call_rcu_data *get_domain_call_rcu_data(
+		struct call_rcu_data **crdpp,
+		void (*gp_sync)(void *arg),
+		void *gp_sync_arg);
+static void _call_rcu(struct rcu_head *head,
+		      void (*func)(struct rcu_head *head),
+		      struct call_rcu_data *crdp);
+
+struct rcu_domain *rcu_domain_create(void)
+{
+	struct rcu_domain_impl *domain;
+	int ret;
+
+	ret = posix_memalign((void **) &domain, CAA_CACHE_LINE_SIZE,
+			sizeof(*domain));
+	if (ret) {
+		errno = ret;
+		return NULL;
+	}
+	memset(domain, 0, sizeof(*domain));
+	domain->parent.gp = &domain->gp;
+	domain->gp.ctr = RCU_GP_COUNT;
+	ret = pthread_mutex_init(&domain->gp_lock, NULL);
+	if (ret)
+		urcu_die(ret);
+	ret = pthread_mutex_init(&domain->registry_lock, NULL);
+	if (ret)
+		urcu_die(ret);
+	CDS_INIT_LIST_HEAD(&domain->registry);
+	urcu_wait_queue_init(&domain->gp_waiters);
+	return &domain->parent;
+}
+
+size_t rcu_domain_shared_size(unsigned int max_readers)
+{
+	return sizeof(struct rcu_domain_shm)
+		+ max_readers * sizeof(struct rcu_domain_shm_reader);
+}
+
+static void shared_mutex_init(pthread_mutex_t *mutex)
+{
+	pthread_mutexattr_t attr;
+	int ret;
+
+	ret = pthread_mutexattr_init(&attr);
+	if (ret)
+		urcu_die(ret);
+	ret = pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+	if (!ret)
+		ret = pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+	if (!ret)
+		ret = pthread_mutex_init(mutex, &attr);
+	if (ret)
+		urcu_die(ret);
+	(void) pthread_mutexattr_destroy(&attr);
+}
+
+int rcu_domain_shared_init(void *mem, unsigned int max_readers)
+{
+	struct rcu_domain_shm *shm = mem;
+
+#ifndef CONFIG_RCU_HAVE_FUTEX
+	/* The futex emulation cannot wake up other processes. */
+	return -ENOSYS;
+#endif
+	if ((uintptr_t) mem & (CAA_CACHE_LINE_SIZE - 1))
+		return -EINVAL;
+	memset(shm, 0, rcu_domain_shared_size(max_readers));
+	shm->gp.ctr = RCU_GP_COUNT;
+	shm->max_readers = max_readers;
+	shared_mutex_init(&shm->gp_lock);
+	shared_mutex_init(&shm->registry_lock);
+	/* Initialize the domain before publishing it. */
+	cmm_smp_mb();
+	CMM_STORE_SHARED(shm->magic, RCU_DOMAIN_SHM_MAGIC);
+	return 0;
+}
+
+struct rcu_domain *rcu_domain_shared_open(void *mem)
+{
+	struct rcu_domain_shm *shm = mem;
+	struct rcu_domain *parent;
+	struct rcu_domain_impl *domain;
+
+#ifndef CONFIG_RCU_HAVE_FUTEX
+	errno = ENOSYS;
+	return NULL;
+#endif
+	if (CMM_LOAD_SHARED(shm->magic) != RCU_DOMAIN_SHM_MAGIC) {
+		errno = EINVAL;
+		return NULL;
+	}
+	/* Read magic before the domain. */
+	cmm_smp_mb();
+	parent = rcu_domain_create();
+	if (!parent)
+		return NULL;
+	domain = caa_container_of(parent, struct rcu_domain_impl, parent);
+	domain->shm = shm;
+	parent->gp = &shm->gp;
+	parent->shared = 1;
+	return parent;
+}
+
+int rcu_domain_destroy(struct rcu_domain *parent)
+{
+	struct rcu_domain_impl *domain =
+		caa_container_of(parent, struct rcu_domain_impl, parent);
+	int ret;
+
+	mutex_lock(domain_registry_lock(domain));
+	if (domain->shm)
+		ret = domain->nr_shm_readers ? -EBUSY : 0;
+	else
+		ret = cds_list_empty(&domain->registry) ? 0 : -EBUSY;
+	mutex_unlock(domain_registry_lock(domain));
+	if (ret)
+		return ret;
+	call_rcu_data_free(domain->crdp);
+	ret = pthread_mutex_destroy(&domain->registry_lock);
+	if (ret)
+		urcu_die(ret);
+	ret = pthread_mutex_destroy(&domain->gp_lock);
+	if (ret)
+		urcu_die(ret);
+	free(domain);
+	return 0;
+}
+
+/*
+ * Take a free reader slot of a shared domain. The grace period of
+ * another process may still have the slot linked in its registry: it
+ * finds the new reader either inactive or in the current grace period.
+ */
+static struct rcu_reader *domain_shm_register(struct rcu_domain_impl *domain)
+{
+	struct rcu_domain_shm *shm = domain->shm;
+	struct rcu_reader *reader = NULL;
+	unsigned int i, reaped = 0;
+
+	mutex_lock(&shm->registry_lock);
+	rcu_init();	/* In case gcc does not support constructor attribute */
+retry:
+	for (i = 0; i < shm->max_readers; i++) {
+		if (!shm->readers[i].used) {
+			reader = &shm->readers[i].reader;
+			CMM_STORE_SHARED(reader->ctr, 0);
+			reader->tid = pthread_self();
+			shm->readers[i].used = 1;
+			shm->readers[i].pid = getpid();
+			domain->nr_shm_readers++;
+			break;
+		}
+	}
+	if (!reader && !reaped) {
+		domain_shm_reap(domain);
+		reaped = 1;
+		goto retry;
+	}
+	mutex_unlock(&shm->registry_lock);
+	if (!reader)
+		errno = ENOSPC;
+	return reader;
+}
+
+static void domain_shm_unregister(struct rcu_domain_impl *domain,
+		struct rcu_reader *reader)
+{
+	struct rcu_domain_shm_reader *slot = caa_container_of(reader,
+			struct rcu_domain_shm_reader, reader);
+
+	mutex_lock(&domain->shm->registry_lock);
+	slot->used = 0;
+	domain->nr_shm_readers--;
+	mutex_unlock(&domain->shm->registry_lock);
+}
+
+struct rcu_reader *rcu_domain_register_thread(struct rcu_domain *parent)
+{
+	struct rcu_domain_impl *domain =
+		caa_container_of(parent, struct rcu_domain_impl, parent);
+	struct rcu_reader *reader;
+	int ret;
+
+	if (domain->shm)
+		return domain_shm_register(domain);
+	ret = posix_memalign((void **) &reader, CAA_CACHE_LINE_SIZE,
+			sizeof(*reader));
+	if (ret) {
+		errno = ret;
+		return NULL;
+	}
+	memset(reader, 0, sizeof(*reader));
+	reader->tid = pthread_self();
+
+	mutex_lock(&domain->registry_lock);
+	rcu_init();	/* In case gcc does not support constructor attribute */
+	cds_list_add(&reader->node, &domain->registry);
+	domain->registry_gen++;
+	mutex_unlock(&domain->registry_lock);
+	return reader;
+}
+
+void rcu_domain_unregister_thread(struct rcu_domain *parent,
+		struct rcu_reader *reader)
+{
+	struct rcu_domain_impl *domain =
+		caa_container_of(parent, struct rcu_domain_impl, parent);
+
+	assert(!(reader->ctr & RCU_GP_CTR_NEST_MASK));
+	if (domain->shm) {
+		domain_shm_unregister(domain, reader);
+		return;
+	}
+	mutex_lock(&domain->registry_lock);
+	(void) urcu_boost_restore(reader->tid, &reader->boosted,
+			&reader->boost_policy, &reader->boost_param);
+	cds_list_del(&reader->node);
+	domain->registry_gen++;
+	mutex_unlock(&domain->registry_lock);
+	free(reader);
+}
+
+void rcu_domain_read_lock(struct rcu_domain *domain, struct rcu_reader *reader)
+{
+	_rcu_domain_read_lock(domain, reader);
+}
+
+void rcu_domain_read_unlock(struct rcu_domain *domain,
+		struct rcu_reader *reader)
+{
+	_rcu_domain_read_unlock(domain, reader);
+}
+
+int rcu_domain_read_ongoing(struct rcu_reader *reader)
+{
+	return _rcu_domain_read_ongoing(reader);
+}
+
+void rcu_domain_synchronize(struct rcu_domain *parent)
+{
+	domain_synchronize(caa_container_of(parent,
+			struct rcu_domain_impl, parent));
+}
+
+static void domain_gp_sync(void *arg)
+{
+	domain_synchronize(arg);
+}
+
+void rcu_domain_call(struct rcu_domain *parent, struct rcu_head *head,
+		void (*func)(struct rcu_head *head))
+{
+	struct rcu_domain_impl *domain =
+		caa_container_of(parent, struct rcu_domain_impl, parent);
+	struct call_rcu_data *crdp;
+
+	crdp = get_domain_call_rcu_data(&domain->crdp, domain_gp_sync, domain);
+	_call_rcu(head, func, crdp);
 }
 
 #ifdef RCU_MEMBARRIER
+/*
+ * Prefer the private expedited command, which only interrupts the CPUs
+ * running threads of this process, and requires prior registration.
+ * Fall back on the shared command, and on memory barriers on the
+ * read-side if the membarrier system call is unavailable.
+ */
 void rcu_init(void)
 {
+	int mask;
+
 	if (init_done)
 		return;
 	init_done = 1;
-	if (!membarrier(MEMBARRIER_EXPEDITED | MEMBARRIER_QUERY))
-		rcu_has_sys_membarrier = 1;
+	mask = membarrier(MEMBARRIER_CMD_QUERY, 0);
+	if (mask < 0)
+		return;
+	if ((mask & MEMBARRIER_CMD_PRIVATE_EXPEDITED)
+			&& !membarrier(MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0)) {
+		rcu_membarrier_cmd = MEMBARRIER_CMD_PRIVATE_EXPEDITED;
+		rcu_membarrier_mode = RCU_MEMBARRIER_MODE_PRIVATE_EXPEDITED;
+	} else if (mask & MEMBARRIER_CMD_SHARED) {
+		rcu_membarrier_cmd = MEMBARRIER_CMD_SHARED;
+		rcu_membarrier_mode = RCU_MEMBARRIER_MODE_SHARED;
+	} else {
+		return;
+	}
+	rcu_has_sys_membarrier = 1;
+}
+
+enum rcu_membarrier_mode rcu_get_membarrier_mode(void)
+{
+	rcu_init();	/* In case gcc does not support constructor attribute */
+	return rcu_membarrier_mode;
 }
 #endif
 
@@ -480,15 +1556,24 @@ static void sigrcu_handler(int signo, siginfo_t *siginfo, void *context)
 	 * executed on.
 	 */
 	cmm_smp_mb();
+	/* Acknowledge only once if the signal was sent again. */
+	if (!_CMM_LOAD_SHARED(URCU_TLS(rcu_reader).need_mb))
+		return;
 	_CMM_STORE_SHARED(URCU_TLS(rcu_reader).need_mb, 0);
 	cmm_smp_mb();
+	if (uatomic_add_return(&rcu_mb_pending, -1) == 0
+			&& uatomic_read(&rcu_mb_futex) == -1) {
+		uatomic_set(&rcu_mb_futex, 0);
+		(void) futex_async(&rcu_mb_futex, FUTEX_WAKE, 1,
+				NULL, NULL, 0);
+	}
 }
 
 /*
  * rcu_init constructor. Called when the library is linked, but also when
  * reader threads are calling rcu_register_thread().
  * Should only be called by a single thread at a given time. This is ensured by
- * holing the rcu_gp_lock from rcu_register_thread() or by running at library
+ * holding the registry_lock from rcu_register_thread() or by running at library
  * load time, which should not be executed by multiple threads nor concurrently
  * with rcu_register_thread() anyway.
  */
@@ -527,3 +1612,4 @@ DEFINE_RCU_FLAVOR(rcu_flavor);
 
 #include "urcu-call-rcu-impl.h"
 #include "urcu-defer-impl.h"
+#include "urcu-poll-impl.h"
@@ -39,6 +39,10 @@
  * publication headers.
  */
 #include <urcu-pointer.h>
+#include <urcu/wait-mode.h>
+#include <urcu/stall.h>
+#include <urcu/gp-stats.h>
+#include <urcu/reader-info.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -75,14 +79,23 @@ extern "C" {
 #define rcu_read_lock_memb		_rcu_read_lock
 #define rcu_read_unlock_memb		_rcu_read_unlock
 #define rcu_read_ongoing_memb		_rcu_read_ongoing
+#define rcu_domain_read_lock_memb	_rcu_domain_read_lock
+#define rcu_domain_read_unlock_memb	_rcu_domain_read_unlock
+#define rcu_domain_read_ongoing_memb	_rcu_domain_read_ongoing
 #elif defined(RCU_SIGNAL)
 #define rcu_read_lock_sig		_rcu_read_lock
 #define rcu_read_unlock_sig		_rcu_read_unlock
 #define rcu_read_ongoing_sig		_rcu_read_ongoing
+#define rcu_domain_read_lock_sig	_rcu_domain_read_lock
+#define rcu_domain_read_unlock_sig	_rcu_domain_read_unlock
+#define rcu_domain_read_ongoing_sig	_rcu_domain_read_ongoing
 #elif defined(RCU_MB)
 #define rcu_read_lock_mb		_rcu_read_lock
 #define rcu_read_unlock_mb		_rcu_read_unlock
 #define rcu_read_ongoing_mb		_rcu_read_ongoing
+#define rcu_domain_read_lock_mb		_rcu_domain_read_lock
+#define rcu_domain_read_unlock_mb	_rcu_domain_read_unlock
+#define rcu_domain_read_ongoing_mb	_rcu_domain_read_ongoing
 #endif
 
 #else /* !_LGPL_SOURCE */
@@ -96,9 +109,139 @@ extern void rcu_read_lock(void);
 extern void rcu_read_unlock(void);
 extern int rcu_read_ongoing(void);
 
+struct rcu_domain;
+struct rcu_reader;
+
+extern void rcu_domain_read_lock(struct rcu_domain *domain,
+		struct rcu_reader *reader);
+extern void rcu_domain_read_unlock(struct rcu_domain *domain,
+		struct rcu_reader *reader);
+extern int rcu_domain_read_ongoing(struct rcu_reader *reader);
+
+#ifdef URCU_INLINE_SMALL_FUNCTIONS
+
+/*
+ * With URCU_INLINE_SMALL_FUNCTIONS, the read-side fast path, which meets
+ * the 10-line criterion for LGPL, is inlined into non-LGPL code. It
+ * falls back on the function calls if the library was built from
+ * headers with another reader state layout (see RCU_READER_ABI). Only
+ * one flavor can be inlined per compilation unit.
+ */
+#include <urcu/static/urcu.h>
+
+static inline void _rcu_read_lock_abi(void)
+{
+	if (caa_likely(rcu_reader_abi == RCU_READER_ABI))
+		_rcu_read_lock();
+	else
+		rcu_read_lock();
+}
+
+static inline void _rcu_read_unlock_abi(void)
+{
+	if (caa_likely(rcu_reader_abi == RCU_READER_ABI))
+		_rcu_read_unlock();
+	else
+		rcu_read_unlock();
+}
+
+static inline int _rcu_read_ongoing_abi(void)
+{
+	if (caa_likely(rcu_reader_abi == RCU_READER_ABI))
+		return _rcu_read_ongoing();
+	return rcu_read_ongoing();
+}
+
+#ifdef RCU_MEMBARRIER
+#define rcu_read_lock_memb		_rcu_read_lock_abi
+#define rcu_read_unlock_memb		_rcu_read_unlock_abi
+#define rcu_read_ongoing_memb		_rcu_read_ongoing_abi
+#elif defined(RCU_SIGNAL)
+#define rcu_read_lock_sig		_rcu_read_lock_abi
+#define rcu_read_unlock_sig		_rcu_read_unlock_abi
+#define rcu_read_ongoing_sig		_rcu_read_ongoing_abi
+#elif defined(RCU_MB)
+#define rcu_read_lock_mb		_rcu_read_lock_abi
+#define rcu_read_unlock_mb		_rcu_read_unlock_abi
+#define rcu_read_ongoing_mb		_rcu_read_ongoing_abi
+#endif
+
+#endif /* URCU_INLINE_SMALL_FUNCTIONS */
+
 #endif /* !_LGPL_SOURCE */
 
 extern void synchronize_rcu(void);
+extern unsigned long synchronize_rcu_expedited(void);
+
+/*
+ * Grace period polling. See rcu-api.md in userspace-rcu documentation
+ * for usage detail.
+ */
+extern unsigned long get_state_synchronize_rcu(void);
+extern unsigned long start_poll_synchronize_rcu(void);
+extern int poll_state_synchronize_rcu(unsigned long cookie);
+extern void cond_synchronize_rcu(unsigned long cookie);
+
+/*
+ * Number of helper threads scanning the registered readers in parallel
+ * with the grace period. See rcu-api.md in userspace-rcu documentation
+ * for usage detail.
+ */
+extern int rcu_set_gp_scan_threads(unsigned int nr_threads);
+
+/*
+ * Grace period waiting policy. See rcu-api.md in userspace-rcu
+ * documentation for usage detail.
+ */
+extern int rcu_set_wait_mode(enum rcu_wait_mode mode);
+
+/*
+ * Report readers delaying grace periods. See rcu-api.md in
+ * userspace-rcu documentation for usage detail.
+ */
+extern int rcu_set_stall_detector(unsigned long threshold_ms,
+		rcu_stall_func func, void *priv);
+
+/*
+ * Reader priority boosting. See rcu-api.md in userspace-rcu
+ * documentation for usage detail.
+ */
+extern int rcu_set_reader_boost(unsigned long threshold_ms, int policy,
+		int priority);
+
+/*
+ * Grace period statistics. See rcu-api.md in userspace-rcu
+ * documentation for usage detail.
+ */
+extern void rcu_get_gp_stats(struct rcu_gp_stats *stats);
+extern void rcu_reset_gp_stats(void);
+
+/*
+ * Registered readers introspection. See rcu-api.md in userspace-rcu
+ * documentation for usage detail.
+ */
+extern unsigned int rcu_get_readers(struct rcu_reader_info *readers,
+		unsigned int nr);
+
+/*
+ * RCU domains. See rcu-api.md in userspace-rcu documentation for usage
+ * detail.
+ */
+struct rcu_domain;
+struct rcu_reader;
+struct rcu_head;
+
+extern struct rcu_domain *rcu_domain_create(void);
+extern int rcu_domain_destroy(struct rcu_domain *domain);
+extern struct rcu_reader *rcu_domain_register_thread(struct rcu_domain *domain);
+extern void rcu_domain_unregister_thread(struct rcu_domain *domain,
+		struct rcu_reader *reader);
+extern void rcu_domain_synchronize(struct rcu_domain *domain);
+extern void rcu_domain_call(struct rcu_domain *domain, struct rcu_head *head,
+		void (*func)(struct rcu_head *head));
+extern size_t rcu_domain_shared_size(unsigned int max_readers);
+extern int rcu_domain_shared_init(void *mem, unsigned int max_readers);
+extern struct rcu_domain *rcu_domain_shared_open(void *mem);
 
 /*
  * Reader thread registration.
@@ -106,11 +249,37 @@ extern void synchronize_rcu(void);
 extern void rcu_register_thread(void);
 extern void rcu_unregister_thread(void);
 
+/*
+ * Reader contexts, for M:N fiber schedulers. See rcu-api.md in
+ * userspace-rcu documentation for usage detail.
+ */
+extern struct rcu_reader *rcu_context_create(void);
+extern void rcu_context_destroy(struct rcu_reader *ctx);
+extern void rcu_context_attach(struct rcu_reader *ctx);
+extern void rcu_context_detach(struct rcu_reader *ctx);
+
 /*
  * Explicit rcu initialization, for "early" use within library constructors.
  */
 extern void rcu_init(void);
 
+#ifdef RCU_MEMBARRIER
+/*
+ * Memory barrier scheme used by the membarrier flavor, detected by
+ * rcu_init().
+ */
+enum rcu_membarrier_mode {
+	/* No sys_membarrier(): readers issue memory barriers. */
+	RCU_MEMBARRIER_MODE_NONE = 0,
+	/* MEMBARRIER_CMD_SHARED: barrier-free readers, slow updates. */
+	RCU_MEMBARRIER_MODE_SHARED = 1,
+	/* MEMBARRIER_CMD_PRIVATE_EXPEDITED: barrier-free readers. */
+	RCU_MEMBARRIER_MODE_PRIVATE_EXPEDITED = 2,
+};
+
+extern enum rcu_membarrier_mode rcu_get_membarrier_mode(void);
+#endif
+
 /*
  * Q.S. reporting are no-ops for these URCU flavors.
  */
@@ -0,0 +1,60 @@
+#ifndef _URCU_GP_STATS_H
+#define _URCU_GP_STATS_H
+
+/*
+ * urcu/gp-stats.h
+ *
+ * Userspace RCU library - grace period statistics
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RCU_GP_STATS_NR_BUCKETS	32
+
+/*
+ * Grace period statistics of a flavor, as returned by
+ * rcu_get_gp_stats(). Counters wrap around.
+ */
+struct rcu_gp_stats {
+	/* Grace periods executed. */
+	unsigned long nr_gp;
+	/*
+	 * synchronize_rcu() calls which completed with the grace period
+	 * executed by another caller.
+	 */
+	unsigned long nr_piggyback;
+	/* Reader states read while waiting for readers. */
+	unsigned long nr_readers_scanned;
+	/* Times grace periods slept while waiting for readers. */
+	unsigned long nr_sleeps;
+	/*
+	 * Latency of synchronize_rcu(). Bucket i counts the calls which
+	 * lasted from 2^i to 2^(i+1) microseconds. The first bucket
+	 * also counts shorter calls, and the last one longer calls.
+	 */
+	unsigned long latency[RCU_GP_STATS_NR_BUCKETS];
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _URCU_GP_STATS_H */
@@ -45,11 +45,27 @@
 #define rcu_init			rcu_init_bp
 #define rcu_exit			rcu_exit_bp
 #define synchronize_rcu			synchronize_rcu_bp
+#define synchronize_rcu_expedited	synchronize_rcu_expedited_bp
+#define get_state_synchronize_rcu	get_state_synchronize_rcu_bp
+#define start_poll_synchronize_rcu	start_poll_synchronize_rcu_bp
+#define poll_state_synchronize_rcu	poll_state_synchronize_rcu_bp
+#define cond_synchronize_rcu		cond_synchronize_rcu_bp
+#define rcu_set_gp_scan_threads	rcu_set_gp_scan_threads_bp
+#define rcu_set_wait_mode		rcu_set_wait_mode_bp
+#define rcu_set_stall_detector		rcu_set_stall_detector_bp
+#define rcu_set_reader_boost		rcu_set_reader_boost_bp
+#define rcu_get_gp_stats		rcu_get_gp_stats_bp
+#define rcu_reset_gp_stats		rcu_reset_gp_stats_bp
+#define rcu_get_readers			rcu_get_readers_bp
 #define rcu_reader			rcu_reader_bp
 #define rcu_gp				rcu_gp_bp
+#define rcu_reader_abi			rcu_reader_abi_bp
+#define rcu_has_sys_membarrier		rcu_has_sys_membarrier_bp
 
 #define get_cpu_call_rcu_data		get_cpu_call_rcu_data_bp
 #define get_call_rcu_thread		get_call_rcu_thread_bp
+#define get_call_rcu_eventfd		get_call_rcu_eventfd_bp
+#define rcu_process_callbacks		rcu_process_callbacks_bp
 #define create_call_rcu_data		create_call_rcu_data_bp
 #define set_cpu_call_rcu_data		set_cpu_call_rcu_data_bp
 #define get_default_call_rcu_data	get_default_call_rcu_data_bp
@@ -0,0 +1,85 @@
+#ifndef _URCU_PERCPU_MAP_H
+#define _URCU_PERCPU_MAP_H
+
+/*
+ * urcu-map.h
+ *
+ * Userspace RCU header -- name mapping to allow multiple flavors to be
+ * used in the same executable.
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * LGPL-compatible code should include this header with :
+ *
+ * #define _LGPL_SOURCE
+ * #include <urcu-percpu.h>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/* Mapping macros to allow multiple flavors in a single binary. */
+
+#define rcu_read_lock			rcu_read_lock_percpu
+#define _rcu_read_lock			_rcu_read_lock_percpu
+#define rcu_read_unlock			rcu_read_unlock_percpu
+#define _rcu_read_unlock		_rcu_read_unlock_percpu
+#define rcu_read_ongoing		rcu_read_ongoing_percpu
+#define _rcu_read_ongoing		_rcu_read_ongoing_percpu
+#define rcu_read_getcpu			rcu_read_getcpu_percpu
+#define rcu_register_thread		rcu_register_thread_percpu
+#define rcu_unregister_thread		rcu_unregister_thread_percpu
+#define rcu_init			rcu_init_percpu
+#define synchronize_rcu			synchronize_rcu_percpu
+#define synchronize_rcu_expedited	synchronize_rcu_expedited_percpu
+#define get_state_synchronize_rcu	get_state_synchronize_rcu_percpu
+#define start_poll_synchronize_rcu	start_poll_synchronize_rcu_percpu
+#define poll_state_synchronize_rcu	poll_state_synchronize_rcu_percpu
+#define cond_synchronize_rcu		cond_synchronize_rcu_percpu
+#define rcu_set_wait_mode		rcu_set_wait_mode_percpu
+#define rcu_get_gp_stats		rcu_get_gp_stats_percpu
+#define rcu_reset_gp_stats		rcu_reset_gp_stats_percpu
+#define rcu_reader			rcu_reader_percpu
+#define rcu_gp				rcu_gp_percpu
+#define rcu_percpu_count		rcu_percpu_count_percpu
+
+#define get_cpu_call_rcu_data		get_cpu_call_rcu_data_percpu
+#define get_call_rcu_thread		get_call_rcu_thread_percpu
+#define get_call_rcu_eventfd		get_call_rcu_eventfd_percpu
+#define rcu_process_callbacks		rcu_process_callbacks_percpu
+#define create_call_rcu_data		create_call_rcu_data_percpu
+#define set_cpu_call_rcu_data		set_cpu_call_rcu_data_percpu
+#define get_default_call_rcu_data	get_default_call_rcu_data_percpu
+#define get_call_rcu_data		get_call_rcu_data_percpu
+#define get_thread_call_rcu_data	get_thread_call_rcu_data_percpu
+#define set_thread_call_rcu_data	set_thread_call_rcu_data_percpu
+#define create_all_cpu_call_rcu_data	create_all_cpu_call_rcu_data_percpu
+#define free_all_cpu_call_rcu_data	free_all_cpu_call_rcu_data_percpu
+#define call_rcu			call_rcu_percpu
+#define call_rcu_data_free		call_rcu_data_free_percpu
+#define call_rcu_before_fork		call_rcu_before_fork_percpu
+#define call_rcu_after_fork_parent	call_rcu_after_fork_parent_percpu
+#define call_rcu_after_fork_child	call_rcu_after_fork_child_percpu
+#define rcu_barrier			rcu_barrier_percpu
+
+#define defer_rcu			defer_rcu_percpu
+#define rcu_defer_register_thread	rcu_defer_register_thread_percpu
+#define rcu_defer_unregister_thread	rcu_defer_unregister_thread_percpu
+#define rcu_defer_barrier		rcu_defer_barrier_percpu
+#define rcu_defer_barrier_thread	rcu_defer_barrier_thread_percpu
+#define rcu_defer_exit			rcu_defer_exit_percpu
+
+#define rcu_flavor			rcu_flavor_percpu
+
+#endif /* _URCU_PERCPU_MAP_H */
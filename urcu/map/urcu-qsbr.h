@@ -42,17 +42,54 @@
 #define _rcu_read_ongoing		_rcu_read_ongoing_qsbr
 #define rcu_quiescent_state		rcu_quiescent_state_qsbr
 #define _rcu_quiescent_state		_rcu_quiescent_state_qsbr
+#define rcu_context_switch		rcu_context_switch_qsbr
+#define _rcu_context_switch		_rcu_context_switch_qsbr
 #define rcu_thread_offline		rcu_thread_offline_qsbr
 #define rcu_thread_online		rcu_thread_online_qsbr
 #define rcu_register_thread		rcu_register_thread_qsbr
 #define rcu_unregister_thread		rcu_unregister_thread_qsbr
+#define rcu_thread_set_lazy_offline	rcu_thread_set_lazy_offline_qsbr
 #define rcu_exit			rcu_exit_qsbr
 #define synchronize_rcu			synchronize_rcu_qsbr
+#define synchronize_rcu_expedited	synchronize_rcu_expedited_qsbr
+#define get_state_synchronize_rcu	get_state_synchronize_rcu_qsbr
+#define start_poll_synchronize_rcu	start_poll_synchronize_rcu_qsbr
+#define poll_state_synchronize_rcu	poll_state_synchronize_rcu_qsbr
+#define cond_synchronize_rcu		cond_synchronize_rcu_qsbr
+#define rcu_set_gp_scan_threads	rcu_set_gp_scan_threads_qsbr
+#define rcu_set_wait_mode		rcu_set_wait_mode_qsbr
+#define rcu_set_stall_detector		rcu_set_stall_detector_qsbr
+#define rcu_set_reader_boost		rcu_set_reader_boost_qsbr
+#define rcu_get_gp_stats		rcu_get_gp_stats_qsbr
+#define rcu_reset_gp_stats		rcu_reset_gp_stats_qsbr
+#define rcu_get_readers			rcu_get_readers_qsbr
+#define rcu_domain		rcu_domain_qsbr
+#define rcu_domain_create	rcu_domain_create_qsbr
+#define rcu_domain_destroy	rcu_domain_destroy_qsbr
+#define rcu_domain_register_thread	rcu_domain_register_thread_qsbr
+#define rcu_domain_unregister_thread	rcu_domain_unregister_thread_qsbr
+#define rcu_domain_read_lock	rcu_domain_read_lock_qsbr
+#define _rcu_domain_read_lock	_rcu_domain_read_lock_qsbr
+#define rcu_domain_read_unlock	rcu_domain_read_unlock_qsbr
+#define _rcu_domain_read_unlock	_rcu_domain_read_unlock_qsbr
+#define rcu_domain_read_ongoing	rcu_domain_read_ongoing_qsbr
+#define _rcu_domain_read_ongoing	_rcu_domain_read_ongoing_qsbr
+#define rcu_domain_quiescent_state	rcu_domain_quiescent_state_qsbr
+#define _rcu_domain_quiescent_state	_rcu_domain_quiescent_state_qsbr
+#define rcu_domain_thread_offline	rcu_domain_thread_offline_qsbr
+#define _rcu_domain_thread_offline	_rcu_domain_thread_offline_qsbr
+#define rcu_domain_thread_online	rcu_domain_thread_online_qsbr
+#define _rcu_domain_thread_online	_rcu_domain_thread_online_qsbr
+#define rcu_domain_synchronize	rcu_domain_synchronize_qsbr
+#define rcu_domain_call		rcu_domain_call_qsbr
 #define rcu_reader			rcu_reader_qsbr
 #define rcu_gp				rcu_gp_qsbr
+#define rcu_reader_abi			rcu_reader_abi_qsbr
 
 #define get_cpu_call_rcu_data		get_cpu_call_rcu_data_qsbr
 #define get_call_rcu_thread		get_call_rcu_thread_qsbr
+#define get_call_rcu_eventfd		get_call_rcu_eventfd_qsbr
+#define rcu_process_callbacks		rcu_process_callbacks_qsbr
 #define create_call_rcu_data		create_call_rcu_data_qsbr
 #define set_cpu_call_rcu_data		set_cpu_call_rcu_data_qsbr
 #define get_default_call_rcu_data	get_default_call_rcu_data_qsbr
@@ -48,14 +48,50 @@
 #define _rcu_read_ongoing		_rcu_read_ongoing_memb
 #define rcu_register_thread		rcu_register_thread_memb
 #define rcu_unregister_thread		rcu_unregister_thread_memb
+#define rcu_context_create		rcu_context_create_memb
+#define rcu_context_destroy		rcu_context_destroy_memb
+#define rcu_context_attach		rcu_context_attach_memb
+#define rcu_context_detach		rcu_context_detach_memb
 #define rcu_init			rcu_init_memb
 #define rcu_exit			rcu_exit_memb
 #define synchronize_rcu			synchronize_rcu_memb
+#define synchronize_rcu_expedited	synchronize_rcu_expedited_memb
+#define get_state_synchronize_rcu	get_state_synchronize_rcu_memb
+#define start_poll_synchronize_rcu	start_poll_synchronize_rcu_memb
+#define poll_state_synchronize_rcu	poll_state_synchronize_rcu_memb
+#define cond_synchronize_rcu		cond_synchronize_rcu_memb
+#define rcu_set_gp_scan_threads	rcu_set_gp_scan_threads_memb
+#define rcu_set_wait_mode		rcu_set_wait_mode_memb
+#define rcu_set_stall_detector		rcu_set_stall_detector_memb
+#define rcu_set_reader_boost		rcu_set_reader_boost_memb
+#define rcu_get_gp_stats		rcu_get_gp_stats_memb
+#define rcu_reset_gp_stats		rcu_reset_gp_stats_memb
+#define rcu_get_readers			rcu_get_readers_memb
+#define rcu_domain		rcu_domain_memb
+#define rcu_domain_create	rcu_domain_create_memb
+#define rcu_domain_destroy	rcu_domain_destroy_memb
+#define rcu_domain_register_thread	rcu_domain_register_thread_memb
+#define rcu_domain_unregister_thread	rcu_domain_unregister_thread_memb
+#define rcu_domain_read_lock	rcu_domain_read_lock_memb
+#define _rcu_domain_read_lock	_rcu_domain_read_lock_memb
+#define rcu_domain_read_unlock	rcu_domain_read_unlock_memb
+#define _rcu_domain_read_unlock	_rcu_domain_read_unlock_memb
+#define rcu_domain_read_ongoing	rcu_domain_read_ongoing_memb
+#define _rcu_domain_read_ongoing	_rcu_domain_read_ongoing_memb
+#define rcu_domain_synchronize	rcu_domain_synchronize_memb
+#define rcu_domain_call		rcu_domain_call_memb
+#define rcu_domain_shared_size	rcu_domain_shared_size_memb
+#define rcu_domain_shared_init	rcu_domain_shared_init_memb
+#define rcu_domain_shared_open	rcu_domain_shared_open_memb
 #define rcu_reader			rcu_reader_memb
 #define rcu_gp				rcu_gp_memb
+#define rcu_gp_node			rcu_gp_node_memb
+#define rcu_reader_abi			rcu_reader_abi_memb
 
 #define get_cpu_call_rcu_data		get_cpu_call_rcu_data_memb
 #define get_call_rcu_thread		get_call_rcu_thread_memb
+#define get_call_rcu_eventfd		get_call_rcu_eventfd_memb
+#define rcu_process_callbacks		rcu_process_callbacks_memb
 #define create_call_rcu_data		create_call_rcu_data_memb
 #define set_cpu_call_rcu_data		set_cpu_call_rcu_data_memb
 #define get_default_call_rcu_data	get_default_call_rcu_data_memb
@@ -82,6 +118,7 @@
 
 /* Specific to MEMBARRIER flavor */
 #define rcu_has_sys_membarrier		rcu_has_sys_membarrier_memb
+#define rcu_get_membarrier_mode		rcu_get_membarrier_mode_memb
 
 #elif defined(RCU_SIGNAL)
 
@@ -93,14 +130,50 @@
 #define _rcu_read_ongoing		_rcu_read_ongoing_sig
 #define rcu_register_thread		rcu_register_thread_sig
 #define rcu_unregister_thread		rcu_unregister_thread_sig
+#define rcu_context_create		rcu_context_create_sig
+#define rcu_context_destroy		rcu_context_destroy_sig
+#define rcu_context_attach		rcu_context_attach_sig
+#define rcu_context_detach		rcu_context_detach_sig
 #define rcu_init			rcu_init_sig
 #define rcu_exit			rcu_exit_sig
 #define synchronize_rcu			synchronize_rcu_sig
+#define synchronize_rcu_expedited	synchronize_rcu_expedited_sig
+#define get_state_synchronize_rcu	get_state_synchronize_rcu_sig
+#define start_poll_synchronize_rcu	start_poll_synchronize_rcu_sig
+#define poll_state_synchronize_rcu	poll_state_synchronize_rcu_sig
+#define cond_synchronize_rcu		cond_synchronize_rcu_sig
+#define rcu_set_gp_scan_threads	rcu_set_gp_scan_threads_sig
+#define rcu_set_wait_mode		rcu_set_wait_mode_sig
+#define rcu_set_stall_detector		rcu_set_stall_detector_sig
+#define rcu_set_reader_boost		rcu_set_reader_boost_sig
+#define rcu_get_gp_stats		rcu_get_gp_stats_sig
+#define rcu_reset_gp_stats		rcu_reset_gp_stats_sig
+#define rcu_get_readers			rcu_get_readers_sig
+#define rcu_domain		rcu_domain_sig
+#define rcu_domain_create	rcu_domain_create_sig
+#define rcu_domain_destroy	rcu_domain_destroy_sig
+#define rcu_domain_register_thread	rcu_domain_register_thread_sig
+#define rcu_domain_unregister_thread	rcu_domain_unregister_thread_sig
+#define rcu_domain_read_lock	rcu_domain_read_lock_sig
+#define _rcu_domain_read_lock	_rcu_domain_read_lock_sig
+#define rcu_domain_read_unlock	rcu_domain_read_unlock_sig
+#define _rcu_domain_read_unlock	_rcu_domain_read_unlock_sig
+#define rcu_domain_read_ongoing	rcu_domain_read_ongoing_sig
+#define _rcu_domain_read_ongoing	_rcu_domain_read_ongoing_sig
+#define rcu_domain_synchronize	rcu_domain_synchronize_sig
+#define rcu_domain_call		rcu_domain_call_sig
+#define rcu_domain_shared_size	rcu_domain_shared_size_sig
+#define rcu_domain_shared_init	rcu_domain_shared_init_sig
+#define rcu_domain_shared_open	rcu_domain_shared_open_sig
 #define rcu_reader			rcu_reader_sig
 #define rcu_gp				rcu_gp_sig
+#define rcu_gp_node			rcu_gp_node_sig
+#define rcu_reader_abi			rcu_reader_abi_sig
 
 #define get_cpu_call_rcu_data		get_cpu_call_rcu_data_sig
 #define get_call_rcu_thread		get_call_rcu_thread_sig
+#define get_call_rcu_eventfd		get_call_rcu_eventfd_sig
+#define rcu_process_callbacks		rcu_process_callbacks_sig
 #define create_call_rcu_data		create_call_rcu_data_sig
 #define set_cpu_call_rcu_data		set_cpu_call_rcu_data_sig
 #define get_default_call_rcu_data	get_default_call_rcu_data_sig
@@ -135,14 +208,50 @@
 #define _rcu_read_ongoing		_rcu_read_ongoing_mb
 #define rcu_register_thread		rcu_register_thread_mb
 #define rcu_unregister_thread		rcu_unregister_thread_mb
+#define rcu_context_create		rcu_context_create_mb
+#define rcu_context_destroy		rcu_context_destroy_mb
+#define rcu_context_attach		rcu_context_attach_mb
+#define rcu_context_detach		rcu_context_detach_mb
 #define rcu_init			rcu_init_mb
 #define rcu_exit			rcu_exit_mb
 #define synchronize_rcu			synchronize_rcu_mb
+#define synchronize_rcu_expedited	synchronize_rcu_expedited_mb
+#define get_state_synchronize_rcu	get_state_synchronize_rcu_mb
+#define start_poll_synchronize_rcu	start_poll_synchronize_rcu_mb
+#define poll_state_synchronize_rcu	poll_state_synchronize_rcu_mb
+#define cond_synchronize_rcu		cond_synchronize_rcu_mb
+#define rcu_set_gp_scan_threads	rcu_set_gp_scan_threads_mb
+#define rcu_set_wait_mode		rcu_set_wait_mode_mb
+#define rcu_set_stall_detector		rcu_set_stall_detector_mb
+#define rcu_set_reader_boost		rcu_set_reader_boost_mb
+#define rcu_get_gp_stats		rcu_get_gp_stats_mb
+#define rcu_reset_gp_stats		rcu_reset_gp_stats_mb
+#define rcu_get_readers			rcu_get_readers_mb
+#define rcu_domain		rcu_domain_mb
+#define rcu_domain_create	rcu_domain_create_mb
+#define rcu_domain_destroy	rcu_domain_destroy_mb
+#define rcu_domain_register_thread	rcu_domain_register_thread_mb
+#define rcu_domain_unregister_thread	rcu_domain_unregister_thread_mb
+#define rcu_domain_read_lock	rcu_domain_read_lock_mb
+#define _rcu_domain_read_lock	_rcu_domain_read_lock_mb
+#define rcu_domain_read_unlock	rcu_domain_read_unlock_mb
+#define _rcu_domain_read_unlock	_rcu_domain_read_unlock_mb
+#define rcu_domain_read_ongoing	rcu_domain_read_ongoing_mb
+#define _rcu_domain_read_ongoing	_rcu_domain_read_ongoing_mb
+#define rcu_domain_synchronize	rcu_domain_synchronize_mb
+#define rcu_domain_call		rcu_domain_call_mb
+#define rcu_domain_shared_size	rcu_domain_shared_size_mb
+#define rcu_domain_shared_init	rcu_domain_shared_init_mb
+#define rcu_domain_shared_open	rcu_domain_shared_open_mb
 #define rcu_reader			rcu_reader_mb
 #define rcu_gp				rcu_gp_mb
+#define rcu_gp_node			rcu_gp_node_mb
+#define rcu_reader_abi			rcu_reader_abi_mb
 
 #define get_cpu_call_rcu_data		get_cpu_call_rcu_data_mb
 #define get_call_rcu_thread		get_call_rcu_thread_mb
+#define get_call_rcu_eventfd		get_call_rcu_eventfd_mb
+#define rcu_process_callbacks		rcu_process_callbacks_mb
 #define create_call_rcu_data		create_call_rcu_data_mb
 #define set_cpu_call_rcu_data		set_cpu_call_rcu_data_mb
 #define get_default_call_rcu_data	get_default_call_rcu_data_mb
@@ -0,0 +1,60 @@
+#ifndef _URCU_READER_INFO_H
+#define _URCU_READER_INFO_H
+
+/*
+ * urcu/reader-info.h
+ *
+ * Userspace RCU library - registered reader introspection
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum rcu_reader_info_state {
+	/* Not in a read-side critical section. */
+	RCU_READER_INFO_QUIESCENT = 0,
+	/* In a read-side critical section. */
+	RCU_READER_INFO_ACTIVE = 1,
+	/* urcu-qsbr only: offline. */
+	RCU_READER_INFO_OFFLINE = 2,
+};
+
+/* Registered reader, as returned by rcu_get_readers(). */
+struct rcu_reader_info {
+	/* Thread of the reader, or 0 for a reader context. */
+	pthread_t tid;
+	enum rcu_reader_info_state state;
+	/* Read-side critical section nesting, or 0 if not tracked. */
+	unsigned long nesting;
+	/*
+	 * CLOCK_MONOTONIC time, in ns, at which the current read-side
+	 * critical section began, or 0 if not recorded (see
+	 * --enable-reader-timestamp).
+	 */
+	unsigned long long since_ns;
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _URCU_READER_INFO_H */
@@ -0,0 +1,56 @@
+#ifndef _URCU_STALL_H
+#define _URCU_STALL_H
+
+/*
+ * urcu/stall.h
+ *
+ * Userspace RCU library - reader stall reports
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Reader blocking a grace period for longer than the threshold set by
+ * rcu_set_stall_detector().
+ */
+struct rcu_stall_info {
+	/* Thread of the reader, or 0 for a reader context. */
+	pthread_t tid;
+	/* Reader counter, as read by the grace period. */
+	unsigned long ctr;
+	/* Read-side critical section nesting, or 0 if not tracked. */
+	unsigned long nesting;
+	/* Time the reader has been seen with this counter, in ms. */
+	unsigned long stall_ms;
+	/* Time the grace period has been waiting for readers, in ms. */
+	unsigned long gp_ms;
+};
+
+typedef void (*rcu_stall_func)(const struct rcu_stall_info *info,
+		void *priv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _URCU_STALL_H */
@@ -0,0 +1,71 @@
+#ifndef _URCU_READER_INFO_STATIC_H
+#define _URCU_READER_INFO_STATIC_H
+
+/*
+ * urcu/static/reader-info.h
+ *
+ * Userspace RCU library - read-side critical section timestamps
+ *
+ * TO BE INCLUDED ONLY IN LGPL-COMPATIBLE CODE. See urcu/reader-info.h
+ * for the API.
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <urcu/config.h>
+#include <urcu/system.h>
+#include <urcu/reader-info.h>
+
+#ifdef CONFIG_RCU_READER_TIMESTAMP
+#include <time.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Part of the RCU_READER_ABI of the flavors. */
+#ifdef CONFIG_RCU_READER_TIMESTAMP
+#define RCU_READER_ABI_TIMESTAMP	(1U << 0)
+#else
+#define RCU_READER_ABI_TIMESTAMP	0
+#endif
+
+/*
+ * With --enable-reader-timestamp, readers record when their outermost
+ * read-side critical section begins (urcu-qsbr: their last quiescent
+ * state), for rcu_get_readers(). This costs a clock read on the
+ * read-side, so it is meant for debugging and profiling.
+ */
+#ifdef CONFIG_RCU_READER_TIMESTAMP
+static inline void _rcu_reader_timestamp(unsigned long long *since_ns)
+{
+	struct timespec ts;
+
+	(void) clock_gettime(CLOCK_MONOTONIC, &ts);
+	_CMM_STORE_SHARED(*since_ns,
+		(unsigned long long) ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+#else
+#define _rcu_reader_timestamp(since_ns)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _URCU_READER_INFO_STATIC_H */
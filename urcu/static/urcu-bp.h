@@ -31,6 +31,7 @@
 
 #include <stdlib.h>
 #include <pthread.h>
+#include <sched.h>
 #include <unistd.h>
 
 #include <urcu/compiler.h>
@@ -39,6 +40,7 @@
 #include <urcu/uatomic.h>
 #include <urcu/list.h>
 #include <urcu/tls-compat.h>
+#include <urcu/static/reader-info.h>
 
 /*
  * This code section can only be included in LGPL 2.1 compatible source code.
@@ -94,10 +96,25 @@ extern struct rcu_gp rcu_gp;
 struct rcu_reader {
 	/* Data used by both reader and synchronize_rcu() */
 	unsigned long ctr;
+#ifdef CONFIG_RCU_READER_TIMESTAMP
+	/* Start of the current read-side critical section, in ns. */
+	unsigned long long since_ns;
+#endif
 	/* Data used for registry */
 	struct cds_list_head node __attribute__((aligned(CAA_CACHE_LINE_SIZE)));
 	pthread_t tid;
 	int alloc;	/* registry entry allocated */
+	/*
+	 * Since when grace periods have seen this reader with counter
+	 * stall_ctr, in ms (see rcu_set_stall_detector()).
+	 */
+	unsigned long stall_ctr, stall_since;
+	/*
+	 * Scheduling of the reader thread saved when a grace period
+	 * boosted it (see rcu_set_reader_boost()).
+	 */
+	int boosted, boost_policy;
+	struct sched_param boost_param;
 };
 
 /*
@@ -107,6 +124,32 @@ struct rcu_reader {
  */
 extern DECLARE_URCU_TLS(struct rcu_reader *, rcu_reader);
 
+/*
+ * Checked by the read-side inlined into non-LGPL code, like for the
+ * urcu flavor (see urcu/static/urcu.h).
+ */
+#define RCU_READER_ABI_VERSION		1
+
+#define RCU_READER_ABI	((RCU_READER_ABI_VERSION << 8)			\
+		| RCU_READER_ABI_TIMESTAMP)
+
+extern const unsigned int rcu_reader_abi;
+
+/*
+ * Set at initialization if the private expedited sys_membarrier()
+ * command is available. Readers then only issue compiler barriers, and
+ * synchronize_rcu() issues sys_membarrier() on their behalf.
+ */
+extern int rcu_has_sys_membarrier;
+
+static inline void smp_mb_slave(void)
+{
+	if (caa_likely(rcu_has_sys_membarrier))
+		cmm_barrier();
+	else
+		cmm_smp_mb();
+}
+
 static inline enum rcu_state rcu_reader_state(unsigned long *ctr)
 {
 	unsigned long v;
@@ -135,8 +178,9 @@ static inline enum rcu_state rcu_reader_state(unsigned long *ctr)
 static inline void _rcu_read_lock_update(unsigned long tmp)
 {
 	if (caa_likely(!(tmp & RCU_GP_CTR_NEST_MASK))) {
+		_rcu_reader_timestamp(&URCU_TLS(rcu_reader)->since_ns);
 		_CMM_STORE_SHARED(URCU_TLS(rcu_reader)->ctr, _CMM_LOAD_SHARED(rcu_gp.ctr));
-		cmm_smp_mb();
+		smp_mb_slave();
 	} else
 		_CMM_STORE_SHARED(URCU_TLS(rcu_reader)->ctr, tmp + RCU_GP_COUNT);
 }
@@ -172,7 +216,7 @@ static inline void _rcu_read_unlock(void)
 	/*
 	 * Finish using rcu before decrementing the pointer.
 	 */
-	cmm_smp_mb();
+	smp_mb_slave();
 	_CMM_STORE_SHARED(URCU_TLS(rcu_reader)->ctr, URCU_TLS(rcu_reader)->ctr - RCU_GP_COUNT);
 	cmm_barrier();	/* Ensure the compiler does not reorder us with mutex */
 }
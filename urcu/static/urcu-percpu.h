@@ -0,0 +1,200 @@
+#ifndef _URCU_PERCPU_STATIC_H
+#define _URCU_PERCPU_STATIC_H
+
+/*
+ * urcu-percpu-static.h
+ *
+ * Userspace RCU header, per-CPU counters flavor.
+ *
+ * TO BE INCLUDED ONLY IN CODE THAT IS TO BE RECOMPILED ON EACH LIBURCU
+ * RELEASE. See urcu-percpu.h for linking dynamically with the userspace
+ * rcu library.
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sched.h>
+#include <stdint.h>
+
+#include <urcu/compiler.h>
+#include <urcu/arch.h>
+#include <urcu/system.h>
+#include <urcu/uatomic.h>
+#include <urcu/futex.h>
+#include <urcu/tls-compat.h>
+
+/*
+ * This code section can only be included in LGPL 2.1 compatible source code.
+ * See below for the function call wrappers which can be used in code meant to
+ * be only linked with the Userspace RCU library. This comes with a small
+ * performance degradation on the read-side due to the added function calls.
+ * This is required to permit relinking with newer versions of the library.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef DEBUG_RCU
+#define rcu_assert(args...)	assert(args)
+#else
+#define rcu_assert(args...)
+#endif
+
+/*
+ * Readers do not register: they increment the lock counter of the CPU
+ * they run on when entering an outermost read-side critical section,
+ * and the unlock counter of the CPU they run on when exiting it. The
+ * grace period waits for the sums of lock and unlock counters of a
+ * phase to match across all CPUs, so its cost depends on the number of
+ * CPUs rather than on the number of threads.
+ *
+ * Counters of CPUs numbered RCU_PERCPU_MAX_CPUS or above, or beyond the
+ * number of configured CPUs, are accounted on CPU 0.
+ */
+#define RCU_PERCPU_MAX_CPUS	4096
+
+#define RCU_GP_CTR_PHASE	(1UL << 0)
+
+struct rcu_gp {
+	/*
+	 * Global grace period counter. The phase used by new readers
+	 * is its low-order bit. Written to only by writer with mutex
+	 * taken. Read by both writer and readers.
+	 */
+	unsigned long ctr;
+
+	int32_t futex;
+
+	/*
+	 * Number of per-CPU counters scanned by the grace period.
+	 * Written once by rcu_init().
+	 */
+	unsigned int nr_cpus;
+} __attribute__((aligned(CAA_CACHE_LINE_SIZE)));
+
+extern struct rcu_gp rcu_gp;
+
+struct rcu_percpu_count {
+	unsigned long lock[2];
+	unsigned long unlock[2];
+} __attribute__((aligned(CAA_CACHE_LINE_SIZE)));
+
+extern struct rcu_percpu_count rcu_percpu_count[RCU_PERCPU_MAX_CPUS];
+
+struct rcu_reader {
+	/* Read-side critical section nesting, and phase of outermost. */
+	unsigned long nesting;
+	unsigned long phase;
+};
+
+extern DECLARE_URCU_TLS(struct rcu_reader, rcu_reader);
+
+/*
+ * sched_getcpu() is only declared by the C library when _GNU_SOURCE is
+ * defined. Otherwise, use the library wrapper.
+ */
+extern int rcu_read_getcpu(void);
+
+#if defined(CONFIG_RCU_HAVE_SCHED_GETCPU) && defined(_GNU_SOURCE)
+static inline int _rcu_read_getcpu(void)
+{
+	return sched_getcpu();
+}
+#else
+#define _rcu_read_getcpu	rcu_read_getcpu
+#endif
+
+static inline struct rcu_percpu_count *rcu_percpu_this_count(void)
+{
+	unsigned int cpu = (unsigned int) _rcu_read_getcpu();
+
+	if (caa_unlikely(cpu >= CMM_LOAD_SHARED(rcu_gp.nr_cpus)))
+		cpu = 0;
+	return &rcu_percpu_count[cpu];
+}
+
+/*
+ * Wake-up waiting synchronize_rcu(). Called from many concurrent threads.
+ */
+static inline void wake_up_gp(void)
+{
+	if (caa_unlikely(uatomic_read(&rcu_gp.futex) == -1)) {
+		uatomic_set(&rcu_gp.futex, 0);
+		futex_async(&rcu_gp.futex, FUTEX_WAKE, 1,
+		      NULL, NULL, 0);
+	}
+}
+
+/*
+ * Enter an RCU read-side critical section.
+ *
+ * The phase is read before incrementing the lock counter. A reader
+ * delayed between the two is handled by the grace period, which waits
+ * for the readers of both phases.
+ */
+static inline void _rcu_read_lock(void)
+{
+	struct rcu_reader *reader = &URCU_TLS(rcu_reader);
+	unsigned long phase;
+
+	cmm_barrier();
+	if (caa_likely(!reader->nesting)) {
+		phase = CMM_LOAD_SHARED(rcu_gp.ctr) & RCU_GP_CTR_PHASE;
+		uatomic_inc(&rcu_percpu_this_count()->lock[phase]);
+		/* Increment lock counter before critical section. */
+		cmm_smp_mb__after_uatomic_inc();
+		reader->phase = phase;
+	}
+	reader->nesting++;
+}
+
+/*
+ * Exit an RCU read-side critical section.
+ */
+static inline void _rcu_read_unlock(void)
+{
+	struct rcu_reader *reader = &URCU_TLS(rcu_reader);
+
+	if (caa_likely(reader->nesting == 1)) {
+		/* Order critical section before unlock counter increment. */
+		cmm_smp_mb__before_uatomic_inc();
+		uatomic_inc(&rcu_percpu_this_count()->unlock[reader->phase]);
+		/* Increment unlock counter before reading futex. */
+		cmm_smp_mb__after_uatomic_inc();
+		wake_up_gp();
+	}
+	reader->nesting--;
+	cmm_barrier();	/* Ensure the compiler does not reorder us with mutex */
+}
+
+/*
+ * Returns whether within a RCU read-side critical section.
+ */
+static inline int _rcu_read_ongoing(void)
+{
+	return URCU_TLS(rcu_reader).nesting != 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _URCU_PERCPU_STATIC_H */
@@ -31,6 +31,7 @@
 
 #include <stdlib.h>
 #include <pthread.h>
+#include <sched.h>
 #include <assert.h>
 #include <limits.h>
 #include <unistd.h>
@@ -43,6 +44,7 @@
 #include <urcu/list.h>
 #include <urcu/futex.h>
 #include <urcu/tls-compat.h>
+#include <urcu/static/reader-info.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -87,42 +89,106 @@ extern struct rcu_gp rcu_gp;
 struct rcu_reader {
 	/* Data used by both reader and synchronize_rcu() */
 	unsigned long ctr;
+	/*
+	 * Set by rcu_thread_set_lazy_offline(): grace periods issue
+	 * sys_membarrier() on behalf of this reader, which only needs
+	 * compiler barriers to go offline and come back online.
+	 */
+	int lazy;
+#ifdef CONFIG_RCU_READER_TIMESTAMP
+	/* Start of the current read-side critical section, in ns. */
+	unsigned long long since_ns;
+#endif
 	/* Data used for registry */
 	struct cds_list_head node __attribute__((aligned(CAA_CACHE_LINE_SIZE)));
 	int waiting;
 	pthread_t tid;
+	/*
+	 * Since when grace periods have seen this reader with counter
+	 * stall_ctr, in ms (see rcu_set_stall_detector()).
+	 */
+	unsigned long stall_ctr, stall_since;
+	/*
+	 * Scheduling of the reader thread saved when a grace period
+	 * boosted it (see rcu_set_reader_boost()).
+	 */
+	int boosted, boost_policy;
+	struct sched_param boost_param;
 };
 
 extern DECLARE_URCU_TLS(struct rcu_reader, rcu_reader);
 
+/*
+ * Checked by the read-side inlined into non-LGPL code, like for the
+ * urcu flavor (see urcu/static/urcu.h).
+ */
+#define RCU_READER_ABI_VERSION		1
+
+#define RCU_READER_ABI	((RCU_READER_ABI_VERSION << 8)			\
+		| RCU_READER_ABI_TIMESTAMP)
+
+extern const unsigned int rcu_reader_abi;
+
+/*
+ * RCU domain. A grace period of a domain only waits for the readers
+ * registered to this domain. Only the grace period state accessed by
+ * the read-side is exposed here.
+ */
+struct rcu_domain {
+	struct rcu_gp *gp;
+};
+
 /*
  * Wake-up waiting synchronize_rcu(). Called from many concurrent threads.
  */
-static inline void wake_up_gp(void)
+static inline void rcu_gp_wake_up(struct rcu_gp *gp, struct rcu_reader *reader)
 {
-	if (caa_unlikely(_CMM_LOAD_SHARED(URCU_TLS(rcu_reader).waiting))) {
-		_CMM_STORE_SHARED(URCU_TLS(rcu_reader).waiting, 0);
+	if (caa_unlikely(_CMM_LOAD_SHARED(reader->waiting))) {
+		_CMM_STORE_SHARED(reader->waiting, 0);
 		cmm_smp_mb();
-		if (uatomic_read(&rcu_gp.futex) != -1)
+		if (uatomic_read(&gp->futex) != -1)
 			return;
-		uatomic_set(&rcu_gp.futex, 0);
-		futex_noasync(&rcu_gp.futex, FUTEX_WAKE, 1,
+		uatomic_set(&gp->futex, 0);
+		futex_noasync(&gp->futex, FUTEX_WAKE, 1,
 		      NULL, NULL, 0);
 	}
 }
 
-static inline enum rcu_state rcu_reader_state(unsigned long *ctr)
+static inline void wake_up_gp(void)
+{
+	rcu_gp_wake_up(&rcu_gp, &URCU_TLS(rcu_reader));
+}
+
+/*
+ * Memory barrier issued by "reader" when going offline or coming back
+ * online. Pairs with smp_mb_master() on the grace period side.
+ */
+static inline void smp_mb_slave(struct rcu_reader *reader)
+{
+	if (caa_likely(reader->lazy))
+		cmm_barrier();
+	else
+		cmm_smp_mb();
+}
+
+static inline enum rcu_state rcu_gp_reader_state(struct rcu_gp *gp,
+		unsigned long *ctr)
 {
 	unsigned long v;
 
 	v = CMM_LOAD_SHARED(*ctr);
 	if (!v)
 		return RCU_READER_INACTIVE;
-	if (v == rcu_gp.ctr)
+	if (v == gp->ctr)
 		return RCU_READER_ACTIVE_CURRENT;
 	return RCU_READER_ACTIVE_OLD;
 }
 
+static inline enum rcu_state rcu_reader_state(unsigned long *ctr)
+{
+	return rcu_gp_reader_state(&rcu_gp, ctr);
+}
+
 /*
  * Enter an RCU read-side critical section.
  *
@@ -170,6 +236,7 @@ static inline int _rcu_read_ongoing(void)
 static inline void _rcu_quiescent_state_update_and_wakeup(unsigned long gp_ctr)
 {
 	cmm_smp_mb();
+	_rcu_reader_timestamp(&URCU_TLS(rcu_reader).since_ns);
 	_CMM_STORE_SHARED(URCU_TLS(rcu_reader).ctr, gp_ctr);
 	cmm_smp_mb();	/* write URCU_TLS(rcu_reader).ctr before read futex */
 	wake_up_gp();
@@ -197,6 +264,18 @@ static inline void _rcu_quiescent_state(void)
 	_rcu_quiescent_state_update_and_wakeup(gp_ctr);
 }
 
+/*
+ * Inform RCU of a quiescent state on behalf of the fiber being switched
+ * out, which cannot hold references to RCU-protected data across the
+ * switch. Meant to be called by M:N fiber schedulers on each context
+ * switch. Does nothing if the thread is offline.
+ */
+static inline void _rcu_context_switch(void)
+{
+	if (caa_likely(URCU_TLS(rcu_reader).ctr))
+		_rcu_quiescent_state();
+}
+
 /*
  * Take a thread offline, prohibiting it from entering further RCU
  * read-side critical sections.
@@ -207,10 +286,12 @@ static inline void _rcu_quiescent_state(void)
  */
 static inline void _rcu_thread_offline(void)
 {
-	cmm_smp_mb();
-	CMM_STORE_SHARED(URCU_TLS(rcu_reader).ctr, 0);
-	cmm_smp_mb();	/* write URCU_TLS(rcu_reader).ctr before read futex */
-	wake_up_gp();
+	struct rcu_reader *reader = &URCU_TLS(rcu_reader);
+
+	smp_mb_slave(reader);
+	CMM_STORE_SHARED(reader->ctr, 0);
+	smp_mb_slave(reader);	/* write reader->ctr before read futex */
+	rcu_gp_wake_up(&rcu_gp, reader);
 	cmm_barrier();	/* Ensure the compiler does not reorder us with mutex */
 }
 
@@ -224,11 +305,68 @@ static inline void _rcu_thread_offline(void)
  */
 static inline void _rcu_thread_online(void)
 {
+	struct rcu_reader *reader = &URCU_TLS(rcu_reader);
+
 	cmm_barrier();	/* Ensure the compiler does not reorder us with mutex */
-	_CMM_STORE_SHARED(URCU_TLS(rcu_reader).ctr, CMM_LOAD_SHARED(rcu_gp.ctr));
+	_rcu_reader_timestamp(&reader->since_ns);
+	_CMM_STORE_SHARED(reader->ctr, CMM_LOAD_SHARED(rcu_gp.ctr));
+	smp_mb_slave(reader);
+}
+
+/*
+ * Domain counterparts of the functions above, acting on "reader", which
+ * has been registered to "domain" by the current thread.
+ */
+static inline void _rcu_domain_read_lock(struct rcu_domain *domain,
+		struct rcu_reader *reader)
+{
+	rcu_assert(reader->ctr);
+}
+
+static inline void _rcu_domain_read_unlock(struct rcu_domain *domain,
+		struct rcu_reader *reader)
+{
+}
+
+static inline int _rcu_domain_read_ongoing(struct rcu_reader *reader)
+{
+	return reader->ctr;
+}
+
+static inline void _rcu_domain_quiescent_state(struct rcu_domain *domain,
+		struct rcu_reader *reader)
+{
+	unsigned long gp_ctr;
+
+	if ((gp_ctr = CMM_LOAD_SHARED(domain->gp->ctr)) == reader->ctr)
+		return;
+	cmm_smp_mb();
+	_rcu_reader_timestamp(&reader->since_ns);
+	_CMM_STORE_SHARED(reader->ctr, gp_ctr);
+	cmm_smp_mb();	/* write reader->ctr before read futex */
+	rcu_gp_wake_up(domain->gp, reader);
 	cmm_smp_mb();
 }
 
+static inline void _rcu_domain_thread_offline(struct rcu_domain *domain,
+		struct rcu_reader *reader)
+{
+	smp_mb_slave(reader);
+	CMM_STORE_SHARED(reader->ctr, 0);
+	smp_mb_slave(reader);	/* write reader->ctr before read futex */
+	rcu_gp_wake_up(domain->gp, reader);
+	cmm_barrier();	/* Ensure the compiler does not reorder us with mutex */
+}
+
+static inline void _rcu_domain_thread_online(struct rcu_domain *domain,
+		struct rcu_reader *reader)
+{
+	cmm_barrier();	/* Ensure the compiler does not reorder us with mutex */
+	_rcu_reader_timestamp(&reader->since_ns);
+	_CMM_STORE_SHARED(reader->ctr, CMM_LOAD_SHARED(domain->gp->ctr));
+	smp_mb_slave(reader);
+}
+
 #ifdef __cplusplus 
 }
 #endif
@@ -31,6 +31,7 @@
 
 #include <stdlib.h>
 #include <pthread.h>
+#include <sched.h>
 #include <unistd.h>
 #include <stdint.h>
 
@@ -42,6 +43,7 @@
 #include <urcu/futex.h>
 #include <urcu/tls-compat.h>
 #include <urcu/rand-compat.h>
+#include <urcu/static/reader-info.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -126,6 +128,28 @@ static inline void smp_mb_slave(int group)
 }
 #endif
 
+/*
+ * The signal handler only knows about the thread's default reader, so
+ * readers of RCU domains other than the default one cannot rely on it:
+ * they use full memory barriers with the signal flavor. So do readers
+ * of domains shared across processes, which membarrier() and signals
+ * sent by a grace period running in another process do not reach.
+ */
+#ifdef RCU_SIGNAL
+static inline void smp_mb_slave_domain(int shared, int group)
+{
+	cmm_smp_mb();
+}
+#else
+static inline void smp_mb_slave_domain(int shared, int group)
+{
+	if (caa_unlikely(shared))
+		cmm_smp_mb();
+	else
+		smp_mb_slave(group);
+}
+#endif
+
 /*
  * The trick here is that RCU_GP_CTR_PHASE must be a multiple of 8 so we can use
  * a full 8-bits, 16-bits or 32-bits bitmask for the lower order bits.
@@ -134,11 +158,17 @@ static inline void smp_mb_slave(int group)
 /* Use the amount of bits equal to half of the architecture long size */
 #define RCU_GP_CTR_PHASE	(1UL << (sizeof(unsigned long) << 2))
 #define RCU_GP_CTR_NEST_MASK	(RCU_GP_CTR_PHASE - 1)
+/*
+ * With 64-bit long, grace periods increment the upper half of the
+ * counter by RCU_GP_CTR_PHASE rather than switching its parity.
+ */
+#define RCU_GP_CTR_SEQ_MASK	(~RCU_GP_CTR_NEST_MASK)
 
 struct rcu_gp {
 	/*
 	 * Global grace period counter.
-	 * Contains the current RCU_GP_CTR_PHASE.
+	 * Contains the current RCU_GP_CTR_PHASE, or grace period sequence
+	 * (in RCU_GP_CTR_SEQ_MASK) with 64-bit long.
 	 * Also has a RCU_GP_COUNT of 1, to accelerate the reader fast path.
 	 * Written to only by writer with mutex taken.
 	 * Read by both writer and readers.
@@ -150,30 +180,106 @@ struct rcu_gp {
 
 extern struct rcu_gp rcu_gp;
 
+#ifdef CONFIG_RCU_NUMA_GP_CTR
+/*
+ * Copies of rcu_gp.ctr, one per NUMA node, each on its own cache line.
+ * Readers load the copy of the node they were running on when they
+ * registered, so a grace period does not have every node fetch the
+ * same cache line. Written to only by writer with mutex taken, after
+ * rcu_gp.ctr. Nodes numbered RCU_GP_MAX_NODES or above share copies.
+ */
+#define RCU_GP_MAX_NODES	64
+
+struct rcu_gp_node {
+	unsigned long ctr;
+} __attribute__((aligned(CAA_CACHE_LINE_SIZE)));
+
+extern struct rcu_gp_node rcu_gp_node[RCU_GP_MAX_NODES];
+#endif
+
 struct rcu_reader {
 	/* Data used by both reader and synchronize_rcu() */
 	unsigned long ctr;
 	char need_mb;
+	/* Reader context not bound to a thread (see rcu_context_create()). */
+	char context;
+#ifdef CONFIG_RCU_NUMA_GP_CTR
+	/* Copy of rcu_gp.ctr read by this reader. Set at registration. */
+	unsigned long *gp_ctr;
+#endif
+#ifdef CONFIG_RCU_READER_TIMESTAMP
+	/* Start of the current read-side critical section, in ns. */
+	unsigned long long since_ns;
+#endif
 	/* Data used for registry */
 	struct cds_list_head node __attribute__((aligned(CAA_CACHE_LINE_SIZE)));
 	pthread_t tid;
+	/*
+	 * Since when grace periods have seen this reader with counter
+	 * stall_ctr, in ms (see rcu_set_stall_detector()).
+	 */
+	unsigned long stall_ctr, stall_since;
+	/*
+	 * Scheduling of the reader thread saved when a grace period
+	 * boosted it (see rcu_set_reader_boost()).
+	 */
+	int boosted, boost_policy;
+	struct sched_param boost_param;
 };
 
 extern DECLARE_URCU_TLS(struct rcu_reader, rcu_reader);
 
+/*
+ * Version of the layout of struct rcu_gp and struct rcu_reader, and of
+ * the read-side algorithm, as inlined into non-LGPL code defining
+ * URCU_INLINE_SMALL_FUNCTIONS. Must be bumped by any change breaking
+ * code compiled with older headers. RCU_READER_ABI adds the configure
+ * options changing the layout. The library exports the value it was
+ * built with as rcu_reader_abi, so inlined code can check it matches.
+ */
+#define RCU_READER_ABI_VERSION		1
+
+#ifdef CONFIG_RCU_NUMA_GP_CTR
+#define RCU_READER_ABI_NUMA_GP_CTR	(1U << 1)
+#else
+#define RCU_READER_ABI_NUMA_GP_CTR	0
+#endif
+
+#define RCU_READER_ABI	((RCU_READER_ABI_VERSION << 8)			\
+		| RCU_READER_ABI_TIMESTAMP | RCU_READER_ABI_NUMA_GP_CTR)
+
+extern const unsigned int rcu_reader_abi;
+
+/*
+ * RCU domain. A grace period of a domain only waits for the readers
+ * registered to this domain. Only the grace period state accessed by
+ * the read-side is exposed here.
+ */
+struct rcu_domain {
+	struct rcu_gp *gp;
+	/* Non-zero if shared across processes. */
+	int shared;
+};
+
 /*
  * Wake-up waiting synchronize_rcu(). Called from many concurrent threads.
  */
-static inline void wake_up_gp(void)
+static inline void rcu_gp_wake_up(struct rcu_gp *gp)
 {
-	if (caa_unlikely(uatomic_read(&rcu_gp.futex) == -1)) {
-		uatomic_set(&rcu_gp.futex, 0);
-		futex_async(&rcu_gp.futex, FUTEX_WAKE, 1,
+	if (caa_unlikely(uatomic_read(&gp->futex) == -1)) {
+		uatomic_set(&gp->futex, 0);
+		futex_async(&gp->futex, FUTEX_WAKE, 1,
 		      NULL, NULL, 0);
 	}
 }
 
-static inline enum rcu_state rcu_reader_state(unsigned long *ctr)
+static inline void wake_up_gp(void)
+{
+	rcu_gp_wake_up(&rcu_gp);
+}
+
+static inline enum rcu_state rcu_gp_reader_state(struct rcu_gp *gp,
+		unsigned long *ctr)
 {
 	unsigned long v;
 
@@ -184,11 +290,31 @@ static inline enum rcu_state rcu_reader_state(unsigned long *ctr)
 	v = CMM_LOAD_SHARED(*ctr);
 	if (!(v & RCU_GP_CTR_NEST_MASK))
 		return RCU_READER_INACTIVE;
-	if (!((v ^ rcu_gp.ctr) & RCU_GP_CTR_PHASE))
+	if (!((v ^ gp->ctr) & RCU_GP_CTR_SEQ_MASK))
 		return RCU_READER_ACTIVE_CURRENT;
 	return RCU_READER_ACTIVE_OLD;
 }
 
+static inline enum rcu_state rcu_reader_state(unsigned long *ctr)
+{
+	return rcu_gp_reader_state(&rcu_gp, ctr);
+}
+
+/*
+ * Grace period counter loaded by the outermost _rcu_read_lock().
+ */
+#ifdef CONFIG_RCU_NUMA_GP_CTR
+static inline unsigned long rcu_gp_ctr_read(void)
+{
+	return _CMM_LOAD_SHARED(*URCU_TLS(rcu_reader).gp_ctr);
+}
+#else
+static inline unsigned long rcu_gp_ctr_read(void)
+{
+	return _CMM_LOAD_SHARED(rcu_gp.ctr);
+}
+#endif
+
 /*
  * Helper for _rcu_read_lock().  The format of rcu_gp.ctr (as well as
  * the per-thread rcu_reader.ctr) has the upper bits containing a count of
@@ -199,7 +325,8 @@ static inline enum rcu_state rcu_reader_state(unsigned long *ctr)
 static inline void _rcu_read_lock_update(unsigned long tmp)
 {
 	if (caa_likely(!(tmp & RCU_GP_CTR_NEST_MASK))) {
-		_CMM_STORE_SHARED(URCU_TLS(rcu_reader).ctr, _CMM_LOAD_SHARED(rcu_gp.ctr));
+		_rcu_reader_timestamp(&URCU_TLS(rcu_reader).since_ns);
+		_CMM_STORE_SHARED(URCU_TLS(rcu_reader).ctr, rcu_gp_ctr_read());
 		smp_mb_slave(RCU_MB_GROUP);
 	} else
 		_CMM_STORE_SHARED(URCU_TLS(rcu_reader).ctr, tmp + RCU_GP_COUNT);
@@ -269,6 +396,53 @@ static inline int _rcu_read_ongoing(void)
 	return URCU_TLS(rcu_reader).ctr & RCU_GP_CTR_NEST_MASK;
 }
 
+/*
+ * Enter an RCU read-side critical section of "domain", on behalf of
+ * "reader", which has been registered to this domain by the current
+ * thread.
+ */
+static inline void _rcu_domain_read_lock(struct rcu_domain *domain,
+		struct rcu_reader *reader)
+{
+	unsigned long tmp;
+
+	cmm_barrier();
+	tmp = reader->ctr;
+	if (caa_likely(!(tmp & RCU_GP_CTR_NEST_MASK))) {
+		_rcu_reader_timestamp(&reader->since_ns);
+		_CMM_STORE_SHARED(reader->ctr, _CMM_LOAD_SHARED(domain->gp->ctr));
+		smp_mb_slave_domain(domain->shared, RCU_MB_GROUP);
+	} else
+		_CMM_STORE_SHARED(reader->ctr, tmp + RCU_GP_COUNT);
+}
+
+/*
+ * Exit an RCU read-side critical section of "domain".
+ */
+static inline void _rcu_domain_read_unlock(struct rcu_domain *domain,
+		struct rcu_reader *reader)
+{
+	unsigned long tmp;
+
+	tmp = reader->ctr;
+	if (caa_likely((tmp & RCU_GP_CTR_NEST_MASK) == RCU_GP_COUNT)) {
+		smp_mb_slave_domain(domain->shared, RCU_MB_GROUP);
+		_CMM_STORE_SHARED(reader->ctr, tmp - RCU_GP_COUNT);
+		smp_mb_slave_domain(domain->shared, RCU_MB_GROUP);
+		rcu_gp_wake_up(domain->gp);
+	} else
+		_CMM_STORE_SHARED(reader->ctr, tmp - RCU_GP_COUNT);
+	cmm_barrier();	/* Ensure the compiler does not reorder us with mutex */
+}
+
+/*
+ * Returns whether "reader" is within a RCU read-side critical section.
+ */
+static inline int _rcu_domain_read_ongoing(struct rcu_reader *reader)
+{
+	return reader->ctr & RCU_GP_CTR_NEST_MASK;
+}
+
 #ifdef __cplusplus
 }
 #endif
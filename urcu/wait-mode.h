@@ -0,0 +1,47 @@
+#ifndef _URCU_WAIT_MODE_H
+#define _URCU_WAIT_MODE_H
+
+/*
+ * urcu/wait-mode.h
+ *
+ * Userspace RCU library - grace period waiting policies
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * How grace periods wait for readers, and how threads wait for a grace
+ * period started by another thread, as set by rcu_set_wait_mode().
+ */
+enum rcu_wait_mode {
+	/* Busy-wait as long as recent waits suggest it pays off. */
+	RCU_WAIT_MODE_ADAPTIVE = 0,
+	/* Busy-wait, then yield the CPU, for long before sleeping. */
+	RCU_WAIT_MODE_LATENCY = 1,
+	/* Sleep as soon as the awaited condition is not met. */
+	RCU_WAIT_MODE_EFFICIENCY = 2,
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _URCU_WAIT_MODE_H */